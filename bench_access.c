@@ -0,0 +1,307 @@
+/*
+ * Filename: bench_access.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Microbenchmark for single element access. Times the checked
+ *          accessors (UArray2_at, Bit2_get, Bit2_put) against their inline
+ *          versions (UArray2_at_unchecked, Bit2_get_fast, Bit2_put_fast),
+ *          once sweeping the array in row major order and once at
+ *          positions drawn at random ahead of time, and reports ns per
+ *          access. Each pair must produce the same checksum.
+ *
+ *          Build with make CHECKED=1 to see what the checks cost when they
+ *          are kept in the inline accessors.
+ *
+ * Usage: bench_access [width height [rounds]]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "uarray2.h"
+#include "bit2.h"
+#include "bench_util.h"
+
+#define NRANDOM (1 << 20)
+
+/* one way of reading or writing every position in a list */
+typedef struct Access {
+        const char *name;
+        uint64_t (*run)(void *array, const int *cols, const int *rows,
+                        int n);
+} Access;
+
+uint64_t sweep_at(UArray2_T array);
+uint64_t sweep_at_unchecked(UArray2_T array);
+uint64_t sweep_get(Bit2_T bits);
+uint64_t sweep_get_fast(Bit2_T bits);
+uint64_t sweep_put(Bit2_T bits);
+uint64_t sweep_put_fast(Bit2_T bits);
+uint64_t random_at(void *array, const int *cols, const int *rows, int n);
+uint64_t random_at_unchecked(void *array, const int *cols, const int *rows,
+                             int n);
+uint64_t random_get(void *bits, const int *cols, const int *rows, int n);
+uint64_t random_get_fast(void *bits, const int *cols, const int *rows,
+                         int n);
+void report(const char *name, double seconds, long accesses, uint64_t sum,
+            uint64_t reference);
+
+int main(int argc, char *argv[])
+{
+        int width = 4096;
+        int height = 4096;
+        int rounds = 5;
+        if (argc > 2) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        }
+        if (argc > 3) {
+                rounds = atoi(argv[3]);
+        }
+        if (argc == 2 || argc > 4 || width <= 0 || height <= 0 ||
+            rounds <= 0) {
+                fprintf(stderr, "Usage: %s [width height [rounds]]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        UArray2_T array = UArray2_new(width, height, sizeof(int));
+        Bit2_T bits = Bit2_new(width, height);
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        uint64_t r = Bench_random(&state);
+                        *(int *)UArray2_at(array, col, row) = r & 0xFFFF;
+                        Bit2_put(bits, col, row, (r >> 20) & 1);
+                }
+        }
+        /* the put sweeps change the image, so each round starts from a
+           copy of it */
+        size_t nwords = ((size_t)width * height + 63) / 64;
+        uint64_t *saved = malloc(nwords * sizeof(uint64_t));
+        int *cols = malloc(NRANDOM * sizeof(int));
+        int *rows = malloc(NRANDOM * sizeof(int));
+        if (saved == NULL || cols == NULL || rows == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                return EXIT_FAILURE;
+        }
+        memcpy(saved, bits->words, nwords * sizeof(uint64_t));
+        for (int i = 0; i < NRANDOM; i++) {
+                cols[i] = Bench_random(&state) % width;
+                rows[i] = Bench_random(&state) % height;
+        }
+
+        long cells = (long)width * height;
+        printf("%dx%d, best of %d rounds\n", width, height, rounds);
+        uint64_t (*const uarray_sweeps[])(UArray2_T) = {
+                sweep_at, sweep_at_unchecked
+        };
+        uint64_t (*const bit_sweeps[])(Bit2_T) = {
+                sweep_get, sweep_get_fast, sweep_put, sweep_put_fast
+        };
+        const char *sweep_names[] = {
+                "UArray2_at", "UArray2_at_unchecked", "Bit2_get",
+                "Bit2_get_fast", "Bit2_put", "Bit2_put_fast"
+        };
+        uint64_t reference = 0;
+        for (int s = 0; s < 6; s++) {
+                double best = -1;
+                uint64_t sum = 0;
+                for (int r = 0; r < rounds; r++) {
+                        memcpy(bits->words, saved, nwords * sizeof(uint64_t));
+                        double start = Bench_now();
+                        sum = s < 2 ? uarray_sweeps[s](array) :
+                                      bit_sweeps[s - 2](bits);
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                /* each checked accessor is the reference for the next */
+                if (s % 2 == 0) {
+                        reference = sum;
+                }
+                report(sweep_names[s], best, cells, sum, reference);
+        }
+
+        const Access randoms[] = {
+                { "UArray2_at random",           random_at },
+                { "UArray2_at_unchecked random", random_at_unchecked },
+                { "Bit2_get random",             random_get },
+                { "Bit2_get_fast random",        random_get_fast },
+        };
+        for (int a = 0; a < 4; a++) {
+                void *target = a < 2 ? (void *)array : (void *)bits;
+                double best = -1;
+                uint64_t sum = 0;
+                for (int r = 0; r < rounds; r++) {
+                        double start = Bench_now();
+                        sum = randoms[a].run(target, cols, rows, NRANDOM);
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                if (a % 2 == 0) {
+                        reference = sum;
+                }
+                report(randoms[a].name, best, NRANDOM, sum, reference);
+        }
+
+        free(saved);
+        free(cols);
+        free(rows);
+        Bit2_free(&bits);
+        UArray2_free(&array);
+        return EXIT_SUCCESS;
+}
+
+/* uint64_t sweep_at(UArray2_T array)
+ * Returns: the sum of every element, read in row major order
+ */
+uint64_t sweep_at(UArray2_T array)
+{
+        uint64_t sum = 0;
+        for (int row = 0; row < array->height; row++) {
+                for (int col = 0; col < array->width; col++) {
+                        sum += *(int *)UArray2_at(array, col, row);
+                }
+        }
+        return sum;
+}
+
+/* uint64_t sweep_at_unchecked(UArray2_T array)
+ * Returns: the same sum as sweep_at, through UArray2_at_unchecked
+ */
+uint64_t sweep_at_unchecked(UArray2_T array)
+{
+        uint64_t sum = 0;
+        for (int row = 0; row < array->height; row++) {
+                for (int col = 0; col < array->width; col++) {
+                        sum += *(int *)UArray2_at_unchecked(array, col, row);
+                }
+        }
+        return sum;
+}
+
+/* uint64_t sweep_get(Bit2_T bits)
+ * Returns: the number of set bits, read one at a time in row major order
+ */
+uint64_t sweep_get(Bit2_T bits)
+{
+        uint64_t sum = 0;
+        for (int row = 0; row < bits->height; row++) {
+                for (int col = 0; col < bits->width; col++) {
+                        sum += Bit2_get(bits, col, row);
+                }
+        }
+        return sum;
+}
+
+/* uint64_t sweep_get_fast(Bit2_T bits)
+ * Returns: the same count as sweep_get, through Bit2_get_fast
+ */
+uint64_t sweep_get_fast(Bit2_T bits)
+{
+        uint64_t sum = 0;
+        for (int row = 0; row < bits->height; row++) {
+                for (int col = 0; col < bits->width; col++) {
+                        sum += Bit2_get_fast(bits, col, row);
+                }
+        }
+        return sum;
+}
+
+/* uint64_t sweep_put(Bit2_T bits)
+ * Returns: the number of set bits
+ * Does: Inverts every bit with Bit2_put, summing the bits it replaced
+ */
+uint64_t sweep_put(Bit2_T bits)
+{
+        uint64_t sum = 0;
+        for (int row = 0; row < bits->height; row++) {
+                for (int col = 0; col < bits->width; col++) {
+                        int bit = Bit2_get_fast(bits, col, row);
+                        sum += Bit2_put(bits, col, row, !bit);
+                }
+        }
+        return sum;
+}
+
+/* uint64_t sweep_put_fast(Bit2_T bits)
+ * Returns: the same as sweep_put, through Bit2_put_fast
+ */
+uint64_t sweep_put_fast(Bit2_T bits)
+{
+        uint64_t sum = 0;
+        for (int row = 0; row < bits->height; row++) {
+                for (int col = 0; col < bits->width; col++) {
+                        int bit = Bit2_get_fast(bits, col, row);
+                        sum += Bit2_put_fast(bits, col, row, !bit);
+                }
+        }
+        return sum;
+}
+
+/* uint64_t random_at(void *array, const int *cols, const int *rows, int n)
+ * Returns: the sum of the elements at the n listed positions
+ */
+uint64_t random_at(void *array, const int *cols, const int *rows, int n)
+{
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+                sum += *(int *)UArray2_at(array, cols[i], rows[i]);
+        }
+        return sum;
+}
+
+/* uint64_t random_at_unchecked(void *array, const int *cols,
+ *                              const int *rows, int n)
+ * Returns: the same sum as random_at, through UArray2_at_unchecked
+ */
+uint64_t random_at_unchecked(void *array, const int *cols, const int *rows,
+                             int n)
+{
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+                sum += *(int *)UArray2_at_unchecked(array, cols[i], rows[i]);
+        }
+        return sum;
+}
+
+/* uint64_t random_get(void *bits, const int *cols, const int *rows, int n)
+ * Returns: how many of the n listed bits are set
+ */
+uint64_t random_get(void *bits, const int *cols, const int *rows, int n)
+{
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+                sum += Bit2_get(bits, cols[i], rows[i]);
+        }
+        return sum;
+}
+
+/* uint64_t random_get_fast(void *bits, const int *cols, const int *rows,
+ *                          int n)
+ * Returns: the same count as random_get, through Bit2_get_fast
+ */
+uint64_t random_get_fast(void *bits, const int *cols, const int *rows,
+                         int n)
+{
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+                sum += Bit2_get_fast(bits, cols[i], rows[i]);
+        }
+        return sum;
+}
+
+/* void report(const char *name, double seconds, long accesses,
+ *             uint64_t sum, uint64_t reference)
+ * Does: Prints one result line, flagging a checksum that differs from
+ *       the checked accessor's
+ */
+void report(const char *name, double seconds, long accesses, uint64_t sum,
+            uint64_t reference)
+{
+        printf("%-28s %8.2f ns/access %10.1f Maccesses/s  %s\n", name,
+               seconds * 1e9 / accesses, accesses / seconds / 1e6,
+               Bench_agrees(sum == reference));
+}
@@ -0,0 +1,458 @@
+/*
+ * Filename: bench_bulk.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the Bit2 bulk operations. Each operation is done
+ *          twice on a large random image, once a pixel at a time through
+ *          Bit2_get_fast and Bit2_put_fast and once through the word level
+ *          call (Bit2_count, Bit2_count_rect, Bit2_put_rect, Bit2_xor,
+ *          Bit2_and, Bit2_not). The "above" operation counts the pixels
+ *          that are set along with the pixel above them, the vertical
+ *          neighbor check of a flood fill; in bulk it ANDs each row's
+ *          words with the words one stride back when rows are word
+ *          aligned, and reads both rows through Bit2_get_bits when they
+ *          are not. The last operation sets a to the 4-neighbor dilation
+ *          of b, through Bit2_dilate4 when rows are word aligned and
+ *          through Bit2_get_bits and Bit2_put_bits when they are not.
+ *          Every operation is run on packed and on padded (BIT2_PADDED)
+ *          images, and every round starts from the same two images.
+ *          Reports ns per pixel and Gpixels/s, and checks that both ways
+ *          give the same count or, for the operations that write, leave
+ *          the same image (compared afterwards, untimed).
+ *
+ * Usage: bench_bulk [width height [rounds]]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "bit2.h"
+#include "bench_util.h"
+
+/* lets the word kernels below use the popcnt instruction, as Bit2 does */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define POPCNT_TARGET __attribute__((target("popcnt")))
+#else
+#define POPCNT_TARGET
+#endif
+
+/* one operation, done per pixel and in bulk; each returns its result, or
+   0 if it writes */
+typedef struct Operation {
+        const char *name;
+        uint64_t (*per_pixel)(Bit2_T a, Bit2_T b);
+        uint64_t (*bulk)(Bit2_T a, Bit2_T b);
+        int writes; /* 1 if the result is the image a is left as */
+} Operation;
+
+uint64_t count_pixels(Bit2_T a, Bit2_T b);
+uint64_t count_bulk(Bit2_T a, Bit2_T b);
+uint64_t count_rect_pixels(Bit2_T a, Bit2_T b);
+uint64_t count_rect_bulk(Bit2_T a, Bit2_T b);
+uint64_t put_rect_pixels(Bit2_T a, Bit2_T b);
+uint64_t put_rect_bulk(Bit2_T a, Bit2_T b);
+uint64_t xor_pixels(Bit2_T a, Bit2_T b);
+uint64_t xor_bulk(Bit2_T a, Bit2_T b);
+uint64_t and_pixels(Bit2_T a, Bit2_T b);
+uint64_t and_bulk(Bit2_T a, Bit2_T b);
+uint64_t not_pixels(Bit2_T a, Bit2_T b);
+uint64_t not_bulk(Bit2_T a, Bit2_T b);
+uint64_t above_pixels(Bit2_T a, Bit2_T b);
+POPCNT_TARGET uint64_t above_bulk(Bit2_T a, Bit2_T b);
+uint64_t dilate_pixels(Bit2_T a, Bit2_T b);
+uint64_t dilate_bulk(Bit2_T a, Bit2_T b);
+void run_layout(const char *name, int layout, int width, int height,
+                int rounds);
+uint64_t count_all(Bit2_T a);
+void report(const char *name, double seconds, double pixels, int agrees);
+
+static const Operation operations[] = {
+        { "count",      count_pixels,      count_bulk,      0 },
+        { "count_rect", count_rect_pixels, count_rect_bulk, 0 },
+        { "put_rect",   put_rect_pixels,   put_rect_bulk,   1 },
+        { "xor",        xor_pixels,        xor_bulk,        1 },
+        { "and",        and_pixels,        and_bulk,        1 },
+        { "not",        not_pixels,        not_bulk,        1 },
+        { "above",      above_pixels,      above_bulk,      0 },
+        { "dilate4",    dilate_pixels,     dilate_bulk,     1 },
+};
+static const int NUM_OPERATIONS = sizeof(operations) / sizeof(operations[0]);
+
+int main(int argc, char *argv[])
+{
+        /* not a multiple of 64, so packed rows start part way into a word */
+        int width = 8100;
+        int height = 8100;
+        int rounds = 5;
+        if (argc > 2) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        }
+        if (argc > 3) {
+                rounds = atoi(argv[3]);
+        }
+        if (argc == 2 || argc > 4 || width < 3 || height < 3 ||
+            rounds <= 0) {
+                fprintf(stderr, "Usage: %s [width height [rounds]]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        printf("%dx%d, best of %d rounds\n", width, height, rounds);
+        run_layout("packed", BIT2_PACKED, width, height, rounds);
+        run_layout("padded", BIT2_PADDED, width, height, rounds);
+        return EXIT_SUCCESS;
+}
+
+/* void run_layout(const char *name, int layout, int width, int height,
+ *                 int rounds)
+ * Does: Times every operation on two random images in the given layout
+ */
+void run_layout(const char *name, int layout, int width, int height,
+                int rounds)
+{
+        Bit2_T a = Bit2_new_layout(width, height, layout);
+        Bit2_T b = Bit2_new_layout(width, height, layout);
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        uint64_t r = Bench_random(&state);
+                        Bit2_put(a, col, row, r & 1);
+                        Bit2_put(b, col, row, (r >> 20) & 1);
+                }
+        }
+        size_t nbytes = ((size_t)a->stride * height + 63) / 64 *
+                        sizeof(uint64_t);
+        uint64_t *saved = malloc(nbytes);
+        uint64_t *expected = malloc(nbytes);
+        if (saved == NULL || expected == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        memcpy(saved, a->words, nbytes);
+
+        double pixels = (double)width * height;
+        printf("%s rows, stride %d words\n", name, Bit2_stride(a));
+        for (int op = 0; op < NUM_OPERATIONS; op++) {
+                uint64_t reference = 0;
+                for (int way = 0; way < 2; way++) {
+                        double best = -1;
+                        uint64_t result = 0;
+                        for (int r = 0; r < rounds; r++) {
+                                memcpy(a->words, saved, nbytes);
+                                double start = Bench_now();
+                                result = way == 0 ?
+                                         operations[op].per_pixel(a, b) :
+                                         operations[op].bulk(a, b);
+                                double elapsed = Bench_now() - start;
+                                best = Bench_best(best, elapsed);
+                        }
+                        int agrees = result == reference;
+                        if (way == 0) {
+                                reference = result;
+                                memcpy(expected, a->words, nbytes);
+                                agrees = 1;
+                        } else if (operations[op].writes) {
+                                agrees = memcmp(expected, a->words,
+                                                nbytes) == 0;
+                        }
+                        char line[48];
+                        snprintf(line, sizeof(line), "%-10s %s",
+                                 operations[op].name,
+                                 way == 0 ? "per pixel" : "bulk");
+                        report(line, best, pixels, agrees);
+                }
+        }
+        free(saved);
+        free(expected);
+        Bit2_free(&a);
+        Bit2_free(&b);
+}
+
+/* uint64_t count_pixels(Bit2_T a, Bit2_T b)
+ * Returns: the number of 1 bits in a, read a pixel at a time
+ */
+uint64_t count_pixels(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        return count_all(a);
+}
+
+/* uint64_t count_bulk(Bit2_T a, Bit2_T b)
+ * Returns: the number of 1 bits in a, through Bit2_count
+ */
+uint64_t count_bulk(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        return Bit2_count(a);
+}
+
+/* uint64_t count_rect_pixels(Bit2_T a, Bit2_T b)
+ * Returns: the number of 1 bits of a inside its one pixel border, read a
+ *          pixel at a time
+ */
+uint64_t count_rect_pixels(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        uint64_t count = 0;
+        for (int row = 1; row < a->height - 1; row++) {
+                for (int col = 1; col < a->width - 1; col++) {
+                        count += Bit2_get_fast(a, col, row);
+                }
+        }
+        return count;
+}
+
+/* uint64_t count_rect_bulk(Bit2_T a, Bit2_T b)
+ * Returns: the same count as count_rect_pixels, through Bit2_count_rect
+ */
+uint64_t count_rect_bulk(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        return Bit2_count_rect(a, 1, 1, a->width - 2, a->height - 2);
+}
+
+/* uint64_t put_rect_pixels(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: Sets every pixel of a inside its one pixel border, a pixel at a
+ *       time
+ */
+uint64_t put_rect_pixels(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        for (int row = 1; row < a->height - 1; row++) {
+                for (int col = 1; col < a->width - 1; col++) {
+                        Bit2_put_fast(a, col, row, 1);
+                }
+        }
+        return 0;
+}
+
+/* uint64_t put_rect_bulk(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: What put_rect_pixels does, through Bit2_put_rect
+ */
+uint64_t put_rect_bulk(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        Bit2_put_rect(a, 1, 1, a->width - 2, a->height - 2, 1);
+        return 0;
+}
+
+/* uint64_t xor_pixels(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: Sets a to a XOR b a pixel at a time
+ */
+uint64_t xor_pixels(Bit2_T a, Bit2_T b)
+{
+        for (int row = 0; row < a->height; row++) {
+                for (int col = 0; col < a->width; col++) {
+                        Bit2_put_fast(a, col, row, Bit2_get_fast(a, col, row)
+                                      ^ Bit2_get_fast(b, col, row));
+                }
+        }
+        return 0;
+}
+
+/* uint64_t xor_bulk(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: What xor_pixels does, through Bit2_xor
+ */
+uint64_t xor_bulk(Bit2_T a, Bit2_T b)
+{
+        Bit2_xor(a, b);
+        return 0;
+}
+
+/* uint64_t and_pixels(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: Masks a with b a pixel at a time
+ */
+uint64_t and_pixels(Bit2_T a, Bit2_T b)
+{
+        for (int row = 0; row < a->height; row++) {
+                for (int col = 0; col < a->width; col++) {
+                        Bit2_put_fast(a, col, row, Bit2_get_fast(a, col, row)
+                                      & Bit2_get_fast(b, col, row));
+                }
+        }
+        return 0;
+}
+
+/* uint64_t and_bulk(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: What and_pixels does, through Bit2_and
+ */
+uint64_t and_bulk(Bit2_T a, Bit2_T b)
+{
+        Bit2_and(a, b);
+        return 0;
+}
+
+/* uint64_t not_pixels(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: Inverts a a pixel at a time
+ */
+uint64_t not_pixels(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        for (int row = 0; row < a->height; row++) {
+                for (int col = 0; col < a->width; col++) {
+                        Bit2_put_fast(a, col, row,
+                                      !Bit2_get_fast(a, col, row));
+                }
+        }
+        return 0;
+}
+
+/* uint64_t not_bulk(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: What not_pixels does, through Bit2_not
+ */
+uint64_t not_bulk(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        Bit2_not(a);
+        return 0;
+}
+
+/* uint64_t above_pixels(Bit2_T a, Bit2_T b)
+ * Returns: the number of pixels of a that are set along with the pixel
+ *          directly above them, read a pixel at a time
+ */
+uint64_t above_pixels(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        uint64_t count = 0;
+        for (int row = 1; row < a->height; row++) {
+                for (int col = 0; col < a->width; col++) {
+                        count += Bit2_get_fast(a, col, row) &
+                                 Bit2_get_fast(a, col, row - 1);
+                }
+        }
+        return count;
+}
+
+/* uint64_t above_bulk(Bit2_T a, Bit2_T b)
+ * Returns: the same count as above_pixels, a word at a time
+ */
+POPCNT_TARGET uint64_t above_bulk(Bit2_T a, Bit2_T b)
+{
+        (void) b;
+        uint64_t count = 0;
+        int stride = Bit2_stride(a);
+        if (stride != 0) {
+                for (int row = 1; row < a->height; row++) {
+                        const uint64_t *words = Bit2_row_words(a, row);
+                        for (int i = 0; i < stride; i++) {
+                                count += __builtin_popcountll(words[i] &
+                                                         words[i - stride]);
+                        }
+                }
+                return count;
+        }
+        for (int row = 1; row < a->height; row++) {
+                for (int col = 0; col < a->width; col += 64) {
+                        int n = a->width - col < 64 ? a->width - col : 64;
+                        count += __builtin_popcountll(
+                                Bit2_get_bits(a, col, row, n) &
+                                Bit2_get_bits(a, col, row - 1, n));
+                }
+        }
+        return count;
+}
+
+/* uint64_t dilate_pixels(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: Sets each pixel of a to 1 if the same pixel of b or one of its
+ *       4 neighbors is 1, else 0, a pixel at a time
+ */
+uint64_t dilate_pixels(Bit2_T a, Bit2_T b)
+{
+        for (int row = 0; row < a->height; row++) {
+                for (int col = 0; col < a->width; col++) {
+                        int bit = Bit2_get_fast(b, col, row);
+                        if (col > 0) {
+                                bit |= Bit2_get_fast(b, col - 1, row);
+                        }
+                        if (col < a->width - 1) {
+                                bit |= Bit2_get_fast(b, col + 1, row);
+                        }
+                        if (row > 0) {
+                                bit |= Bit2_get_fast(b, col, row - 1);
+                        }
+                        if (row < a->height - 1) {
+                                bit |= Bit2_get_fast(b, col, row + 1);
+                        }
+                        Bit2_put_fast(a, col, row, bit);
+                }
+        }
+        return 0;
+}
+
+/* uint64_t dilate_bulk(Bit2_T a, Bit2_T b)
+ * Returns: 0
+ * Does: What dilate_pixels does, through Bit2_dilate4 when rows are word
+ *       aligned, and otherwise 64 pixels at a time: each run of pixels is
+ *       ORed with itself shifted both ways, the pixels just past either
+ *       end, and the same runs of the rows above and below
+ */
+uint64_t dilate_bulk(Bit2_T a, Bit2_T b)
+{
+        if (Bit2_stride(b) != 0) {
+                Bit2_dilate4(a, b);
+                return 0;
+        }
+        for (int row = 0; row < a->height; row++) {
+                for (int col = 0; col < a->width; col += 64) {
+                        int n = a->width - col < 64 ? a->width - col : 64;
+                        uint64_t bits = Bit2_get_bits(b, col, row, n);
+                        uint64_t word = bits | (bits << 1) | (bits >> 1);
+                        if (col > 0) {
+                                word |= Bit2_get_fast(b, col - 1, row);
+                        }
+                        if (col + n < a->width) {
+                                word |= (uint64_t)Bit2_get_fast(b, col + n,
+                                                                row) << (n - 1);
+                        }
+                        if (row > 0) {
+                                word |= Bit2_get_bits(b, col, row - 1, n);
+                        }
+                        if (row < a->height - 1) {
+                                word |= Bit2_get_bits(b, col, row + 1, n);
+                        }
+                        if (n < 64) {
+                                word &= ~(uint64_t)0 >> (64 - n);
+                        }
+                        Bit2_put_bits(a, col, row, word, n);
+                }
+        }
+        return 0;
+}
+
+/* uint64_t count_all(Bit2_T a)
+ * Returns: the number of 1 bits in a, read a pixel at a time
+ */
+uint64_t count_all(Bit2_T a)
+{
+        uint64_t count = 0;
+        for (int row = 0; row < a->height; row++) {
+                for (int col = 0; col < a->width; col++) {
+                        count += Bit2_get_fast(a, col, row);
+                }
+        }
+        return count;
+}
+
+/* void report(const char *name, double seconds, double pixels, int agrees)
+ * Does: Prints one result line, flagging a result that differs from the
+ *       per pixel one
+ */
+void report(const char *name, double seconds, double pixels, int agrees)
+{
+        printf("%-22s %8.4f ns/pixel %8.2f Gpixels/s  %s\n", name,
+               seconds * 1e9 / pixels, pixels / seconds / 1e9,
+               Bench_agrees(agrees));
+}
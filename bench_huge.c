@@ -0,0 +1,286 @@
+/*
+ * Filename: bench_huge.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the UARRAY2_HUGE and BIT2_HUGE creation flags.
+ *          Builds the same large array of ints and the same large bitmap
+ *          with and without the flag and times the kernels that walk
+ *          memory with a stride of a whole row: UArray2_map_col_major, a
+ *          probe of random elements through UArray2_at_unchecked, and
+ *          Bit2_map_col_major. Each kernel reports ns per element, the
+ *          data TLB load misses per element counted by perf_event_open
+ *          (n/a where the kernel or the machine has no such counter), and
+ *          checks that both allocations give the same result. The MB of
+ *          each array the kernel backed with huge pages is read from
+ *          /proc/self/smaps_rollup; with transparent huge pages set to
+ *          "always" the plain allocation gets some too, just not from its
+ *          unaligned ends.
+ *
+ * Usage: bench_huge [width height [rounds]]
+ *        (the bitmap is 4 * width by 4 * height bits)
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "uarray2.h"
+#include "bit2.h"
+#include "bench_util.h"
+
+#define NPROBES (1 << 22)
+
+typedef struct Result {
+        double seconds;
+        double misses; /* data TLB load misses, or -1 if not counted */
+        uint64_t value;
+} Result;
+
+Result time_kernel(int kernel, UArray2_T array, Bit2_T bits, int rounds,
+                   const int *cols, const int *rows);
+uint64_t run_kernel(int kernel, UArray2_T array, Bit2_T bits,
+                    const int *cols, const int *rows);
+void add_element(int col, int row, UArray2_T a, void *p1, void *cl);
+void add_bit(int col, int row, Bit2_T a, int bit, void *cl);
+UArray2_T fill_array(int width, int height, int flags);
+Bit2_T fill_bits(int width, int height, int flags);
+int open_tlb_counter(void);
+long huge_kb(void);
+
+static int tlb_counter = -1;
+
+int main(int argc, char *argv[])
+{
+        int width = 8192;
+        int height = 8192;
+        int rounds = 3;
+        if (argc > 2) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        }
+        if (argc > 3) {
+                rounds = atoi(argv[3]);
+        }
+        if (argc == 2 || argc > 4 || width <= 0 || height <= 0 ||
+            rounds <= 0) {
+                fprintf(stderr, "Usage: %s [width height [rounds]]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        int *cols = malloc(NPROBES * sizeof(int));
+        int *rows = malloc(NPROBES * sizeof(int));
+        if (cols == NULL || rows == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                return EXIT_FAILURE;
+        }
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < NPROBES; i++) {
+                cols[i] = Bench_random(&state) % width;
+                rows[i] = Bench_random(&state) % height;
+        }
+        tlb_counter = open_tlb_counter();
+
+        const char *kernels[] = { "col major map", "random probe",
+                                  "bit col major map" };
+        const char *modes[] = { "plain", "huge" };
+        uint64_t reference[3] = { 0, 0, 0 };
+        printf("%dx%d ints, %dx%d bits, best of %d rounds\n", width, height,
+               4 * width, 4 * height, rounds);
+        for (int mode = 0; mode < 2; mode++) {
+                long before = huge_kb();
+                UArray2_T array = fill_array(width, height,
+                                             mode ? UARRAY2_HUGE : 0);
+                long array_kb = huge_kb() - before;
+                Bit2_T bits = fill_bits(4 * width, 4 * height,
+                                        mode ? BIT2_HUGE : 0);
+                long bits_kb = huge_kb() - before - array_kb;
+                printf("%-5s: %ld MB of the ints and %ld MB of the bits on "
+                       "huge pages\n", modes[mode], array_kb / 1024,
+                       bits_kb / 1024);
+                for (int kernel = 0; kernel < 3; kernel++) {
+                        Result r = time_kernel(kernel, array, bits, rounds,
+                                               cols, rows);
+                        if (mode == 0) {
+                                reference[kernel] = r.value;
+                        }
+                        double count = kernel == 1 ? NPROBES
+                                     : kernel == 0 ? (double)width * height
+                                     : 16.0 * width * height;
+                        char misses[32] = "n/a";
+                        if (r.misses >= 0) {
+                                snprintf(misses, sizeof(misses), "%.4f",
+                                         r.misses / count);
+                        }
+                        printf("%-5s %-18s %8.2f ns/op  %8s TLB misses/op"
+                               "  %s\n", modes[mode], kernels[kernel],
+                               r.seconds * 1e9 / count, misses,
+                               Bench_agrees(r.value == reference[kernel]));
+                }
+                UArray2_free(&array);
+                Bit2_free(&bits);
+        }
+        free(cols);
+        free(rows);
+        return EXIT_SUCCESS;
+}
+
+/* Result time_kernel(int kernel, UArray2_T array, Bit2_T bits, int rounds,
+ *                    const int *cols, const int *rows)
+ * Returns: the fastest of rounds runs of the kernel, with the TLB misses
+ *          of that run
+ */
+Result time_kernel(int kernel, UArray2_T array, Bit2_T bits, int rounds,
+                   const int *cols, const int *rows)
+{
+        Result best = { -1, -1, 0 };
+        for (int r = 0; r < rounds; r++) {
+                Result this = { 0, -1, 0 };
+                uint64_t misses = 0;
+                if (tlb_counter >= 0) {
+                        ioctl(tlb_counter, PERF_EVENT_IOC_RESET, 0);
+                        ioctl(tlb_counter, PERF_EVENT_IOC_ENABLE, 0);
+                }
+                double start = Bench_now();
+                this.value = run_kernel(kernel, array, bits, cols, rows);
+                this.seconds = Bench_now() - start;
+                if (tlb_counter >= 0) {
+                        ioctl(tlb_counter, PERF_EVENT_IOC_DISABLE, 0);
+                        if (read(tlb_counter, &misses, sizeof(misses)) ==
+                            sizeof(misses)) {
+                                this.misses = misses;
+                        }
+                }
+                if (best.seconds < 0 || this.seconds < best.seconds) {
+                        best = this;
+                }
+        }
+        return best;
+}
+
+/* uint64_t run_kernel(int kernel, UArray2_T array, Bit2_T bits,
+ *                     const int *cols, const int *rows)
+ * Returns: the sum the kernel computes: of every element in column major
+ *          order (kernel 0), of the NPROBES listed elements (kernel 1), or
+ *          of every bit in column major order (kernel 2)
+ */
+uint64_t run_kernel(int kernel, UArray2_T array, Bit2_T bits,
+                    const int *cols, const int *rows)
+{
+        uint64_t sum = 0;
+        if (kernel == 0) {
+                UArray2_map_col_major(array, add_element, &sum);
+        } else if (kernel == 1) {
+                for (int i = 0; i < NPROBES; i++) {
+                        sum += *(int *)UArray2_at_unchecked(array, cols[i],
+                                                            rows[i]);
+                }
+        } else {
+                Bit2_map_col_major(bits, add_bit, &sum);
+        }
+        return sum;
+}
+
+/* void add_element(int col, int row, UArray2_T a, void *p1, void *cl)
+ * Does: Adds the element p1 to the uint64_t sum cl
+ */
+void add_element(int col, int row, UArray2_T a, void *p1, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) a;
+        *(uint64_t *)cl += *(int *)p1;
+}
+
+/* void add_bit(int col, int row, Bit2_T a, int bit, void *cl)
+ * Does: Adds bit to the uint64_t sum cl
+ */
+void add_bit(int col, int row, Bit2_T a, int bit, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) a;
+        *(uint64_t *)cl += bit;
+}
+
+/* UArray2_T fill_array(int width, int height, int flags)
+ * Returns: a row major array of ints made with the given creation flags,
+ *          every element set from its position
+ */
+UArray2_T fill_array(int width, int height, int flags)
+{
+        UArray2_T array = UArray2_new_layout(width, height, sizeof(int),
+                                             UARRAY2_ROW_MAJOR | flags);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        *(int *)UArray2_at_unchecked(array, col, row) =
+                                (row * 31) ^ col;
+                }
+        }
+        return array;
+}
+
+/* Bit2_T fill_bits(int width, int height, int flags)
+ * Returns: a padded bitmap made with the given creation flags, filled a
+ *          word at a time from a fixed xorshift sequence
+ */
+Bit2_T fill_bits(int width, int height, int flags)
+{
+        Bit2_T bits = Bit2_new_layout(width, height, BIT2_PADDED | flags);
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col += 64) {
+                        int n = width - col < 64 ? width - col : 64;
+                        Bit2_put_bits(bits, col, row, Bench_random(&state),
+                                      n);
+                }
+        }
+        return bits;
+}
+
+/* int open_tlb_counter(void)
+ * Returns: a disabled perf event counting this thread's data TLB load
+ *          misses in user mode, or -1 if there is no such counter
+ */
+int open_tlb_counter(void)
+{
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        return fd < 0 ? -1 : (int)fd;
+}
+
+/* long huge_kb(void)
+ * Returns: the KB of this process's anonymous memory on huge pages, or 0
+ *          if /proc does not say
+ */
+long huge_kb(void)
+{
+        FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+        if (fp == NULL) {
+                return 0;
+        }
+        char line[256];
+        long kb = 0;
+        while (fgets(line, sizeof(line), fp) != NULL) {
+                if (sscanf(line, "AnonHugePages: %ld", &kb) == 1) {
+                        break;
+                }
+        }
+        fclose(fp);
+        return kb;
+}
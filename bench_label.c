@@ -0,0 +1,258 @@
+/*
+ * Filename: bench_label.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the connected component labeler. Builds large
+ *          synthetic bitmaps in memory and, for 4- and 8-connectivity,
+ *          times Components_label (runs, union-find and the stats table)
+ *          and Components_image (the label image) and reports megapixels
+ *          per second. Every labeling is checked against a plain pixel by
+ *          pixel flood fill that numbers components in the same row major
+ *          order: the label images must be identical and every component's
+ *          area, bounding box and border flag must match.
+ *
+ *          noise is half 1 bits at random, the most runs and unions a
+ *          bitmap can have; speckle is 2% 1 bits, mostly single pixels;
+ *          blobs is overlapping random rectangles, like scanned forms.
+ *
+ * Usage: bench_label [width height [rounds]]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "bit2.h"
+#include "uarray2.h"
+#include "components.h"
+#include "bench_util.h"
+
+typedef struct Pattern {
+        const char *name;
+        void (*fill)(Bit2_T image);
+} Pattern;
+
+void fill_noise(Bit2_T image);
+void fill_speckle(Bit2_T image);
+void fill_blobs(Bit2_T image);
+int check_labels(Bit2_T image, Components_T comps, UArray2_T labels);
+void flood(Bit2_T image, UArray2_T seen, int connectivity, int col, int row,
+           int label, Component *c, int *stack);
+
+static const Pattern patterns[] = {
+        { "noise",   fill_noise },
+        { "speckle", fill_speckle },
+        { "blobs",   fill_blobs },
+};
+static const int NUM_PATTERNS = sizeof(patterns) / sizeof(patterns[0]);
+
+int main(int argc, char *argv[])
+{
+        int width = 4096;
+        int height = 4096;
+        int rounds = 3;
+        if (argc > 2) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        }
+        if (argc > 3) {
+                rounds = atoi(argv[3]);
+        }
+        if (argc == 2 || argc > 4 || width <= 0 || height <= 0 ||
+            rounds <= 0) {
+                fprintf(stderr, "Usage: %s [width height [rounds]]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+        double mpixels = (double)width * height / 1e6;
+
+        printf("%dx%d, best of %d rounds\n", width, height, rounds);
+        for (int p = 0; p < NUM_PATTERNS; p++) {
+                Bit2_T image = Bit2_new(width, height);
+                patterns[p].fill(image);
+                for (int connectivity = 4; connectivity <= 8;
+                     connectivity += 4) {
+                        double best_label = -1;
+                        double best_image = -1;
+                        Components_T comps = NULL;
+                        UArray2_T labels = NULL;
+                        for (int r = 0; r < rounds; r++) {
+                                if (comps != NULL) {
+                                        Components_free(&comps);
+                                        UArray2_free(&labels);
+                                }
+                                double start = Bench_now();
+                                comps = Components_label(image,
+                                                         connectivity);
+                                double middle = Bench_now();
+                                labels = Components_image(comps);
+                                double end = Bench_now();
+                                best_label = Bench_best(best_label,
+                                                        middle - start);
+                                best_image = Bench_best(best_image,
+                                                        end - middle);
+                        }
+                        printf("%-8s %d-conn %9d components  label "
+                               "%8.1f Mpx/s  image %8.1f Mpx/s  %s\n",
+                               patterns[p].name, connectivity,
+                               Components_count(comps),
+                               mpixels / best_label, mpixels / best_image,
+                               Bench_agrees(check_labels(image, comps,
+                                                         labels)));
+                        Components_free(&comps);
+                        UArray2_free(&labels);
+                }
+                Bit2_free(&image);
+        }
+        return EXIT_SUCCESS;
+}
+
+/* void fill_noise(Bit2_T image)
+ * Does: sets each bit of image to 0 or 1 at random
+ */
+void fill_noise(Bit2_T image)
+{
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        int width = Bit2_width(image);
+        for (int row = 0; row < Bit2_height(image); row++) {
+                for (int col = 0; col < width; col += 64) {
+                        int n = (width - col < 64) ? width - col : 64;
+                        Bit2_put_bits(image, col, row, Bench_random(&state),
+                                      n);
+                }
+        }
+}
+
+/* void fill_speckle(Bit2_T image)
+ * Does: sets about one bit in 50 of image to 1, at random
+ */
+void fill_speckle(Bit2_T image)
+{
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for (int row = 0; row < Bit2_height(image); row++) {
+                for (int col = 0; col < Bit2_width(image); col++) {
+                        if (Bench_random(&state) % 50 == 0) {
+                                Bit2_put(image, col, row, 1);
+                        }
+                }
+        }
+}
+
+/* void fill_blobs(Bit2_T image)
+ * Does: draws one random rectangle of 1 bits, up to 40 pixels a side, per
+ *       800 pixels of image
+ */
+void fill_blobs(Bit2_T image)
+{
+        uint64_t state = 0x853C49E6748FEA9BULL;
+        int width = Bit2_width(image);
+        int height = Bit2_height(image);
+        long count = (long)width * height / 800;
+        for (long i = 0; i < count; i++) {
+                int left = Bench_random(&state) % width;
+                int top = Bench_random(&state) % height;
+                int right = left + Bench_random(&state) % 40;
+                int bottom = top + Bench_random(&state) % 40;
+                Bit2_put_rect(image, left, top,
+                              right < width ? right : width - 1,
+                              bottom < height ? bottom : height - 1, 1);
+        }
+}
+
+/* int check_labels(Bit2_T image, Components_T comps, UArray2_T labels)
+ * Returns: 1 if labels and the stats of comps match a flood fill of image
+ *          with the same connectivity, else 0
+ */
+int check_labels(Bit2_T image, Components_T comps, UArray2_T labels)
+{
+        int width = Bit2_width(image);
+        int height = Bit2_height(image);
+        UArray2_T seen = UArray2_new(width, height, sizeof(int));
+        int *stack = malloc((size_t)width * height * 2 * sizeof(int));
+        if (stack == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        int ok = 1;
+        int label = 0;
+        for (int row = 0; row < height && ok; row++) {
+                for (int col = 0; col < width && ok; col++) {
+                        if (Bit2_get(image, col, row) == 0 ||
+                            *(int *)UArray2_at(seen, col, row) != 0) {
+                                continue;
+                        }
+                        Component c = { 0, col, row, col, row, 0 };
+                        label++;
+                        flood(image, seen, comps->connectivity, col, row,
+                              label, &c, stack);
+                        Component got = { 0, 0, 0, 0, 0, 0 };
+                        if (label <= Components_count(comps)) {
+                                got = Components_stats(comps, label);
+                        }
+                        ok = got.area == c.area && got.left == c.left &&
+                             got.top == c.top && got.right == c.right &&
+                             got.bottom == c.bottom &&
+                             got.border == c.border;
+                }
+        }
+        ok = ok && label == Components_count(comps);
+        for (int row = 0; row < height && ok; row++) {
+                for (int col = 0; col < width && ok; col++) {
+                        int want = *(int *)UArray2_at(seen, col, row);
+                        ok = *(int *)UArray2_at(labels, col, row) == want &&
+                             Components_at(comps, col, row) == want;
+                }
+        }
+        free(stack);
+        UArray2_free(&seen);
+        return ok;
+}
+
+/* void flood(Bit2_T image, UArray2_T seen, int connectivity, int col,
+ *            int row, int label, Component *c, int *stack)
+ * Does: marks every 1 bit of image connected to (col, row) with label in
+ *       seen, a pixel at a time, and grows c's area, bounding box and
+ *       border flag to cover them. stack has room for two ints per pixel
+ */
+void flood(Bit2_T image, UArray2_T seen, int connectivity, int col, int row,
+           int label, Component *c, int *stack)
+{
+        int width = Bit2_width(image);
+        int height = Bit2_height(image);
+        long length = 0;
+        *(int *)UArray2_at(seen, col, row) = label;
+        stack[length++] = col;
+        stack[length++] = row;
+        while (length > 0) {
+                int y = stack[--length];
+                int x = stack[--length];
+                c->area++;
+                c->left = x < c->left ? x : c->left;
+                c->right = x > c->right ? x : c->right;
+                c->top = y < c->top ? y : c->top;
+                c->bottom = y > c->bottom ? y : c->bottom;
+                if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+                        c->border = 1;
+                }
+                for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                                int nx = x + dx;
+                                int ny = y + dy;
+                                if ((dx == 0 && dy == 0) ||
+                                    (connectivity == 4 && dx != 0 &&
+                                     dy != 0) ||
+                                    nx < 0 || ny < 0 || nx >= width ||
+                                    ny >= height ||
+                                    Bit2_get(image, nx, ny) == 0) {
+                                        continue;
+                                }
+                                int *mark = UArray2_at(seen, nx, ny);
+                                if (*mark == 0) {
+                                        *mark = label;
+                                        stack[length++] = nx;
+                                        stack[length++] = ny;
+                                }
+                        }
+                }
+        }
+}
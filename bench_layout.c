@@ -0,0 +1,208 @@
+/*
+ * Filename: bench_layout.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the UArray2 storage layouts. Fills a large array
+ *          of ints the same way in each layout (UARRAY2_ROW_MAJOR and
+ *          UARRAY2_TILED) and times three kernels: the four-neighbor
+ *          probe of is_black_edge through UArray2_at_unchecked at centers
+ *          drawn at random ahead of time, the same probe along a random
+ *          walk that moves one step at a time the way a flood fill does,
+ *          and a plain UArray2_map_row_major sum for what the layout costs
+ *          a sweep. Reports ns per center (or per element swept) and
+ *          checks that every layout gives the same result.
+ *
+ * Usage: bench_layout [width height [rounds]]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "uarray2.h"
+#include "bench_util.h"
+
+#define NCENTERS (1 << 22)
+
+uint64_t probe_random(UArray2_T array, const int *cols, const int *rows,
+                      int n);
+uint64_t probe_walk(UArray2_T array, int n, uint64_t seed);
+uint64_t sweep(UArray2_T array);
+uint64_t neighbors(UArray2_T array, int col, int row);
+void add_element(int col, int row, UArray2_T a, void *p1, void *cl);
+void report(const char *name, double seconds, double count, uint64_t result,
+            uint64_t reference);
+
+int main(int argc, char *argv[])
+{
+        int width = 8192;
+        int height = 8192;
+        int rounds = 3;
+        if (argc > 2) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        }
+        if (argc > 3) {
+                rounds = atoi(argv[3]);
+        }
+        if (argc == 2 || argc > 4 || width < 3 || height < 3 ||
+            rounds <= 0) {
+                fprintf(stderr, "Usage: %s [width height [rounds]]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        /* interior centers, so all four neighbors exist */
+        int *cols = malloc(NCENTERS * sizeof(int));
+        int *rows = malloc(NCENTERS * sizeof(int));
+        if (cols == NULL || rows == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                return EXIT_FAILURE;
+        }
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < NCENTERS; i++) {
+                cols[i] = 1 + Bench_random(&state) % (width - 2);
+                rows[i] = 1 + Bench_random(&state) % (height - 2);
+        }
+
+        const int layouts[] = { UARRAY2_ROW_MAJOR, UARRAY2_TILED };
+        const char *names[] = { "row major", "tiled" };
+        uint64_t reference[3] = { 0, 0, 0 };
+        printf("%dx%d ints, %d centers, best of %d rounds\n", width, height,
+               NCENTERS, rounds);
+        for (int l = 0; l < 2; l++) {
+                UArray2_T array = UArray2_new_layout(width, height,
+                                                     sizeof(int),
+                                                     layouts[l]);
+                for (int row = 0; row < height; row++) {
+                        for (int col = 0; col < width; col++) {
+                                *(int *)UArray2_at_unchecked(array, col, row) =
+                                        (row * 31) ^ col;
+                        }
+                }
+                for (int kernel = 0; kernel < 3; kernel++) {
+                        double best = -1;
+                        uint64_t result = 0;
+                        for (int r = 0; r < rounds; r++) {
+                                double start = Bench_now();
+                                if (kernel == 0) {
+                                        result = probe_random(array, cols,
+                                                              rows,
+                                                              NCENTERS);
+                                } else if (kernel == 1) {
+                                        result = probe_walk(array, NCENTERS,
+                                                            state);
+                                } else {
+                                        result = sweep(array);
+                                }
+                                double elapsed = Bench_now() - start;
+                                best = Bench_best(best, elapsed);
+                        }
+                        if (l == 0) {
+                                reference[kernel] = result;
+                        }
+                        const char *kernels[] = {
+                                "random probe", "walk probe", "sweep"
+                        };
+                        char name[48];
+                        snprintf(name, sizeof(name), "%-9s %s", names[l],
+                                 kernels[kernel]);
+                        report(name, best, kernel == 2 ? (double)width *
+                               height : NCENTERS, result,
+                               reference[kernel]);
+                }
+                UArray2_free(&array);
+        }
+        free(cols);
+        free(rows);
+        return EXIT_SUCCESS;
+}
+
+/* uint64_t probe_random(UArray2_T array, const int *cols, const int *rows,
+ *                       int n)
+ * Returns: the sum of the four neighbors of each of the n listed centers
+ */
+uint64_t probe_random(UArray2_T array, const int *cols, const int *rows,
+                      int n)
+{
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+                sum += neighbors(array, cols[i], rows[i]);
+        }
+        return sum;
+}
+
+/* uint64_t probe_walk(UArray2_T array, int n, uint64_t seed)
+ * Returns: the sum of the four neighbors of each of n centers visited by
+ *          a random walk from the middle of array that moves one element
+ *          up, down, left or right at each step and stays in the interior
+ */
+uint64_t probe_walk(UArray2_T array, int n, uint64_t seed)
+{
+        int width = UArray2_width(array);
+        int height = UArray2_height(array);
+        int col = width / 2;
+        int row = height / 2;
+        uint64_t sum = 0;
+        uint64_t bits = 0;
+        for (int i = 0; i < n; i++) {
+                if (i % 32 == 0) {
+                        bits = Bench_random(&seed);
+                }
+                switch (bits & 3) {
+                case 0: col = col + 1 < width - 1 ? col + 1 : col - 1; break;
+                case 1: col = col - 1 > 0 ? col - 1 : col + 1; break;
+                case 2: row = row + 1 < height - 1 ? row + 1 : row - 1; break;
+                default: row = row - 1 > 0 ? row - 1 : row + 1; break;
+                }
+                bits >>= 2;
+                sum += neighbors(array, col, row);
+        }
+        return sum;
+}
+
+/* uint64_t sweep(UArray2_T array)
+ * Returns: the sum of every element, through UArray2_map_row_major
+ */
+uint64_t sweep(UArray2_T array)
+{
+        uint64_t sum = 0;
+        UArray2_map_row_major(array, add_element, &sum);
+        return sum;
+}
+
+/* uint64_t neighbors(UArray2_T array, int col, int row)
+ * Returns: the sum of the four elements next to (col, row), which must
+ *          not be on the edge of array
+ */
+uint64_t neighbors(UArray2_T array, int col, int row)
+{
+        return (uint64_t)*(int *)UArray2_at_unchecked(array, col - 1, row) +
+               *(int *)UArray2_at_unchecked(array, col + 1, row) +
+               *(int *)UArray2_at_unchecked(array, col, row - 1) +
+               *(int *)UArray2_at_unchecked(array, col, row + 1);
+}
+
+/* void add_element(int col, int row, UArray2_T a, void *p1, void *cl)
+ * Does: Adds the element p1 to the uint64_t sum cl
+ */
+void add_element(int col, int row, UArray2_T a, void *p1, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) a;
+        *(uint64_t *)cl += *(int *)p1;
+}
+
+/* void report(const char *name, double seconds, double count,
+ *             uint64_t result, uint64_t reference)
+ * Does: Prints one result line, flagging a result that differs from the
+ *       row major layout's
+ */
+void report(const char *name, double seconds, double count, uint64_t result,
+            uint64_t reference)
+{
+        printf("%-24s %8.2f ns/op %8.1f Mops/s  %s\n", name,
+               seconds * 1e9 / count, count / seconds / 1e6,
+               Bench_agrees(result == reference));
+}
@@ -0,0 +1,357 @@
+/*
+ * Filename: bench_map.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the UArray2 map functions on a large array of
+ *          ints. Two kernels, a sum of every element and an in place
+ *          affine transform (x = 3x + 1), are run through
+ *          UArray2_map_row_major, which calls back once per element, and
+ *          through UArray2_map_rows, which calls back once per row with a
+ *          plain int array the compiler can vectorize, and the transform
+ *          also through UArray2_map_parallel on the workpool's threads
+ *          (one per processor unless given). Reports ns per element and
+ *          checks that they all give the same result.
+ *
+ *          Then the traversal orders: the sum is taken with
+ *          UArray2_map_col_major, with UArray2_map_blocked at a few block
+ *          sizes, and with UArray2_map_row_major as the lower bound, and
+ *          the same is done for counting the set bits of a Bit2_T of the
+ *          same size with the Bit2 maps.
+ *
+ * Usage: bench_map [width height [rounds [threads]]]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "uarray2.h"
+#include "bit2.h"
+#include "workpool.h"
+#include "bench_util.h"
+
+typedef struct Mapper {
+        const char *name;
+        uint64_t (*run)(UArray2_T array); /* result, or 0 if it writes */
+        int writes; /* 1 if the result is the array's checksum after run */
+        int first; /* 1 if the result is the reference for those after it */
+} Mapper;
+
+uint64_t sum_elements(UArray2_T array);
+uint64_t sum_rows(UArray2_T array);
+uint64_t scale_elements(UArray2_T array);
+uint64_t scale_rows(UArray2_T array);
+uint64_t scale_parallel(UArray2_T array);
+void add_element(int col, int row, UArray2_T a, void *p1, void *cl);
+void add_row(int row, UArray2_T a, void *elems, int length, void *cl);
+void scale_element(int col, int row, UArray2_T a, void *p1, void *cl);
+void scale_row(int row, UArray2_T a, void *elems, int length, void *cl);
+uint64_t checksum(UArray2_T array);
+void report_orders(UArray2_T array, int rounds);
+void report_bit_orders(int width, int height, int rounds);
+void count_bit(int col, int row, Bit2_T a, int bit, void *cl);
+void report(const char *name, double seconds, double cells, uint64_t result,
+            uint64_t reference);
+
+/* block sizes tried with the blocked maps; 0 is the default */
+static const int blocks[] = { 8, 0, 128 };
+static const int NUM_BLOCKS = sizeof(blocks) / sizeof(blocks[0]);
+
+/* each kernel per element first */
+static const Mapper mappers[] = {
+        { "sum   map_row_major", sum_elements,   0, 1 },
+        { "sum   map_rows",      sum_rows,       0, 0 },
+        { "scale map_row_major", scale_elements, 1, 1 },
+        { "scale map_rows",      scale_rows,     1, 0 },
+        { "scale map_parallel",  scale_parallel, 1, 0 },
+};
+static const int NUM_MAPPERS = sizeof(mappers) / sizeof(mappers[0]);
+
+int main(int argc, char *argv[])
+{
+        int width = 8192;
+        int height = 8192;
+        int rounds = 3;
+        int threads = 0;
+        if (argc > 2) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        }
+        if (argc > 3) {
+                rounds = atoi(argv[3]);
+        }
+        if (argc > 4) {
+                threads = atoi(argv[4]);
+        }
+        if (argc == 2 || argc > 5 || width <= 0 || height <= 0 ||
+            rounds <= 0 || threads < 0) {
+                fprintf(stderr, "Usage: %s [width height [rounds "
+                        "[threads]]]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        threads = Workpool_start(threads);
+
+        UArray2_T array = UArray2_new(width, height, sizeof(int));
+        double cells = (double)width * height;
+        printf("%dx%d ints, best of %d rounds, %d threads\n", width, height,
+               rounds, threads);
+        uint64_t reference = 0;
+        for (int m = 0; m < NUM_MAPPERS; m++) {
+                double best = -1;
+                uint64_t result = 0;
+                for (int r = 0; r < rounds; r++) {
+                        /* every round starts from the same contents */
+                        for (int row = 0; row < height; row++) {
+                                int *elems = UArray2_row(array, row);
+                                for (int col = 0; col < width; col++) {
+                                        elems[col] = row ^ col;
+                                }
+                        }
+                        double start = Bench_now();
+                        result = mappers[m].run(array);
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                        if (mappers[m].writes) {
+                                result = checksum(array);
+                        }
+                }
+                if (mappers[m].first) {
+                        reference = result;
+                }
+                report(mappers[m].name, best, cells, result, reference);
+        }
+        report_orders(array, rounds);
+        UArray2_free(&array);
+        report_bit_orders(width, height, rounds);
+        return EXIT_SUCCESS;
+}
+
+/* uint64_t sum_elements(UArray2_T array)
+ * Returns: the sum of every element, one callback per element
+ */
+uint64_t sum_elements(UArray2_T array)
+{
+        uint64_t sum = 0;
+        UArray2_map_row_major(array, add_element, &sum);
+        return sum;
+}
+
+/* uint64_t sum_rows(UArray2_T array)
+ * Returns: the sum of every element, one callback per row
+ */
+uint64_t sum_rows(UArray2_T array)
+{
+        uint64_t sum = 0;
+        UArray2_map_rows(array, add_row, &sum);
+        return sum;
+}
+
+/* uint64_t scale_elements(UArray2_T array)
+ * Returns: 0
+ * Does: x = 3x + 1 on every element, one callback per element
+ */
+uint64_t scale_elements(UArray2_T array)
+{
+        UArray2_map_row_major(array, scale_element, NULL);
+        return 0;
+}
+
+/* uint64_t scale_rows(UArray2_T array)
+ * Returns: 0
+ * Does: x = 3x + 1 on every element, one callback per row
+ */
+uint64_t scale_rows(UArray2_T array)
+{
+        UArray2_map_rows(array, scale_row, NULL);
+        return 0;
+}
+
+/* uint64_t scale_parallel(UArray2_T array)
+ * Returns: 0
+ * Does: x = 3x + 1 on every element, one callback per element, across
+ *       the workpool's threads
+ */
+uint64_t scale_parallel(UArray2_T array)
+{
+        UArray2_map_parallel(array, scale_element, NULL);
+        return 0;
+}
+
+/* void add_element(int col, int row, UArray2_T a, void *p1, void *cl)
+ * Does: Adds the element p1 to the uint64_t sum cl
+ */
+void add_element(int col, int row, UArray2_T a, void *p1, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) a;
+        *(uint64_t *)cl += *(int *)p1;
+}
+
+/* void add_row(int row, UArray2_T a, void *elems, int length, void *cl)
+ * Does: Adds the length ints at elems to the uint64_t sum cl
+ */
+void add_row(int row, UArray2_T a, void *elems, int length, void *cl)
+{
+        (void) row;
+        (void) a;
+        const int *cells = elems;
+        uint64_t sum = 0;
+        for (int col = 0; col < length; col++) {
+                sum += cells[col];
+        }
+        *(uint64_t *)cl += sum;
+}
+
+/* void scale_element(int col, int row, UArray2_T a, void *p1, void *cl)
+ * Does: Sets the element p1 to 3 * p1 + 1
+ */
+void scale_element(int col, int row, UArray2_T a, void *p1, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) a;
+        (void) cl;
+        int *cell = p1;
+        *cell = 3 * *cell + 1;
+}
+
+/* void scale_row(int row, UArray2_T a, void *elems, int length, void *cl)
+ * Does: Sets each of the length ints at elems to 3x + 1
+ */
+void scale_row(int row, UArray2_T a, void *elems, int length, void *cl)
+{
+        (void) row;
+        (void) a;
+        (void) cl;
+        int *cells = elems;
+        for (int col = 0; col < length; col++) {
+                cells[col] = 3 * cells[col] + 1;
+        }
+}
+
+/* uint64_t checksum(UArray2_T array)
+ * Returns: a position dependent hash of the contents
+ */
+uint64_t checksum(UArray2_T array)
+{
+        uint64_t hash = 0;
+        for (int row = 0; row < UArray2_height(array); row++) {
+                const int *elems = UArray2_row(array, row);
+                for (int col = 0; col < UArray2_width(array); col++) {
+                        hash = hash * 31 + (unsigned)elems[col];
+                }
+        }
+        return hash;
+}
+
+/* void report_orders(UArray2_T array, int rounds)
+ * Does: Times the sum of array in column major, blocked and row major
+ *       order; the column major sum is the reference
+ */
+void report_orders(UArray2_T array, int rounds)
+{
+        double cells = (double)UArray2_width(array) * UArray2_height(array);
+        uint64_t reference = 0;
+        for (int order = 0; order < NUM_BLOCKS + 2; order++) {
+                double best = -1;
+                uint64_t sum = 0;
+                char name[32];
+                for (int r = 0; r < rounds; r++) {
+                        sum = 0;
+                        double start = Bench_now();
+                        if (order == 0) {
+                                UArray2_map_col_major(array, add_element,
+                                                      &sum);
+                        } else if (order <= NUM_BLOCKS) {
+                                UArray2_map_blocked(array, blocks[order - 1],
+                                                    add_element, &sum);
+                        } else {
+                                UArray2_map_row_major(array, add_element,
+                                                      &sum);
+                        }
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                if (order == 0) {
+                        reference = sum;
+                        snprintf(name, sizeof(name), "map_col_major");
+                } else if (order <= NUM_BLOCKS) {
+                        snprintf(name, sizeof(name), "map_blocked %d",
+                                 blocks[order - 1]);
+                } else {
+                        snprintf(name, sizeof(name), "map_row_major");
+                }
+                report(name, best, cells, sum, reference);
+        }
+}
+
+/* void report_bit_orders(int width, int height, int rounds)
+ * Does: Times counting the set bits of a width x height Bit2_T in column
+ *       major, blocked and row major order
+ */
+void report_bit_orders(int width, int height, int rounds)
+{
+        Bit2_T bits = Bit2_new(width, height);
+        for (int row = 0; row < height; row++) {
+                for (int col = 0; col < width; col++) {
+                        Bit2_put(bits, col, row, (row * 7 ^ col) % 3 == 0);
+                }
+        }
+        double cells = (double)width * height;
+        uint64_t reference = 0;
+        for (int order = 0; order < NUM_BLOCKS + 2; order++) {
+                double best = -1;
+                uint64_t count = 0;
+                char name[32];
+                for (int r = 0; r < rounds; r++) {
+                        count = 0;
+                        double start = Bench_now();
+                        if (order == 0) {
+                                Bit2_map_col_major(bits, count_bit, &count);
+                        } else if (order <= NUM_BLOCKS) {
+                                Bit2_map_blocked(bits, blocks[order - 1],
+                                                 count_bit, &count);
+                        } else {
+                                Bit2_map_row_major(bits, count_bit, &count);
+                        }
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                if (order == 0) {
+                        reference = count;
+                        snprintf(name, sizeof(name), "Bit2 map_col_major");
+                } else if (order <= NUM_BLOCKS) {
+                        snprintf(name, sizeof(name), "Bit2 map_blocked %d",
+                                 blocks[order - 1]);
+                } else {
+                        snprintf(name, sizeof(name), "Bit2 map_row_major");
+                }
+                report(name, best, cells, count, reference);
+        }
+        Bit2_free(&bits);
+}
+
+/* void count_bit(int col, int row, Bit2_T a, int bit, void *cl)
+ * Does: Adds bit to the uint64_t count cl
+ */
+void count_bit(int col, int row, Bit2_T a, int bit, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) a;
+        *(uint64_t *)cl += bit;
+}
+
+/* void report(const char *name, double seconds, double cells,
+ *             uint64_t result, uint64_t reference)
+ * Does: Prints one result line, flagging a result that differs from the
+ *       reference
+ */
+void report(const char *name, double seconds, double cells, uint64_t result,
+            uint64_t reference)
+{
+        printf("%-22s %8.3f ns/element %8.1f Melements/s  %s\n", name,
+               seconds * 1e9 / cells, cells / seconds / 1e6,
+               Bench_agrees(result == reference));
+}
@@ -0,0 +1,138 @@
+/*
+ * Filename: bench_pnmread.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for pnmread input. Parses each pnm file both through
+ *          an mmap of the file and through the fread streaming fallback, and
+ *          reports the best of a few runs in megabytes per second. With no
+ *          arguments a synthetic raw pbm scan is written to a temporary file
+ *          and used instead.
+ *
+ * Usage: bench_pnmread [file.pnm ...]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "pnmread.h"
+#include "pbm.h"
+#include "bench_util.h"
+
+#define RUNS 3
+
+typedef struct Mode {
+        const char *name;
+        Pnmread_T (*open)(FILE *fp);
+} Mode;
+
+static const Mode modes[] = {
+        { "mmap",   Pnmread_new },
+        { "stream", Pnmread_new_stream },
+};
+static const int NUM_MODES = sizeof(modes) / sizeof(modes[0]);
+
+void bench_file(FILE *fp, const char *name);
+void parse_all(Pnmread_T rdr);
+FILE *synthetic_scan(int width, int height);
+
+int main(int argc, char *argv[])
+{
+        if (argc == 1) {
+                FILE *fp = synthetic_scan(16384, 16384);
+                bench_file(fp, "synthetic-16384x16384.pbm");
+                fclose(fp);
+                return EXIT_SUCCESS;
+        }
+        for (int i = 1; i < argc; i++) {
+                FILE *fp = fopen(argv[i], "rb");
+                if (fp == NULL) {
+                        fprintf(stderr, "Error: unable to open %s\n", argv[i]);
+                        return EXIT_FAILURE;
+                }
+                bench_file(fp, argv[i]);
+                fclose(fp);
+        }
+        return EXIT_SUCCESS;
+}
+
+/* void bench_file(FILE *fp, const char *name)
+ * Parameters: [FILE *fp] - opened regular file holding one pnm image
+ *             [const char *name] - name printed with the results
+ *    Returns: Nothing
+ *       Does: Times a full parse of the file in each mode and prints MB/s
+ */
+void bench_file(FILE *fp, const char *name)
+{
+        fseek(fp, 0, SEEK_END);
+        double mbytes = ftell(fp) / 1e6;
+        for (int m = 0; m < NUM_MODES; m++) {
+                double best = -1;
+                for (int r = 0; r < RUNS; r++) {
+                        rewind(fp);
+                        double start = Bench_now();
+                        Pnmread_T rdr = modes[m].open(fp);
+                        parse_all(rdr);
+                        Pnmread_free(&rdr);
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                printf("%-28s %-6s %9.1f MB %9.2f ms %9.1f MB/s\n", name, 
+                       modes[m].name, mbytes, best * 1e3, mbytes / best);
+        }
+}
+
+/* void parse_all(Pnmread_T rdr)
+ * Parameters: [Pnmread_T rdr] - reader positioned after the header
+ *    Returns: Nothing
+ *       Does: Decodes every pixel, into a Bit2_T for a pbm or one value at a
+ *             time for a pgm
+ */
+void parse_all(Pnmread_T rdr)
+{
+        if (rdr->format == 1 || rdr->format == 4) {
+                Bit2_T img_map = Pbm_read(rdr);
+                Bit2_free(&img_map);
+                return;
+        }
+        size_t samples = (size_t)rdr->width * rdr->height;
+        if (rdr->format == 3 || rdr->format == 6) {
+                samples *= 3;
+        }
+        unsigned sum = 0;
+        for (size_t i = 0; i < samples; i++) {
+                sum += Pnmread_pixel(rdr);
+        }
+        /* keeps the loop from being optimized away */
+        if (sum == 1) {
+                printf(" ");
+        }
+}
+
+/* FILE *synthetic_scan(int width, int height)
+ * Parameters: [int width], [int height] - size of the image
+ *    Returns: a temporary file holding a raw pbm of pseudo random pixels
+ */
+FILE *synthetic_scan(int width, int height)
+{
+        FILE *fp = tmpfile();
+        if (fp == NULL) {
+                fprintf(stderr, "Error: unable to create temporary file\n");
+                exit(EXIT_FAILURE);
+        }
+        fprintf(fp, "P4\n# synthetic scan\n%d %d\n", width, height);
+        size_t row_bytes = ((size_t)width + 7) / 8;
+        unsigned char *row = malloc(row_bytes);
+        uint64_t state = 88172645463325252ULL;
+        for (int j = 0; j < height; j++) {
+                for (size_t i = 0; i < row_bytes; i++) {
+                        state ^= state << 13;
+                        state ^= state >> 7;
+                        state ^= state << 17;
+                        row[i] = (unsigned char)state;
+                }
+                fwrite(row, 1, row_bytes, fp);
+        }
+        free(row);
+        fflush(fp);
+        return fp;
+}
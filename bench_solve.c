@@ -0,0 +1,136 @@
+/*
+ * Filename: bench_solve.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the sudoku solver behind sudoku -s. Solves a set
+ *          of well known hard puzzles (few givens, or built to defeat
+ *          simple propagation) rounds times each, timing every solve on its
+ *          own, checks that every answer is a valid sudoku that keeps the
+ *          puzzle's givens, and reports solves per second along with the
+ *          median, 99th percentile and worst solve latency.
+ *
+ * Usage: bench_solve [rounds]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "uarray2.h"
+#include "sudokucheck.h"
+#include "sudokusolve.h"
+#include "bench_util.h"
+
+/* hard puzzles, row major, '.' for an empty cell */
+static const char *puzzles[] = {
+        "8..........36......7..9.2...5...7.......457.....1...3."
+        "..1....68..85...1..9....4..",
+        "1....7.9..3..2...8..96..5....53..9...1..8...26....4..."
+        "3......1..4......7..7...3..",
+        "...8.1..........435............7.8........1...2..3...."
+        "6......75..34........2..6..",
+        "1.......2.9.4...5...6...7...5.9.3.......7.......85..4."
+        "7.....6...3...9.8...2.....1",
+        "4.....8.5.3..........7......2.....6.....8.4......1...."
+        "...6.3.7.5..2.....1.4......",
+        "52...6.........7.13...........4..8..6......5.........."
+        ".418.........3..2...87.....",
+        "6.....8.3.4.7.................5.4.7.3..2.....1.6......"
+        ".2.....5.....8.6......1....",
+        "48.3............71.2.......7.5....6....2..8..........."
+        "..1.76...3.....4......5....",
+        "....14....3....2...7..........9...3.6.1.............8."
+        "2.....1.4....5.6.....7.8...",
+        ".......1.4.........2...........5.4.7..8...3....1.9...."
+        "3..4..2...5.1........8.6...",
+};
+static const int NUM_PUZZLES = sizeof(puzzles) / sizeof(puzzles[0]);
+
+void load_puzzle(UArray2_T board, const char *puzzle);
+int keeps_givens(UArray2_T board, const char *puzzle);
+int compare_doubles(const void *a, const void *b);
+
+int main(int argc, char *argv[])
+{
+        int rounds = 200;
+        if (argc > 1) {
+                rounds = atoi(argv[1]);
+        }
+        if (argc > 2 || rounds <= 0) {
+                fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        int nsolves = rounds * NUM_PUZZLES;
+        double *latency = malloc(nsolves * sizeof(double));
+        if (latency == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                return EXIT_FAILURE;
+        }
+        UArray2_T board = UArray2_new(9, 9, sizeof(int));
+
+        double total = 0;
+        for (int round = 0; round < rounds; round++) {
+                for (int p = 0; p < NUM_PUZZLES; p++) {
+                        load_puzzle(board, puzzles[p]);
+                        double start = Bench_now();
+                        int solved = solve_board(board);
+                        double elapsed = Bench_now() - start;
+                        if (!solved || !check_board_mask(board) ||
+                            !keeps_givens(board, puzzles[p])) {
+                                fprintf(stderr, "Error: puzzle %d was not "
+                                        "solved correctly\n", p);
+                                return EXIT_FAILURE;
+                        }
+                        latency[round * NUM_PUZZLES + p] = elapsed;
+                        total += elapsed;
+                }
+        }
+
+        qsort(latency, nsolves, sizeof(double), compare_doubles);
+        printf("%d puzzles x %d rounds\n", NUM_PUZZLES, rounds);
+        printf("%10.0f solves/s\n", nsolves / total);
+        printf("%10.1f us mean\n", total / nsolves * 1e6);
+        printf("%10.1f us p50\n", latency[nsolves / 2] * 1e6);
+        printf("%10.1f us p99\n", latency[(int)(nsolves * 0.99)] * 1e6);
+        printf("%10.1f us max\n", latency[nsolves - 1] * 1e6);
+
+        UArray2_free(&board);
+        free(latency);
+        return EXIT_SUCCESS;
+}
+
+/* void load_puzzle(UArray2_T board, const char *puzzle)
+ * Does: Copies the 81 character puzzle into board, '.' becoming 0
+ */
+void load_puzzle(UArray2_T board, const char *puzzle)
+{
+        for (int i = 0; i < 81; i++) {
+                *(int *)UArray2_at(board, i % 9, i / 9) =
+                        puzzle[i] == '.' ? 0 : puzzle[i] - '0';
+        }
+}
+
+/* int keeps_givens(UArray2_T board, const char *puzzle)
+ * Returns: 1 if every given of the puzzle is unchanged on board, else 0
+ */
+int keeps_givens(UArray2_T board, const char *puzzle)
+{
+        for (int i = 0; i < 81; i++) {
+                if (puzzle[i] != '.' &&
+                    *(int *)UArray2_at(board, i % 9, i / 9) !=
+                    puzzle[i] - '0') {
+                        return 0;
+                }
+        }
+        return 1;
+}
+
+/* int compare_doubles(const void *a, const void *b)
+ * Does: qsort comparison putting doubles in increasing order
+ */
+int compare_doubles(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
@@ -0,0 +1,324 @@
+/*
+ * Filename: bench_sudoku.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the sudoku validators. Builds a corpus of random
+ *          9x9 boards in memory, half of them solved sudokus and half broken
+ *          in one of several ways (two cells of a row swapped, one cell
+ *          overwritten with a neighbor, a cell outside 1-9, or a latin
+ *          square whose rows and columns are fine but whose submaps are
+ *          not), runs every validator over the whole corpus, checks that
+ *          they all agree with the original validator on every board, and
+ *          reports nanoseconds and boards per second.
+ *
+ *          The corpus is then copied into 32-board Boards_T batches, and 
+ *          every batch kernel this machine supports (scalar, SSE2, AVX2) is
+ *          timed and checked the same way.
+ *
+ *          Last, both validators are timed on solved boards of the other
+ *          sizes, 16x16 and 25x25 (which have kernels of their own) and
+ *          36x36 and 49x49 (which do not), in ns per board and per cell.
+ *
+ * Usage: bench_sudoku [boards [rounds]]
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "uarray2.h"
+#include "sudokucheck.h"
+#include "boards.h"
+#include "bench_util.h"
+
+typedef struct Validator {
+        const char *name;
+        int (*check)(UArray2_T board);
+} Validator;
+
+int check_classic(UArray2_T board);
+
+/* the first validator is the reference every other one is checked against */
+static const Validator validators[] = {
+        { "classic", check_classic },
+        { "mask",    check_board_mask },
+};
+static const int NUM_VALIDATORS = sizeof(validators) / sizeof(validators[0]);
+
+/* scratch space for the classic validator, allocated once like batch mode */
+static UArray2_T check_arr;
+
+void report_batches(UArray2_T *boards, const char *expected, int nboards,
+                    int rounds);
+void report_sizes(int rounds);
+void fill_solved(UArray2_T board, uint64_t *state);
+void break_board(UArray2_T board, int kind, uint64_t *state);
+void shuffle(int *values, int n, uint64_t *state);
+
+int main(int argc, char *argv[])
+{
+        int nboards = 100000;
+        int rounds = 5;
+        if (argc > 1) {
+                nboards = atoi(argv[1]);
+        }
+        if (argc > 2) {
+                rounds = atoi(argv[2]);
+        }
+        if (argc > 3 || nboards <= 0 || rounds <= 0) {
+                fprintf(stderr, "Usage: %s [boards [rounds]]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        check_arr = UArray2_new(9, 1, sizeof(int));
+        UArray2_T *boards = malloc(nboards * sizeof(UArray2_T));
+        char *expected = malloc(nboards);
+        if (boards == NULL || expected == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                return EXIT_FAILURE;
+        }
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < nboards; i++) {
+                boards[i] = UArray2_new(9, 9, sizeof(int));
+                fill_solved(boards[i], &state);
+                /* odd boards are broken, cycling through the four kinds */
+                if (i % 2 == 1) {
+                        break_board(boards[i], (i / 2) % 4, &state);
+                }
+                expected[i] = validators[0].check(boards[i]);
+        }
+
+        for (int v = 0; v < NUM_VALIDATORS; v++) {
+                int mismatches = 0;
+                int valid = 0;
+                double best = -1;
+                for (int r = 0; r < rounds; r++) {
+                        double start = Bench_now();
+                        for (int i = 0; i < nboards; i++) {
+                                int result = validators[v].check(boards[i]);
+                                valid += result;
+                                mismatches += (result != expected[i]);
+                        }
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                printf("%-8s %d boards (%d valid) %8.1f ns/board "
+                       "%8.2f Mboards/s  %s\n", validators[v].name, nboards,
+                       valid / rounds, best * 1e9 / nboards,
+                       nboards / best / 1e6,
+                       v == 0 ? "reference" :
+                       Bench_agrees(mismatches == 0));
+        }
+
+        report_batches(boards, expected, nboards, rounds);
+        report_sizes(rounds);
+
+        for (int i = 0; i < nboards; i++) {
+                UArray2_free(&boards[i]);
+        }
+        free(boards);
+        free(expected);
+        UArray2_free(&check_arr);
+        return EXIT_SUCCESS;
+}
+
+/* int check_classic(UArray2_T board)
+ * Does: the original validator with the shared scratch space
+ */
+int check_classic(UArray2_T board)
+{
+        return check_board(board, check_arr);
+}
+
+/* void report_batches(UArray2_T *boards, const char *expected, int nboards,
+ *                     int rounds)
+ * Parameters: [UArray2_T *boards] - the corpus
+ *             [const char *expected] - the reference validator's answers
+ *             [int nboards] - number of boards in the corpus
+ *             [int rounds] - times each kernel is run, the best is kept
+ *    Returns: Nothing
+ *       Does: Loads the corpus into batches once, then times each supported
+ *             batch kernel over all of them, leaving the loading out of the
+ *             times
+ */
+void report_batches(UArray2_T *boards, const char *expected, int nboards,
+                    int rounds)
+{
+        int nbatches = (nboards + BOARDS_LANES - 1) / BOARDS_LANES;
+        Boards_T *batches = malloc(nbatches * sizeof(Boards_T));
+        if (batches == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        for (int b = 0; b < nbatches; b++) {
+                batches[b] = Boards_new();
+        }
+        for (int i = 0; i < nboards; i++) {
+                Boards_add(batches[i / BOARDS_LANES], boards[i]);
+        }
+
+        for (int k = BOARDS_SCALAR; k <= BOARDS_AVX2; k++) {
+                if (!Boards_supported(k)) {
+                        printf("batch-%-6s not supported on this machine\n",
+                               Boards_kernel_name(k));
+                        continue;
+                }
+                int mismatches = 0;
+                int valid = 0;
+                double best = -1;
+                for (int r = 0; r < rounds; r++) {
+                        double start = Bench_now();
+                        for (int b = 0; b < nbatches; b++) {
+                                uint32_t result = Boards_check_kernel(
+                                        batches[b], k);
+                                for (int lane = 0; lane < batches[b]->count;
+                                     lane++) {
+                                        int ok = (result >> lane) & 1;
+                                        valid += ok;
+                                        mismatches += (ok != expected[
+                                                b * BOARDS_LANES + lane]);
+                                }
+                        }
+                        double elapsed = Bench_now() - start;
+                        best = Bench_best(best, elapsed);
+                }
+                printf("batch-%-6s %d boards (%d valid) %8.1f ns/board "
+                       "%8.2f Mboards/s  %s\n", Boards_kernel_name(k), 
+                       nboards, valid / rounds, best * 1e9 / nboards,
+                       nboards / best / 1e6,
+                       Bench_agrees(mismatches == 0));
+        }
+
+        for (int b = 0; b < nbatches; b++) {
+                Boards_free(&batches[b]);
+        }
+        free(batches);
+}
+
+/* void report_sizes(int rounds)
+ * Parameters: [int rounds] - times each validator passes over the boards
+ *    Returns: Nothing
+ *       Does: Times both validators on solved boards of each larger size;
+ *             every board must come out valid
+ */
+void report_sizes(int rounds)
+{
+        enum { NBOARDS = 1000 };
+        static const int boxes[] = { 4, 5, 6, 7 };
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for (int b = 0; b < (int)(sizeof(boxes) / sizeof(boxes[0])); b++) {
+                int side = boxes[b] * boxes[b];
+                UArray2_T boards[NBOARDS];
+                for (int i = 0; i < NBOARDS; i++) {
+                        boards[i] = UArray2_new(side, side, sizeof(int));
+                        fill_solved(boards[i], &state);
+                }
+                UArray2_T scratch = UArray2_new(side, 1, sizeof(int));
+                for (int v = 0; v < NUM_VALIDATORS; v++) {
+                        int valid = 0;
+                        double best = -1;
+                        for (int r = 0; r < rounds; r++) {
+                                double start = Bench_now();
+                                for (int i = 0; i < NBOARDS; i++) {
+                                        valid += v == 0 ?
+                                                 check_board(boards[i],
+                                                             scratch) :
+                                                 validators[v].check(
+                                                         boards[i]);
+                                }
+                                double elapsed = Bench_now() - start;
+                                best = Bench_best(best, elapsed);
+                        }
+                        printf("%-8s %dx%d %d boards %10.1f ns/board "
+                               "%6.2f ns/cell  %s\n", validators[v].name,
+                               side, side, NBOARDS, best * 1e9 / NBOARDS,
+                               best * 1e9 / NBOARDS / (side * side),
+                               Bench_agrees(valid == NBOARDS * rounds));
+                }
+                UArray2_free(&scratch);
+                for (int i = 0; i < NBOARDS; i++) {
+                        UArray2_free(&boards[i]);
+                }
+        }
+}
+
+/* void fill_solved(UArray2_T board, uint64_t *state)
+ * Parameters: [UArray2_T board] - n*n by n*n board to fill
+ *             [uint64_t *state] - random number state
+ *    Returns: Nothing
+ *       Does: Writes a random solved sudoku: the standard shifted pattern
+ *             with its digits relabeled, its rows shuffled within each band
+ *             and its columns shuffled within each stack
+ */
+void fill_solved(UArray2_T board, uint64_t *state)
+{
+        int side = UArray2_width(board);
+        int box = sudoku_box_size(side, side, side);
+        int digits[side], rows[side], cols[side];
+        for (int i = 0; i < side; i++) {
+                digits[i] = i + 1;
+                rows[i] = i;
+                cols[i] = i;
+        }
+        shuffle(digits, side, state);
+        for (int band = 0; band < side; band += box) {
+                shuffle(rows + band, box, state);
+                shuffle(cols + band, box, state);
+        }
+        for (int row = 0; row < side; row++) {
+                for (int col = 0; col < side; col++) {
+                        int r = rows[row];
+                        int c = cols[col];
+                        int val = (box * (r % box) + r / box + c) % side;
+                        *(int *)UArray2_at(board, col, row) = digits[val];
+                }
+        }
+}
+
+/* void break_board(UArray2_T board, int kind, uint64_t *state)
+ * Parameters: [UArray2_T board] - a solved board
+ *             [int kind] - 0 swap two cells of a row, 1 copy a cell over
+ *                          its neighbor, 2 put a digit outside 1-9 in a
+ *                          cell, 3 replace the board with a latin square
+ *                          that only fails the submap check
+ *             [uint64_t *state] - random number state
+ *    Returns: Nothing
+ *       Does: Makes the board an invalid sudoku of the given kind
+ */
+void break_board(UArray2_T board, int kind, uint64_t *state)
+{
+        int row = Bench_random(state) % 9;
+        int col = Bench_random(state) % 9;
+        int *cell = UArray2_at(board, col, row);
+        if (kind == 0) {
+                int *other = UArray2_at(board, (col + 1 + Bench_random(state) %
+                                                8) % 9, row);
+                int tmp = *cell;
+                *cell = *other;
+                *other = tmp;
+        } else if (kind == 1) {
+                *cell = *(int *)UArray2_at(board, (col + 1) % 9, row);
+        } else if (kind == 2) {
+                *cell = (Bench_random(state) % 2) ? 0 : 10;
+        } else {
+                for (int r = 0; r < 9; r++) {
+                        for (int c = 0; c < 9; c++) {
+                                *(int *)UArray2_at(board, c, r) =
+                                        (r + c) % 9 + 1;
+                        }
+                }
+        }
+}
+
+/* void shuffle(int *values, int n, uint64_t *state)
+ * Does: Fisher-Yates shuffle of the n values
+ */
+void shuffle(int *values, int n, uint64_t *state)
+{
+        for (int i = n - 1; i > 0; i--) {
+                int j = Bench_random(state) % (i + 1);
+                int tmp = values[i];
+                values[i] = values[j];
+                values[j] = tmp;
+        }
+}
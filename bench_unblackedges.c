@@ -0,0 +1,324 @@
+/*
+ * Filename: bench_unblackedges.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Benchmark for the black edge removal engines. Builds large 
+ *          synthetic bitmaps in memory, runs every engine on its own copy of
+ *          each one, checks that every engine produced the same image as the
+ *          original breadth first search, and reports time and megapixels
+ *          per second. speckle's black edges are shallow, a few pixels in
+ *          from the border; border-noise's reach deep into a dense region
+ *          and spiral's are one long narrow path, the worst case for the
+ *          dilation engine, which needs a pass per tile the path crosses.
+ *
+ *          The parallel engine is then timed on the first image with 1, 2,
+ *          4, ... threads up to twice the processor count, to show how it
+ *          scales, and on a 10 pixel wide strip of it with up to 16
+ *          threads, where several strips' rows share each word.
+ *
+ *          Finally it reports the peak resident set size of each engine on each
+ *          image. Every measurement runs in a forked child, since a process's
+ *          peak RSS only ever grows; the "none" row is the child that builds
+ *          the image and runs no engine, so the rest of each row's peak is 
+ *          the engine's own working memory.
+ *
+ * Usage: bench_unblackedges [width height]
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "bit2.h"
+#include "blackedges.h"
+#include "paredges.h"
+#include "bench_util.h"
+
+typedef struct Engine {
+        const char *name;
+        void (*remove)(Bit2_T img_map);
+} Engine;
+
+/* the first engine is the reference every other engine is checked against */
+void remove_parallel(Bit2_T img_map);
+
+static const Engine engines[] = {
+        { "bfs",      remove_black_edges },
+        { "scanline", remove_black_edges_scanline },
+        { "parallel", remove_parallel },
+        { "dilate",   remove_black_edges_dilate },
+        { "label",    remove_black_edges_label },
+};
+static const int NUM_ENGINES = sizeof(engines) / sizeof(engines[0]);
+
+typedef struct Pattern {
+        const char *name;
+        void (*fill)(Bit2_T img_map);
+} Pattern;
+
+void fill_border_noise(Bit2_T img_map);
+void fill_speckle(Bit2_T img_map);
+void fill_spiral(Bit2_T img_map);
+void report_scaling(const Pattern *pattern, int width, int height,
+                    int max_threads);
+void report_peak_rss(const Pattern *pattern, const Engine *engine, 
+                     int width, int height);
+void no_engine(Bit2_T img_map);
+Bit2_T copy_map(Bit2_T img_map);
+int same_map(Bit2_T a, Bit2_T b);
+
+static const Pattern patterns[] = {
+        { "border-noise", fill_border_noise },
+        { "speckle",      fill_speckle },
+        { "spiral",       fill_spiral },
+};
+static const int NUM_PATTERNS = sizeof(patterns) / sizeof(patterns[0]);
+
+int main(int argc, char *argv[])
+{
+        int width = 4096;
+        int height = 4096;
+        if (argc == 3) {
+                width = atoi(argv[1]);
+                height = atoi(argv[2]);
+        } else if (argc != 1) {
+                fprintf(stderr, "Usage: %s [width height]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+        if (width < 3 || height < 3) {
+                fprintf(stderr, "Error: image must be at least 3x3\n");
+                return EXIT_FAILURE;
+        }
+        double mpixels = (double)width * height / 1e6;
+
+        for (int p = 0; p < NUM_PATTERNS; p++) {
+                Bit2_T original = Bit2_new(width, height);
+                patterns[p].fill(original);
+                Bit2_T reference = NULL;
+                for (int e = 0; e < NUM_ENGINES; e++) {
+                        Bit2_T img_map = copy_map(original);
+                        double start = Bench_now();
+                        engines[e].remove(img_map);
+                        double elapsed = Bench_now() - start;
+                        const char *check = "reference";
+                        if (reference == NULL) {
+                                reference = img_map;
+                        } else {
+                                check = same_map(reference, img_map) ? 
+                                        "identical" : "MISMATCH";
+                                Bit2_free(&img_map);
+                        }
+                        printf("%-14s %dx%d %-10s %9.2f ms %9.2f Mpx/s  %s\n",
+                               patterns[p].name, width, height, 
+                               engines[e].name, elapsed * 1e3, 
+                               mpixels / elapsed, check);
+                }
+                Bit2_free(&reference);
+                Bit2_free(&original);
+        }
+
+        report_scaling(&patterns[0], width, height,
+                       2 * paredges_default_threads());
+        report_scaling(&patterns[0], 10, height, 16);
+
+        static const Engine none = { "none", no_engine };
+        for (int p = 0; p < NUM_PATTERNS; p++) {
+                report_peak_rss(&patterns[p], &none, width, height);
+                for (int e = 0; e < NUM_ENGINES; e++) {
+                        report_peak_rss(&patterns[p], &engines[e], width, 
+                                        height);
+                }
+        }
+        return EXIT_SUCCESS;
+}
+
+/* void report_scaling(const Pattern *pattern, int width, int height,
+ *                     int max_threads)
+ * Parameters: [const Pattern *pattern] - image to draw
+ *             [int width], [int height] - size of the image
+ *             [int max_threads] - most threads to try
+ *    Returns: Nothing
+ *       Does: Times the parallel engine at 1, 2, 4, ... threads and prints
+ *             each time's speedup over one thread
+ */
+void report_scaling(const Pattern *pattern, int width, int height,
+                    int max_threads)
+{
+        Bit2_T original = Bit2_new(width, height);
+        pattern->fill(original);
+        Bit2_T reference = copy_map(original);
+        remove_black_edges_scanline(reference);
+        double single = 0;
+        for (int nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+                Bit2_T img_map = copy_map(original);
+                double start = Bench_now();
+                remove_black_edges_parallel(img_map, nthreads);
+                double elapsed = Bench_now() - start;
+                if (nthreads == 1) {
+                        single = elapsed;
+                }
+                printf("%-14s %dx%d parallel %3d threads %9.2f ms "
+                       "%6.2fx  %s\n", pattern->name, width, height, nthreads,
+                       elapsed * 1e3, single / elapsed, 
+                       same_map(reference, img_map) ? "identical" : 
+                                                      "MISMATCH");
+                Bit2_free(&img_map);
+        }
+        Bit2_free(&reference);
+        Bit2_free(&original);
+}
+
+/* void remove_parallel(Bit2_T img_map)
+ * Does: the parallel engine with one thread per processor
+ */
+void remove_parallel(Bit2_T img_map)
+{
+        remove_black_edges_parallel(img_map, 0);
+}
+
+/* void report_peak_rss(const Pattern *pattern, const Engine *engine,
+ *                      int width, int height)
+ * Parameters: [const Pattern *pattern] - image to draw
+ *             [const Engine *engine] - engine to run on it
+ *             [int width], [int height] - size of the image
+ *    Returns: Nothing
+ *       Does: Forks a child that draws the image, runs the engine and 
+ *             prints its own peak RSS, and waits for it
+ */
+void report_peak_rss(const Pattern *pattern, const Engine *engine, 
+                     int width, int height)
+{
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+                perror("fork");
+                exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+                Bit2_T img_map = Bit2_new(width, height);
+                pattern->fill(img_map);
+                engine->remove(img_map);
+                struct rusage usage;
+                getrusage(RUSAGE_SELF, &usage);
+                printf("%-14s %dx%d %-10s peak RSS %9.1f MB\n", 
+                       pattern->name, width, height, engine->name, 
+                       usage.ru_maxrss / 1024.0);
+                fflush(stdout);
+                _exit(EXIT_SUCCESS);
+        }
+        waitpid(pid, NULL, 0);
+}
+
+/* void no_engine(Bit2_T img_map)
+ * Does: nothing, for measuring the memory of the image by itself
+ */
+void no_engine(Bit2_T img_map)
+{
+        (void) img_map;
+}
+
+/* void fill_border_noise(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - empty bitmap to draw into
+ *    Returns: Nothing
+ *       Does: Draws a scanned page with thick border noise: a solid black
+ *             frame 1/20th of the page deep, and random noise dense enough 
+ *             (60% black) that most of it is connected to the frame
+ */
+void fill_border_noise(Bit2_T img_map)
+{
+        uint64_t state = 40;
+        int depth_x = img_map->width / 20;
+        int depth_y = img_map->height / 20;
+        for (int j = 0; j < img_map->height; j++) {
+                for (int i = 0; i < img_map->width; i++) {
+                        int frame = i < depth_x || j < depth_y ||
+                                    i >= img_map->width - depth_x || 
+                                    j >= img_map->height - depth_y;
+                        int noise = Bench_random(&state) % 100 < 60;
+                        Bit2_put(img_map, i, j, frame || noise);
+                }
+        }
+}
+
+/* void fill_speckle(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - empty bitmap to draw into
+ *    Returns: Nothing
+ *       Does: Draws sparse noise (30% black) that is mostly left alone, so
+ *             the cost is dominated by the border scan and short fills
+ */
+void fill_speckle(Bit2_T img_map)
+{
+        uint64_t state = 2020;
+        for (int j = 0; j < img_map->height; j++) {
+                for (int i = 0; i < img_map->width; i++) {
+                        Bit2_put(img_map, i, j, 
+                                 Bench_random(&state) % 100 < 30);
+                }
+        }
+}
+
+/* void fill_spiral(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - empty bitmap to draw into
+ *    Returns: Nothing
+ *       Does: Draws a full frame black spiral, a one pixel wide path that
+ *             starts in the top left corner and winds inwards with a one 
+ *             pixel gap between turns. The whole spiral is one black edge
+ *             that has to be followed one pixel at a time, so it is the 
+ *             worst case for the number of fill steps
+ */
+void fill_spiral(Bit2_T img_map)
+{
+        static const int dx[4] = { 1, 0, -1, 0 };
+        static const int dy[4] = { 0, 1, 0, -1 };
+        /* remaining length of the next horizontal and vertical leg */
+        int length[2] = { img_map->width - 1, img_map->height - 1 };
+        int col = 0;
+        int row = 0;
+        Bit2_put(img_map, col, row, 1);
+        for (int leg = 0; length[leg % 2] > 0; leg++) {
+                int dir = leg % 4;
+                for (int k = 0; k < length[leg % 2]; k++) {
+                        col += dx[dir];
+                        row += dy[dir];
+                        Bit2_put(img_map, col, row, 1);
+                }
+                /* the first leg is as long as the third, after that each
+                   leg is two shorter than the last one along its axis */
+                if (leg > 0) {
+                        length[leg % 2] -= 2;
+                }
+        }
+}
+
+/* Bit2_T copy_map(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - bitmap to copy
+ *    Returns: a new bitmap holding the same bits
+ */
+Bit2_T copy_map(Bit2_T img_map)
+{
+        Bit2_T copy = Bit2_new(img_map->width, img_map->height);
+        size_t nbytes = ((size_t)img_map->width * img_map->height + 7) / 8;
+        memcpy(copy->words, img_map->words, nbytes);
+        return copy;
+}
+
+/* int same_map(Bit2_T a, Bit2_T b)
+ * Parameters: [Bit2_T a], [Bit2_T b] - bitmaps of the same size
+ *    Returns: 1 if every pixel of a and b matches, 0 otherwise
+ */
+int same_map(Bit2_T a, Bit2_T b)
+{
+        for (int j = 0; j < a->height; j++) {
+                for (int i = 0; i < a->width; i++) {
+                        if (Bit2_get(a, i, j) != Bit2_get(b, i, j)) {
+                                return 0;
+                        }
+                }
+        }
+        return 1;
+}
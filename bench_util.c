@@ -0,0 +1,62 @@
+/*
+ * Filename: bench_util.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the bench_util.h interface, the
+ *          pieces every benchmark program repeats: a monotonic clock, a
+ *          fixed xorshift sequence so every run builds the same inputs,
+ *          keeping the fastest of several rounds, and the word that says
+ *          whether a fast way gave the same answer as the plain one.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <time.h>
+#include "bench_util.h"
+
+/* double Bench_now(void)
+ * Returns: a monotonic time in seconds
+ */
+double Bench_now(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* uint64_t Bench_random(uint64_t *state)
+ * Parameters:
+ *             uint64_t *state: the sequence's state, not 0
+ * Returns:
+ *             uint64_t: the next number of a xorshift64 sequence
+ */
+uint64_t Bench_random(uint64_t *state)
+{
+        uint64_t x = *state;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        *state = x;
+        return x;
+}
+
+/* double Bench_best(double best, double elapsed)
+ * Parameters:
+ *             double best: the fastest time so far, or below 0 for none
+ *             double elapsed: the time of the round just run
+ * Returns:
+ *             double: the faster of the two
+ */
+double Bench_best(double best, double elapsed)
+{
+        return (best < 0 || elapsed < best) ? elapsed : best;
+}
+
+/* const char *Bench_agrees(int agrees)
+ * Returns: "agrees" if agrees is not 0, else "MISMATCH"
+ */
+const char *Bench_agrees(int agrees)
+{
+        return agrees ? "agrees" : "MISMATCH";
+}
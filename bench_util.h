@@ -0,0 +1,19 @@
+/* bench_util.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for bench_util, the timing, random number and reporting helpers
+ * shared by the benchmark programs, functions explained in implementation
+ */
+
+#include <stdint.h>
+
+#ifndef BENCH_UTIL_INCLUDED
+#define BENCH_UTIL_INCLUDED
+
+extern double Bench_now(void);
+extern uint64_t Bench_random(uint64_t *state);
+extern double Bench_best(double best, double elapsed);
+extern const char *Bench_agrees(int agrees);
+
+#endif
@@ -7,16 +7,76 @@
  *          for bit arrays. This implementation represents the 2D array    
  *          as a 1D array which uses the column and row number of the 2D       
  *          array to set the index for each element in the 1D bit array 
+ *
+ *          The 1D bit array is stored as 64-bit words (bit n lives in word
+ *          n / 64 at position n % 64) rather than a Hanson Bit_T, so that
+ *          whole runs of a row can be searched and written a word at a time.
+ *          Row row starts at bit stride * row: rows are packed back to back
+ *          (stride = width) unless the image was made with BIT2_PADDED,
+ *          which starts each one on a word boundary
+ *
+ *          The bulk operations (counting, filling rectangles, and AND, OR,
+ *          XOR and NOT of whole images) work a word at a time too. On
+ *          x86-64 the whole image operations use AVX2 and the counts use
+ *          the popcnt instruction when the processor has them; both are
+ *          compiled in with target attributes, as in boards.c, so the build
+ *          flags do not change. Bits that are not pixels (the end of the
+ *          last word, and the padding at the end of each row) are always
+ *          0, which lets the counts take those words whole.
+ *
+ *          A Bit2_view_T is a rectangle of a bitmap passed by value; the
+ *          view functions add its origin to each index and read and write
+ *          the bitmap in place, so crops and tiles cost no allocation.
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <bit2.h>
 #include "assert.h"
-#include "bit.h"
 #include <stdio.h>
 #include <except.h>
+#include "workpool.h"
+#include "hugemem.h"
 
-/* Bit2_T Bit2_new(int width, int height, int size)
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BIT2_X86 1
+#include <immintrin.h>
+#else
+#define BIT2_X86 0
+#endif
+
+#define WORD_BITS 64
+#define ALL_ONES (~(uint64_t)0)
+#define DEFAULT_BLOCK 64 /* one word of a row per block column */
+#define BLOCKS_PER_THREAD 8 /* row blocks per thread in Bit2_map_parallel */
+
+/* a Bit2_map_parallel call, shared by its blocks */
+typedef struct Map_job {
+        Bit2_T set;
+        void (*apply)(int i, int j, Bit2_T a, int b, void *p1);
+        void *cl;
+        int rows; /* rows per block */
+} Map_job;
+
+static void map_row_block(int block, void *cl);
+
+/* the whole image operations */
+typedef enum Word_op { WORD_AND, WORD_OR, WORD_XOR, WORD_NOT } Word_op;
+
+static size_t image_words(Bit2_T set2);
+static void clear_padding(Bit2_T set2);
+static void fill_bits(Bit2_T set2, size_t first, size_t last, int bit);
+static uint64_t count_bits(Bit2_T set2, size_t first, size_t last);
+static uint64_t count_words(const uint64_t *words, size_t n);
+static void combine(Bit2_T dst, Bit2_T src, Word_op op);
+static void combine_words(uint64_t *dst, const uint64_t *src, size_t n,
+                          Word_op op);
+#if BIT2_X86
+static void combine_words_avx2(uint64_t *dst, const uint64_t *src, size_t n,
+                               Word_op op);
+#endif
+
+/* Bit2_T Bit2_new(int width, int height)
  * Parameters:
  *              int width: constructed width for Bit2_T, as integer
  *              int height: constructed height for Bit2_T as integer
@@ -30,18 +90,131 @@
  */
 Bit2_T Bit2_new(int width, int height)
 {
+        return Bit2_new_layout(width, height, BIT2_PACKED);
+}
+
+/* Bit2_T Bit2_new_layout(int width, int height, int layout)
+ * Parameters:
+ *              int width, int height: as for Bit2_new
+ *              int layout: BIT2_PACKED or BIT2_PADDED, optionally or'd
+ *                          with BIT2_HUGE
+ * Returns: 
+ *              Bit2_T: the constructed array of bits, all 0, stored in the
+ *              given layout, or NULL if width or height is 0
+ * Does: 
+ *              Creates a two dimensional array of bits like Bit2_new. In
+ *              the padded layout each row is padded out to a whole number
+ *              of 64-bit words, which costs up to 63 bits a row but lets
+ *              word kernels take a row as a uint64_t array (Bit2_row_words)
+ *              with the rows above and below Bit2_stride words away.
+ *              With BIT2_HUGE the words are mapped by Hugemem_alloc instead
+ *              of calloc: page aligned, and on 2 MB pages from a 2 MB
+ *              bitmap (16 megapixels) up, so a flood fill or a column walk
+ *              down a large image stops missing the TLB on every row
+ */
+Bit2_T Bit2_new_layout(int width, int height, int layout)
+{
+        int huge = layout & BIT2_HUGE;
+        layout &= ~BIT2_HUGE;
+        assert(layout == BIT2_PACKED || layout == BIT2_PADDED);
         if (width == 0 || height == 0) {
                 return NULL;
         }
+        assert(width > 0 && height > 0);
         Bit2_T set2 = malloc(sizeof(*set2));
         assert(set2 != NULL);
-        set2->set = Bit_new(width * height);
         set2->width = width;
         set2->height = height;
+        set2->stride = width;
+        if (layout == BIT2_PADDED) {
+                set2->stride = (width + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+        }
+        /* one spare word so a row's last word can always be read whole */
+        size_t words = (size_t)image_words(set2) + 1;
+        set2->mapped = 0;
+        if (huge) {
+                set2->mapped = words * sizeof(uint64_t);
+                set2->words = Hugemem_alloc(set2->mapped);
+        } else {
+                set2->words = calloc(words, sizeof(uint64_t));
+        }
+        assert(set2->words != NULL);
+        set2->in_arena = 0;
         return set2;
         
 }
 
+/* Bit2_T Bit2_new_arena(Arena_T arena, int width, int height, int layout)
+ * Parameters:
+ *              Arena_T arena: the arena the bitmap is allocated from
+ *              int width, int height: size of the bitmap, both above 0
+ *              int layout: BIT2_PACKED or BIT2_PADDED
+ * Returns: 
+ *              Bit2_T: a bitmap of all 0s
+ * Does: 
+ *              Creates a bitmap like Bit2_new_layout, but with the header
+ *              and the words in one allocation from arena. It lives until
+ *              Arena_free(arena) or Arena_dispose releases the arena's
+ *              memory in one step; Bit2_free does nothing to it. After a
+ *              reset the arena's chunks are reused with no call to malloc.
+ *              CII keeps one unlocked free list of chunks for every arena,
+ *              so arenas must only be used from one thread
+ */
+Bit2_T Bit2_new_arena(Arena_T arena, int width, int height, int layout)
+{
+        assert(arena != NULL);
+        assert(layout == BIT2_PACKED || layout == BIT2_PADDED);
+        assert(width > 0 && height > 0);
+        /* the words start on an 8 byte boundary past the header */
+        long header = (sizeof(struct Bit2_T) + 7) & ~7L;
+        struct Bit2_T shape = { height, width, width, NULL, 1, 0 };
+        if (layout == BIT2_PADDED) {
+                shape.stride = (width + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+        }
+        long words = (long)image_words(&shape) + 1;
+        char *block = Arena_calloc(arena, 1, header + words * 8, __FILE__, 
+                                   __LINE__);
+        Bit2_T set2 = (Bit2_T)block;
+        *set2 = shape;
+        set2->words = (uint64_t *)(block + header);
+        return set2;
+}
+
+/* int Bit2_stride(Bit2_T set2)
+ * Parameters:
+ *              Bit2_T set2: the Bit2_T object being queried
+ * Returns: 
+ *              int: the number of words from the start of one row to the
+ *              start of the next, or 0 if rows do not start on word
+ *              boundaries (a packed image whose width is not a multiple
+ *              of 64)
+ */
+int Bit2_stride(Bit2_T set2)
+{
+        assert(set2 != NULL);
+        return (set2->stride % WORD_BITS == 0) ? set2->stride / WORD_BITS 
+                                                : 0;
+}
+
+/* uint64_t *Bit2_row_words(Bit2_T set2, int row)
+ * Parameters:
+ *              Bit2_T set2: an image whose Bit2_stride is not 0
+ *              int row: the row index, as an integer
+ * Returns: 
+ *              uint64_t *: the Bit2_stride words of row, column col in bit
+ *              col % 64 of word col / 64; the bits past the last column
+ *              are 0 and must be left 0
+ * Does: 
+ *              Gives word kernels a row to work on directly
+ */
+uint64_t *Bit2_row_words(Bit2_T set2, int row)
+{
+        assert(set2 != NULL);
+        assert(set2->stride % WORD_BITS == 0);
+        assert(0 <= row && row < set2->height);
+        return set2->words + (size_t)set2->stride / WORD_BITS * row;
+}
+
 /* int Bit2_height(Bit2_T set)
  * Parameters:
  *              Bit2_T set: constructed height for Bit2_T object, as integer
@@ -76,13 +249,21 @@ int Bit2_width(Bit2_T set)
  * Returns: 
  *             void: Nothing
  * Does: 
- *             Frees up memory allocated by the object being pointer to by set2
+ *             Frees up memory allocated by the object being pointer to by
+ *             set2, unless it came from Bit2_new_arena and belongs to its
+ *             arena
  */
 void Bit2_free(Bit2_T *set2)
 {
-        assert(set2 != NULL);
-        Bit_T *set = &((*set2)->set);
-        Bit_free(set);
+        assert(set2 != NULL && *set2 != NULL);
+        if ((*set2)->in_arena) {
+                return;
+        }
+        if ((*set2)->mapped != 0) {
+                Hugemem_free((*set2)->words, (*set2)->mapped);
+        } else {
+                free((*set2)->words);
+        }
         free(*set2);
 }
 
@@ -101,9 +282,9 @@ void Bit2_free(Bit2_T *set2)
 int Bit2_get(Bit2_T set2, int col, int row)
 {
         assert(set2 != NULL);
-        assert(set2->width >= 0 && set2->height >= 0);
-        int n = (set2->width * row) + col;
-        return Bit_get(set2->set, n);
+        assert(0 <= col && col < set2->width);
+        assert(0 <= row && row < set2->height);
+        return Bit2_get_fast(set2, col, row);
 }
 
 /* int Bit2_put(Bit2_T set2, int col, int row, int bit)
@@ -124,14 +305,623 @@ int Bit2_put(Bit2_T set2, int col, int row, int bit)
 {
         assert (set2 != NULL);
         assert(bit == 0 || bit == 1);
-        assert(0 <= col && col <= set2->width);
-        assert( 0 <= row && row <= set2->height);
-        int n = (set2->width * row) + col;
-        int prev = Bit_get(set2->set, n);
-        Bit_put(set2->set, n, bit);
-        return prev;
+        assert(0 <= col && col < set2->width);
+        assert(0 <= row && row < set2->height);
+        return Bit2_put_fast(set2, col, row, bit);
+}
+
+/* int Bit2_next_bit(Bit2_T set2, int col, int row, int bit)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be searched
+ *             int col: the first column index to look at, as an integer
+ *             int row: the row index to search along, as an integer
+ *             int bit: the bit value being searched for
+ * Returns: 
+ *             int: the smallest column index >= col in row holding bit, or 
+ *             the width of set2 if there is none
+ * Does: Scans a row a 64-bit word at a time, so the end of a run of equal
+ *       bits is found without visiting each bit of the run
+ */
+int Bit2_next_bit(Bit2_T set2, int col, int row, int bit)
+{
+        assert(set2 != NULL);
+        assert(bit == 0 || bit == 1);
+        assert(0 <= row && row < set2->height);
+        if (col >= set2->width) {
+                return set2->width;
+        }
+        assert(col >= 0);
+        size_t base = (size_t)set2->stride * row;
+        size_t end = base + set2->width;
+        size_t n = base + col;
+        /* searching for 0s is searching for 1s in the complement */
+        uint64_t flip = (bit == 1) ? 0 : ALL_ONES;
+        while (n < end) {
+                size_t w = n / WORD_BITS;
+                uint64_t word = (set2->words[w] ^ flip) >> (n % WORD_BITS);
+                if (word != 0) {
+                        n += __builtin_ctzll(word);
+                        return (n < end) ? (int)(n - base) : set2->width;
+                }
+                n = (w + 1) * WORD_BITS;
+        }
+        return set2->width;
+}
+
+/* int Bit2_prev_bit(Bit2_T set2, int col, int row, int bit)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be searched
+ *             int col: the first column index to look at, as an integer
+ *             int row: the row index to search along, as an integer
+ *             int bit: the bit value being searched for
+ * Returns: 
+ *             int: the largest column index <= col in row holding bit, or 
+ *             -1 if there is none
+ * Does: Mirror of Bit2_next_bit, scanning towards column 0 a word at a time
+ */
+int Bit2_prev_bit(Bit2_T set2, int col, int row, int bit)
+{
+        assert(set2 != NULL);
+        assert(bit == 0 || bit == 1);
+        assert(0 <= row && row < set2->height);
+        if (col < 0) {
+                return -1;
+        }
+        assert(col < set2->width);
+        int64_t base = (int64_t)set2->stride * row;
+        int64_t n = base + col;
+        uint64_t flip = (bit == 1) ? 0 : ALL_ONES;
+        while (n >= base) {
+                int64_t w = n / WORD_BITS;
+                uint64_t word = (set2->words[w] ^ flip)
+                                << (WORD_BITS - 1 - n % WORD_BITS);
+                if (word != 0) {
+                        n -= __builtin_clzll(word);
+                        return (n >= base) ? (int)(n - base) : -1;
+                }
+                n = w * WORD_BITS - 1;
+        }
+        return -1;
+}
+
+/* void Bit2_put_run(Bit2_T set2, int lo, int hi, int row, int bit)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be written
+ *             int lo: the first column index of the run, as an integer
+ *             int hi: the last column index of the run (inclusive)
+ *             int row: the row index of the run, as an integer
+ *             int bit: the bit value written to every bit of the run
+ * Returns: 
+ *             Nothing
+ * Does: Sets columns lo through hi of row to bit, masking the partial words
+ *       at either end and filling the words in between whole
+ */
+void Bit2_put_run(Bit2_T set2, int lo, int hi, int row, int bit)
+{
+        assert(set2 != NULL);
+        assert(bit == 0 || bit == 1);
+        assert(0 <= row && row < set2->height);
+        assert(0 <= lo && hi < set2->width);
+        if (lo > hi) {
+                return;
+        }
+        fill_bits(set2, (size_t)set2->stride * row + lo,
+                  (size_t)set2->stride * row + hi, bit);
+}
+
+/* long Bit2_count(Bit2_T set2)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be counted
+ * Returns: 
+ *             long: the number of 1 bits in the whole image
+ */
+long Bit2_count(Bit2_T set2)
+{
+        assert(set2 != NULL);
+        return count_words(set2->words, image_words(set2));
+}
+
+/* int Bit2_count_run(Bit2_T set2, int lo, int hi, int row)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be counted
+ *             int lo: the first column index of the run, as an integer
+ *             int hi: the last column index of the run (inclusive)
+ *             int row: the row index of the run, as an integer
+ * Returns: 
+ *             int: the number of 1 bits in columns lo through hi of row,
+ *             0 if lo > hi
+ * Does: Counts the partial words at either end through masks and the
+ *       words in between whole
+ */
+int Bit2_count_run(Bit2_T set2, int lo, int hi, int row)
+{
+        assert(set2 != NULL);
+        assert(0 <= row && row < set2->height);
+        assert(0 <= lo && hi < set2->width);
+        if (lo > hi) {
+                return 0;
+        }
+        return count_bits(set2, (size_t)set2->stride * row + lo,
+                          (size_t)set2->stride * row + hi);
+}
+
+/* long Bit2_count_rect(Bit2_T set2, int left, int top, int right,
+ *                      int bottom)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be counted
+ *             int left, int top: column and row of the first corner
+ *             int right, int bottom: column and row of the opposite corner,
+ *             inclusive
+ * Returns: 
+ *             long: the number of 1 bits in the rectangle, 0 if it is empty
+ * Does: Counts the rectangle a row at a time, or as one run of bits when
+ *       it spans whole rows, since rows are stored back to back and any
+ *       padding between them is 0
+ */
+long Bit2_count_rect(Bit2_T set2, int left, int top, int right, int bottom)
+{
+        assert(set2 != NULL);
+        assert(0 <= left && right < set2->width);
+        assert(0 <= top && bottom < set2->height);
+        if (left > right || top > bottom) {
+                return 0;
+        }
+        size_t stride = set2->stride;
+        if (left == 0 && right == set2->width - 1) {
+                return count_bits(set2, stride * top, 
+                                  stride * bottom + right);
+        }
+        long count = 0;
+        for (int row = top; row <= bottom; row++) {
+                count += count_bits(set2, stride * row + left, 
+                                    stride * row + right);
+        }
+        return count;
+}
+
+/* void Bit2_put_rect(Bit2_T set2, int left, int top, int right,
+ *                    int bottom, int bit)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be written
+ *             int left, int top: column and row of the first corner
+ *             int right, int bottom: column and row of the opposite corner,
+ *             inclusive
+ *             int bit: the bit value written to every bit of the rectangle
+ * Returns: 
+ *             Nothing
+ * Does: Sets every bit of the rectangle to bit, a row at a time as
+ *       Bit2_put_run does, or as one run when it spans whole rows of a
+ *       packed image
+ */
+void Bit2_put_rect(Bit2_T set2, int left, int top, int right, int bottom,
+                   int bit)
+{
+        assert(set2 != NULL);
+        assert(bit == 0 || bit == 1);
+        assert(0 <= left && right < set2->width);
+        assert(0 <= top && bottom < set2->height);
+        if (left > right || top > bottom) {
+                return;
+        }
+        size_t stride = set2->stride;
+        if (left == 0 && right == set2->width - 1 && 
+            set2->stride == set2->width) {
+                fill_bits(set2, stride * top, stride * bottom + right, bit);
+                return;
+        }
+        for (int row = top; row <= bottom; row++) {
+                fill_bits(set2, stride * row + left, stride * row + right, 
+                          bit);
+        }
+}
+
+/* void Bit2_and(Bit2_T dst, Bit2_T src)
+ * Parameters:
+ *             Bit2_T dst: the image written
+ *             Bit2_T src: an image of the same width, height and layout
+ * Returns: 
+ *             Nothing
+ * Does: Sets each bit of dst to itself AND the same bit of src, which
+ *       masks dst with src
+ */
+void Bit2_and(Bit2_T dst, Bit2_T src)
+{
+        combine(dst, src, WORD_AND);
+}
+
+/* void Bit2_or(Bit2_T dst, Bit2_T src)
+ * Parameters:
+ *             Bit2_T dst: the image written
+ *             Bit2_T src: an image of the same width, height and layout
+ * Returns: 
+ *             Nothing
+ * Does: Sets each bit of dst to itself OR the same bit of src
+ */
+void Bit2_or(Bit2_T dst, Bit2_T src)
+{
+        combine(dst, src, WORD_OR);
+}
+
+/* void Bit2_xor(Bit2_T dst, Bit2_T src)
+ * Parameters:
+ *             Bit2_T dst: the image written
+ *             Bit2_T src: an image of the same width, height and layout
+ * Returns: 
+ *             Nothing
+ * Does: Sets each bit of dst to itself XOR the same bit of src, leaving 1
+ *       wherever the two images differ
+ */
+void Bit2_xor(Bit2_T dst, Bit2_T src)
+{
+        combine(dst, src, WORD_XOR);
+}
+
+/* void Bit2_not(Bit2_T dst)
+ * Parameters:
+ *             Bit2_T dst: the image written
+ * Returns: 
+ *             Nothing
+ * Does: Inverts every bit of dst
+ */
+void Bit2_not(Bit2_T dst)
+{
+        combine(dst, NULL, WORD_NOT);
+}
+
+/* void Bit2_put_bits(Bit2_T set2, int col, int row, uint64_t bits, int n)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be written
+ *             int col: the column index of the first bit written
+ *             int row: the row index the bits are written along
+ *             uint64_t bits: the bits to write, bit 0 goes to column col
+ *             int n: how many bits to write, 1 to 64
+ * Returns: 
+ *             Nothing
+ * Does: Writes columns col through col + n - 1 of row from bits with at most
+ *       two word writes, so packed input rows can be copied in 64 pixels at
+ *       a time
+ */
+void Bit2_put_bits(Bit2_T set2, int col, int row, uint64_t bits, int n)
+{
+        assert(set2 != NULL);
+        assert(n > 0 && n <= WORD_BITS);
+        assert(0 <= row && row < set2->height);
+        assert(0 <= col && col + n <= set2->width);
+        size_t first = (size_t)set2->stride * row + col;
+        size_t w = first / WORD_BITS;
+        int shift = first % WORD_BITS;
+        uint64_t mask = ALL_ONES >> (WORD_BITS - n);
+        bits &= mask;
+        set2->words[w] = (set2->words[w] & ~(mask << shift)) | (bits << shift);
+        if (shift + n > WORD_BITS) {
+                int spill = WORD_BITS - shift;
+                set2->words[w + 1] = (set2->words[w + 1] & ~(mask >> spill)) 
+                                     | (bits >> spill);
+        }
+}
+
+/* uint64_t Bit2_get_bits(Bit2_T set2, int col, int row, int n)
+ * Parameters:
+ *             Bit2_T set2: the Bit2_T object which will be read
+ *             int col: the column index of the first bit read
+ *             int row: the row index the bits are read along
+ *             int n: how many bits to read, 1 to 64
+ * Returns: 
+ *             uint64_t: columns col through col + n - 1 of row, column col
+ *             in bit 0 and every bit above n cleared
+ * Does: Reads up to 64 bits of a row with at most two word reads
+ */
+uint64_t Bit2_get_bits(Bit2_T set2, int col, int row, int n)
+{
+        assert(set2 != NULL);
+        assert(n > 0 && n <= WORD_BITS);
+        assert(0 <= row && row < set2->height);
+        assert(0 <= col && col + n <= set2->width);
+        size_t first = (size_t)set2->stride * row + col;
+        size_t w = first / WORD_BITS;
+        int shift = first % WORD_BITS;
+        uint64_t bits = set2->words[w] >> shift;
+        if (shift + n > WORD_BITS) {
+                bits |= set2->words[w + 1] << (WORD_BITS - shift);
+        }
+        return bits & (ALL_ONES >> (WORD_BITS - n));
 }
 
+/* void Bit2_copy(Bit2_T dst, Bit2_T src)
+ * Parameters:
+ *             Bit2_T dst: the image written
+ *             Bit2_T src: an image of the same width and height, in either
+ *             layout
+ * Returns: 
+ *             Nothing
+ * Does: Copies every pixel of src into dst, with one memcpy when the two
+ *       are laid out the same and 64 pixels at a time when they are not
+ */
+void Bit2_copy(Bit2_T dst, Bit2_T src)
+{
+        assert(dst != NULL && src != NULL);
+        assert(dst->width == src->width && dst->height == src->height);
+        if (dst->stride == src->stride) {
+                memcpy(dst->words, src->words, 
+                       image_words(src) * sizeof(uint64_t));
+                return;
+        }
+        for (int row = 0; row < src->height; row++) {
+                for (int col = 0; col < src->width; col += WORD_BITS) {
+                        int n = (src->width - col < WORD_BITS) ? 
+                                src->width - col : WORD_BITS;
+                        Bit2_put_bits(dst, col, row, 
+                                      Bit2_get_bits(src, col, row, n), n);
+                }
+        }
+}
+
+/* void Bit2_dilate4(Bit2_T dst, Bit2_T src)
+ * Parameters:
+ *             Bit2_T dst: the image written, not src
+ *             Bit2_T src: an image of the same width, height and stride,
+ *             whose rows start on word boundaries (Bit2_stride is not 0)
+ * Returns: 
+ *             Nothing
+ * Does: Sets dst to the 4-neighbor dilation of src: a pixel of dst is 1
+ *       when the same pixel of src or the one to its left, right, above or
+ *       below is 1. Each word is the OR of the word, the words one stride
+ *       up and down, and the word shifted one bit each way with the end bit
+ *       of the next word over carried in, so no pixel is read on its own
+ */
+void Bit2_dilate4(Bit2_T dst, Bit2_T src)
+{
+        assert(dst != NULL && src != NULL && dst != src);
+        assert(dst->width == src->width && dst->height == src->height &&
+               dst->stride == src->stride);
+        int words = Bit2_stride(src);
+        assert(words != 0);
+        int used = src->width % WORD_BITS;
+        uint64_t last_mask = (used == 0) ? ALL_ONES 
+                                         : ALL_ONES >> (WORD_BITS - used);
+        for (int row = 0; row < src->height; row++) {
+                const uint64_t *cur = Bit2_row_words(src, row);
+                const uint64_t *above = (row > 0) ? cur - words : NULL;
+                const uint64_t *below = (row < src->height - 1) ? 
+                                        cur + words : NULL;
+                uint64_t *out = Bit2_row_words(dst, row);
+                for (int w = 0; w < words; w++) {
+                        uint64_t word = cur[w] | (cur[w] << 1) | 
+                                        (cur[w] >> 1);
+                        if (w > 0) {
+                                word |= cur[w - 1] >> (WORD_BITS - 1);
+                        }
+                        if (w < words - 1) {
+                                word |= cur[w + 1] << (WORD_BITS - 1);
+                        }
+                        if (above != NULL) {
+                                word |= above[w];
+                        }
+                        if (below != NULL) {
+                                word |= below[w];
+                        }
+                        out[w] = word;
+                }
+                /* the left shift can carry the last pixel into padding */
+                out[words - 1] &= last_mask;
+        }
+}
+
+/* static size_t image_words(Bit2_T set2)
+ * Returns: the number of words holding pixels, not counting the spare
+ */
+static size_t image_words(Bit2_T set2)
+{
+        return ((size_t)set2->stride * set2->height + WORD_BITS - 1) / 
+               WORD_BITS;
+}
+
+/* static void clear_padding(Bit2_T set2)
+ * Does: Clears the bits that are not pixels: the end of every row of a
+ *       padded image, or the end of the last word of a packed one
+ */
+static void clear_padding(Bit2_T set2)
+{
+        int used = set2->width % WORD_BITS;
+        if (set2->stride == set2->width) {
+                used = (size_t)set2->width * set2->height % WORD_BITS;
+                if (used != 0) {
+                        set2->words[image_words(set2) - 1] &= 
+                                ALL_ONES >> (WORD_BITS - used);
+                }
+                return;
+        }
+        if (used == 0) {
+                return;
+        }
+        for (int row = 0; row < set2->height; row++) {
+                Bit2_row_words(set2, row)[set2->width / WORD_BITS] &= 
+                        ALL_ONES >> (WORD_BITS - used);
+        }
+}
+
+/* static void fill_bits(Bit2_T set2, size_t first, size_t last, int bit)
+ * Does: Sets bits first through last of the 1D bit array to bit, masking
+ *       the partial words at either end and filling the words in between
+ *       whole
+ */
+static void fill_bits(Bit2_T set2, size_t first, size_t last, int bit)
+{
+        size_t w = first / WORD_BITS;
+        size_t last_w = last / WORD_BITS;
+        uint64_t fill = (bit == 1) ? ALL_ONES : 0;
+        uint64_t mask = ALL_ONES << (first % WORD_BITS);
+        for (; w <= last_w; w++) {
+                if (w == last_w) {
+                        mask &= ALL_ONES >> (WORD_BITS - 1 - last % WORD_BITS);
+                }
+                set2->words[w] = (set2->words[w] & ~mask) | (fill & mask);
+                mask = ALL_ONES;
+        }
+}
+
+/* static uint64_t count_bits(Bit2_T set2, size_t first, size_t last)
+ * Returns: the number of 1 bits among bits first through last of the 1D
+ *          bit array
+ */
+static uint64_t count_bits(Bit2_T set2, size_t first, size_t last)
+{
+        size_t w = first / WORD_BITS;
+        size_t last_w = last / WORD_BITS;
+        uint64_t head = ALL_ONES << (first % WORD_BITS);
+        uint64_t tail = ALL_ONES >> (WORD_BITS - 1 - last % WORD_BITS);
+        if (w == last_w) {
+                return __builtin_popcountll(set2->words[w] & head & tail);
+        }
+        return __builtin_popcountll(set2->words[w] & head) +
+               count_words(set2->words + w + 1, last_w - w - 1) +
+               __builtin_popcountll(set2->words[last_w] & tail);
+}
+
+/* count_loop is compiled into both counting kernels, so the popcnt one
+   gets the instruction rather than a library call */
+static inline __attribute__((always_inline)) 
+uint64_t count_loop(const uint64_t *words, size_t n)
+{
+        uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+                c0 += __builtin_popcountll(words[i]);
+                c1 += __builtin_popcountll(words[i + 1]);
+                c2 += __builtin_popcountll(words[i + 2]);
+                c3 += __builtin_popcountll(words[i + 3]);
+        }
+        for (; i < n; i++) {
+                c0 += __builtin_popcountll(words[i]);
+        }
+        return c0 + c1 + c2 + c3;
+}
+
+#if BIT2_X86
+__attribute__((target("popcnt")))
+static uint64_t count_words_popcnt(const uint64_t *words, size_t n)
+{
+        return count_loop(words, n);
+}
+#endif
+
+/* static uint64_t count_words(const uint64_t *words, size_t n)
+ * Returns: the number of 1 bits in the n words, with the popcnt
+ *          instruction when the processor has it
+ */
+static uint64_t count_words(const uint64_t *words, size_t n)
+{
+#if BIT2_X86
+        static int popcnt = -1;
+        if (popcnt < 0) {
+                popcnt = __builtin_cpu_supports("popcnt") != 0;
+        }
+        if (popcnt) {
+                return count_words_popcnt(words, n);
+        }
+#endif
+        return count_loop(words, n);
+}
+
+/* static void combine(Bit2_T dst, Bit2_T src, Word_op op)
+ * Does: Applies op to every word of dst (and the same word of src), with
+ *       AVX2 when the processor has it, and clears the bits that are not
+ *       pixels again afterwards, which only WORD_NOT can set
+ */
+static void combine(Bit2_T dst, Bit2_T src, Word_op op)
+{
+        assert(dst != NULL);
+        assert(op == WORD_NOT || src != NULL);
+        assert(src == NULL || (src->width == dst->width &&
+                               src->height == dst->height &&
+                               src->stride == dst->stride));
+        size_t n = image_words(dst);
+        const uint64_t *src_words = (src == NULL) ? NULL : src->words;
+#if BIT2_X86
+        static int avx2 = -1;
+        if (avx2 < 0) {
+                avx2 = __builtin_cpu_supports("avx2") != 0;
+        }
+        if (avx2) {
+                combine_words_avx2(dst->words, src_words, n, op);
+        } else {
+                combine_words(dst->words, src_words, n, op);
+        }
+#else
+        combine_words(dst->words, src_words, n, op);
+#endif
+        if (op == WORD_NOT) {
+                clear_padding(dst);
+        }
+}
+
+/* static void combine_words(uint64_t *dst, const uint64_t *src, size_t n,
+ *                           Word_op op)
+ * Does: Applies op to the n words of dst a word at a time; src is unused
+ *       for WORD_NOT
+ */
+static void combine_words(uint64_t *dst, const uint64_t *src, size_t n,
+                          Word_op op)
+{
+        switch (op) {
+        case WORD_AND:
+                for (size_t i = 0; i < n; i++) {
+                        dst[i] &= src[i];
+                }
+                break;
+        case WORD_OR:
+                for (size_t i = 0; i < n; i++) {
+                        dst[i] |= src[i];
+                }
+                break;
+        case WORD_XOR:
+                for (size_t i = 0; i < n; i++) {
+                        dst[i] ^= src[i];
+                }
+                break;
+        case WORD_NOT:
+                for (size_t i = 0; i < n; i++) {
+                        dst[i] = ~dst[i];
+                }
+                break;
+        }
+}
+
+#if BIT2_X86
+/* static void combine_words_avx2(uint64_t *dst, const uint64_t *src,
+ *                                size_t n, Word_op op)
+ * Does: combine_words four words (256 bits) at a time, finishing the last
+ *       n % 4 words with combine_words
+ */
+__attribute__((target("avx2")))
+static void combine_words_avx2(uint64_t *dst, const uint64_t *src, size_t n,
+                               Word_op op)
+{
+        const __m256i ones = _mm256_set1_epi64x(-1);
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+                __m256i *d = (__m256i *)(dst + i);
+                __m256i a = _mm256_loadu_si256(d);
+                __m256i b = (op == WORD_NOT) ? ones : 
+                            _mm256_loadu_si256((const __m256i *)(src + i));
+                switch (op) {
+                case WORD_AND:
+                        a = _mm256_and_si256(a, b);
+                        break;
+                case WORD_OR:
+                        a = _mm256_or_si256(a, b);
+                        break;
+                case WORD_XOR:
+                case WORD_NOT:
+                        a = _mm256_xor_si256(a, b);
+                        break;
+                }
+                _mm256_storeu_si256(d, a);
+        }
+        combine_words(dst + i, (src == NULL) ? NULL : src + i, n - i, op);
+}
+#endif
+
 /* void Bit2_map_row_major(Bit2_T set, 
  *         void apply(int i, int j, Bit2_T a, int b,  void *p1), void *cl)
  * Parameters:
@@ -159,7 +949,7 @@ void Bit2_map_col_major(Bit2_T set, void apply(int i, int j, Bit2_T a, int b,
         assert(set != NULL);
         for (int i = 0; i < set->width; i++){
                 for (int j = 0; j < set->height; j++){
-                  apply(i, j, set, Bit2_get(set, i, j), &cl);
+                  apply(i, j, set, Bit2_get_fast(set, i, j), cl);
                 }
         }
 }
@@ -191,7 +981,284 @@ void Bit2_map_row_major(Bit2_T set, void apply(int i, int j, Bit2_T a, int b,
         assert(set != NULL);
         for (int i = 0; i < set->height; i++){
                 for (int j = 0; j < set->width; j++){
-                  apply(j, i, set, Bit2_get(set, j, i), &cl);
+                  apply(j, i, set, Bit2_get_fast(set, j, i), cl);
+                }
+        }
+}
+
+/* void Bit2_map_blocked(Bit2_T set, int block,
+ *         void apply(int i, int j, Bit2_T a, int b, void *p1), void *cl)
+ * Parameters:
+ *         Bit2_T set: the Bit2_T object being mapped
+ *         int block: side of the square blocks, or 0 for the default (64)
+ *         int i, int j: column and row passed to apply
+ *         Bit2_T a: set, passed to apply
+ *         int b: the bit at (i, j)
+ *         void *p1: cl, passed to apply
+ * Returns: 
+ *         Nothing
+ * Does: 
+ *         Calls apply on every bit, a block x block tile at a time. The
+ *         tiles are taken down each column of tiles in turn and each tile
+ *         is walked in column major order, so every column is still
+ *         visited top to bottom and every row left to right, but the
+ *         columns are interleaved. A caller that only needs that, rather
+ *         than one whole column after another, touches block rows of the
+ *         bitmap per tile instead of a new row on every step as
+ *         Bit2_map_col_major does
+ */
+void Bit2_map_blocked(Bit2_T set, int block, void apply(int i, int j, 
+                                                        Bit2_T a, int b,
+                                                        void *p1), void *cl)
+{
+        assert(set != NULL);
+        assert(block >= 0);
+        if (block == 0) {
+                block = DEFAULT_BLOCK;
+        }
+        for (int col0 = 0; col0 < set->width; col0 += block) {
+                int col1 = set->width - col0 < block ? set->width 
+                                                     : col0 + block;
+                for (int row0 = 0; row0 < set->height; row0 += block) {
+                        int row1 = set->height - row0 < block ? set->height
+                                                              : row0 + block;
+                        for (int i = col0; i < col1; i++) {
+                                for (int j = row0; j < row1; j++) {
+                                        apply(i, j, set, 
+                                              Bit2_get_fast(set, i, j), cl);
+                                }
+                        }
+                }
+        }
+}
+
+/* void Bit2_map_parallel(Bit2_T set,
+ *         void apply(int i, int j, Bit2_T a, int b, void *p1), void *cl)
+ * Parameters:
+ *         Bit2_T set: the Bit2_T object being mapped
+ *         int i, int j: column and row passed to apply
+ *         Bit2_T a: set, passed to apply
+ *         int b: the bit at (i, j)
+ *         void *p1: cl, passed to apply
+ * Returns: 
+ *         Nothing, once apply has been called on every bit
+ * Does: 
+ *         Calls apply on every bit, using every thread of the workpool.
+ *         The rows are cut into blocks of whole rows that the threads
+ *         share out, stealing from each other when their own run out. Each
+ *         block is walked in row major order, but THE CALLS MAY RUN IN ANY
+ *         ORDER AND AT THE SAME TIME: apply must not depend on the order,
+ *         share a cl it writes without locking, or raise an exception. On
+ *         a BIT2_PADDED bitmap every row has words of its own, so apply
+ *         may Bit2_put its own bit; rows of a BIT2_PACKED bitmap share
+ *         words, so there apply must not write set at all
+ */
+void Bit2_map_parallel(Bit2_T set, void apply(int i, int j, Bit2_T a, int b,
+                                              void *p1), void *cl)
+{
+        assert(set != NULL);
+        int nthreads = Workpool_start(0);
+        Map_job job = { set, apply, cl, 
+                        set->height / (nthreads * BLOCKS_PER_THREAD) };
+        if (job.rows == 0) {
+                job.rows = 1;
+        }
+        Workpool_run((set->height + job.rows - 1) / job.rows, map_row_block,
+                     &job);
+}
+
+/* static void map_row_block(int block, void *cl)
+ * Does: calls the Map_job cl's apply on each bit of its block'th block of
+ *       rows, in row major order
+ */
+static void map_row_block(int block, void *cl)
+{
+        Map_job *job = cl;
+        Bit2_T set = job->set;
+        int first = block * job->rows;
+        int end = (set->height - first < job->rows) ? set->height 
+                                                    : first + job->rows;
+        for (int j = first; j < end; j++) {
+                for (int i = 0; i < set->width; i++) {
+                        job->apply(i, j, set, Bit2_get_fast(set, i, j), 
+                                   job->cl);
+                }
+        }
+}
+
+/* Bit2_view_T Bit2_view(Bit2_T set2, int col, int row, int width,
+ *                       int height)
+ * Parameters:
+ *             Bit2_T set2: the bitmap to look into
+ *             int col, int row: the bitmap index of the view's (0, 0)
+ *             int width, int height: size of the view, both above 0
+ * Returns:
+ *             Bit2_view_T: the view, which must lie inside set2
+ * Does:
+ *             Makes a window onto part of set2 without copying or
+ *             allocating anything, so a crop is a view rather than a new
+ *             bitmap. A window that does not fit is a checked runtime error
+ */
+Bit2_view_T Bit2_view(Bit2_T set2, int col, int row, int width, int height)
+{
+        assert(set2 != NULL);
+        assert(width > 0 && height > 0);
+        assert(0 <= col && col <= set2->width - width);
+        assert(0 <= row && row <= set2->height - height);
+        Bit2_view_T view = { set2, col, row, width, height };
+        return view;
+}
+
+/* Bit2_view_T Bit2_view_sub(Bit2_view_T view, int col, int row, int width,
+ *                           int height)
+ * Parameters:
+ *             Bit2_view_T view: the view to look into
+ *             int col, int row, int width, int height: the window, in the
+ *             view's own indices, as for Bit2_view
+ * Returns:
+ *             Bit2_view_T: a view of the same bitmap, which must lie inside
+ *             view
+ */
+Bit2_view_T Bit2_view_sub(Bit2_view_T view, int col, int row, int width,
+                          int height)
+{
+        assert(width > 0 && height > 0);
+        assert(0 <= col && col <= view.width - width);
+        assert(0 <= row && row <= view.height - height);
+        return Bit2_view(view.bits, view.col + col, view.row + row, width,
+                         height);
+}
+
+/* int Bit2_tile_count(Bit2_T set2, int tile_width, int tile_height)
+ * Returns: the number of tile_width x tile_height tiles it takes to cover
+ *          set2, counting the part tiles on its right and bottom edges
+ */
+int Bit2_tile_count(Bit2_T set2, int tile_width, int tile_height)
+{
+        assert(set2 != NULL);
+        assert(tile_width > 0 && tile_height > 0);
+        return ((set2->width + tile_width - 1) / tile_width) *
+               ((set2->height + tile_height - 1) / tile_height);
+}
+
+/* Bit2_view_T Bit2_tile(Bit2_T set2, int tile_width, int tile_height,
+ *                       int index)
+ * Parameters:
+ *             Bit2_T set2: the bitmap being tiled
+ *             int tile_width, int tile_height: size of a whole tile
+ *             int index: which tile, from 0 to Bit2_tile_count - 1,
+ *                        numbered across each row of tiles in turn
+ * Returns:
+ *             Bit2_view_T: a view of the tile, cut short on the right and
+ *             bottom edges of the bitmap
+ * Does:
+ *             Lets a loop or a Workpool_run job go tile by tile with a view
+ *             per tile, the block number being the index. Tiles of a
+ *             BIT2_PADDED bitmap whose width is a multiple of 64 share no
+ *             words, so parallel blocks may each write their own tile
+ */
+Bit2_view_T Bit2_tile(Bit2_T set2, int tile_width, int tile_height,
+                      int index)
+{
+        assert(0 <= index && index < Bit2_tile_count(set2, tile_width,
+                                                     tile_height));
+        int across = (set2->width + tile_width - 1) / tile_width;
+        int col = index % across * tile_width;
+        int row = index / across * tile_height;
+        int width = set2->width - col;
+        int height = set2->height - row;
+        return Bit2_view(set2, col, row,
+                         width < tile_width ? width : tile_width,
+                         height < tile_height ? height : tile_height);
+}
+
+/* int Bit2_view_get(Bit2_view_T view, int col, int row)
+ * Returns: the bit under (col, row) of the view; an index outside the view
+ *          is a checked runtime error
+ */
+int Bit2_view_get(Bit2_view_T view, int col, int row)
+{
+        assert(0 <= col && col < view.width);
+        assert(0 <= row && row < view.height);
+        return Bit2_get_fast(view.bits, view.col + col, view.row + row);
+}
+
+/* int Bit2_view_put(Bit2_view_T view, int col, int row, int bit)
+ * Returns: the bit under (col, row) of the view before it was set to bit,
+ *          as Bit2_put does
+ */
+int Bit2_view_put(Bit2_view_T view, int col, int row, int bit)
+{
+        assert(bit == 0 || bit == 1);
+        assert(0 <= col && col < view.width);
+        assert(0 <= row && row < view.height);
+        return Bit2_put_fast(view.bits, view.col + col, view.row + row, bit);
+}
+
+/* long Bit2_view_count(Bit2_view_T view)
+ * Returns: the number of 1 bits in the view, counted a word at a time by
+ *          Bit2_count_rect
+ */
+long Bit2_view_count(Bit2_view_T view)
+{
+        return Bit2_count_rect(view.bits, view.col, view.row,
+                               view.col + view.width - 1,
+                               view.row + view.height - 1);
+}
+
+/* void Bit2_view_map_row_major(Bit2_view_T view,
+ *          void apply(int i, int j, Bit2_view_T *v, int b, void *p1),
+ *          void *cl)
+ * Parameters:
+ *             Bit2_view_T view: the view being mapped
+ *             int i, int j: column and row in the view, passed to apply
+ *             Bit2_view_T *v: the view, passed to apply
+ *             int b: the bit under (i, j)
+ *             void *p1: cl, passed to apply
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Calls apply on every bit of the view, row by row. Each row
+ *             is read up to 64 bits at a time, so apply must not change
+ *             bits of the view further along the row it is on
+ */
+void Bit2_view_map_row_major(Bit2_view_T view,
+                             void apply(int i, int j, Bit2_view_T *v, int b,
+                                        void *p1),
+                             void *cl)
+{
+        assert(view.bits != NULL);
+        for (int j = 0; j < view.height; j++) {
+                for (int i = 0; i < view.width; i += WORD_BITS) {
+                        int n = (view.width - i < WORD_BITS) ? view.width - i
+                                                             : WORD_BITS;
+                        uint64_t bits = Bit2_get_bits(view.bits, view.col + i,
+                                                      view.row + j, n);
+                        for (int k = 0; k < n; k++) {
+                                apply(i + k, j, &view, (bits >> k) & 1, cl);
+                        }
+                }
+        }
+}
+
+/* void Bit2_view_map_col_major(Bit2_view_T view,
+ *          void apply(int i, int j, Bit2_view_T *v, int b, void *p1),
+ *          void *cl)
+ * Does: Calls apply on every bit of the view, column by column, with the
+ *       same arguments as Bit2_view_map_row_major
+ */
+void Bit2_view_map_col_major(Bit2_view_T view,
+                             void apply(int i, int j, Bit2_view_T *v, int b,
+                                        void *p1),
+                             void *cl)
+{
+        assert(view.bits != NULL);
+        for (int i = 0; i < view.width; i++) {
+                for (int j = 0; j < view.height; j++) {
+                        apply(i, j, &view,
+                              Bit2_get_fast(view.bits, view.col + i,
+                                            view.row + j),
+                              cl);
                 }
         }
 }
@@ -5,29 +5,136 @@
  * Interface for bit2, functions explained in implementation
  */
 
-#include<bit.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <arena.h>
 
 #ifndef BIT2_INCLUDED
 #define BIT2_INCLUDED
 
+#ifdef ARRAY2_CHECKED
+#include "assert.h"
+#endif
+
+/* storage layouts for Bit2_new_layout. BIT2_PACKED stores the rows back
+   to back; BIT2_PADDED starts every row on a new 64-bit word, so a row is
+   a plain array of Bit2_stride words and the row above is that many words
+   back */
+enum { BIT2_PACKED = 0, BIT2_PADDED = 1 };
+/* creation flag, or'd into the layout: the words are mapped from the
+   kernel page aligned and, for bitmaps of 2 MB or more, on transparent
+   huge pages (see hugemem.c) */
+#define BIT2_HUGE 0x100
+
 #define T Bit2_T
 typedef struct T{
   int height; /* height of 2D Bitmap */
   int width; /* width of 2D Bitmap */
-  Bit_T set; /* 1D Bitmap */
+  int stride; /* bits from one row to the next: width when packed, width
+                 rounded up to a multiple of 64 when padded */
+  uint64_t *words; /* 1D Bitmap, bit n = stride * row + col; bits that are
+                      not pixels are always 0 */
+  int in_arena; /* 1 if made by Bit2_new_arena; its arena owns the memory */
+  size_t mapped; /* bytes in words if it came from Hugemem_alloc (the
+                    BIT2_HUGE flag), else 0 */
 } *T;
 
+/* a window of width x height bits of a bitmap, whose (0, 0) is the
+   bitmap's (col, row). A view is a plain value: making one allocates
+   nothing, it is copied like an int, and it reads and writes the
+   bitmap's own bits, so it is only good while the bitmap lives */
+typedef struct Bit2_view_T {
+  T bits; /* the bitmap viewed */
+  int col; /* column of the bitmap at the view's column 0 */
+  int row; /* row of the bitmap at the view's row 0 */
+  int width; /* width of the view */
+  int height; /* height of the view */
+} Bit2_view_T;
+
 extern T Bit2_new(int width, int height);
+extern T Bit2_new_layout(int width, int height, int layout);
+extern T Bit2_new_arena(Arena_T arena, int width, int height, int layout);
+extern int Bit2_stride(T set2);
+extern uint64_t *Bit2_row_words(T set2, int row);
 extern int Bit2_row_index(int col, int row);
 extern void Bit2_free(T *set);
 extern int Bit2_height(T set);
 extern int Bit2_width(T set);
 extern int Bit2_get(T set2, int col, int row);
 extern int Bit2_put(T set2, int col, int row, int bit);
+extern int Bit2_next_bit(T set2, int col, int row, int bit);
+extern int Bit2_prev_bit(T set2, int col, int row, int bit);
+extern void Bit2_put_run(T set2, int lo, int hi, int row, int bit);
+extern void Bit2_put_bits(T set2, int col, int row, uint64_t bits, int n);
+extern uint64_t Bit2_get_bits(T set2, int col, int row, int n);
+extern long Bit2_count(T set2);
+extern int Bit2_count_run(T set2, int lo, int hi, int row);
+extern long Bit2_count_rect(T set2, int left, int top, int right,
+                            int bottom);
+extern void Bit2_put_rect(T set2, int left, int top, int right, int bottom,
+                          int bit);
+extern void Bit2_and(T dst, T src);
+extern void Bit2_or(T dst, T src);
+extern void Bit2_xor(T dst, T src);
+extern void Bit2_not(T dst);
+extern void Bit2_copy(T dst, T src);
+extern void Bit2_dilate4(T dst, T src);
 extern void Bit2_map_col_major(T set, void apply(int i, int j, T a, int b,
                                                  void *p1), void *cl);
 extern void Bit2_map_row_major(T set, void apply(int i, int j, T a, int b,
                                                        void *p1), void *cl);
+extern void Bit2_map_blocked(T set, int block, void apply(int i, int j, T a,
+                                                          int b, void *p1),
+                             void *cl);
+extern void Bit2_map_parallel(T set, void apply(int i, int j, T a, int b,
+                                                void *p1), void *cl);
+extern Bit2_view_T Bit2_view(T set2, int col, int row, int width,
+                             int height);
+extern Bit2_view_T Bit2_view_sub(Bit2_view_T view, int col, int row,
+                                 int width, int height);
+extern int Bit2_tile_count(T set2, int tile_width, int tile_height);
+extern Bit2_view_T Bit2_tile(T set2, int tile_width, int tile_height,
+                             int index);
+extern int Bit2_view_get(Bit2_view_T view, int col, int row);
+extern int Bit2_view_put(Bit2_view_T view, int col, int row, int bit);
+extern long Bit2_view_count(Bit2_view_T view);
+extern void Bit2_view_map_row_major(Bit2_view_T view,
+                                    void apply(int i, int j, Bit2_view_T *v,
+                                               int b, void *p1),
+                                    void *cl);
+extern void Bit2_view_map_col_major(Bit2_view_T view,
+                                    void apply(int i, int j, Bit2_view_T *v,
+                                               int b, void *p1),
+                                    void *cl);
+
+/* Inline Bit2_get and Bit2_put for hot loops. Like UArray2_at_unchecked
+   they only check their arguments when built with -DARRAY2_CHECKED */
+static inline int Bit2_get_fast(T set2, int col, int row)
+{
+#ifdef ARRAY2_CHECKED
+        assert(set2 != NULL);
+        assert(0 <= col && col < set2->width);
+        assert(0 <= row && row < set2->height);
+#endif
+        size_t n = (size_t)set2->stride * row + col;
+        return (set2->words[n / 64] >> (n % 64)) & 1;
+}
+
+/* returns the previous bit, as Bit2_put does; bit must be 0 or 1 */
+static inline int Bit2_put_fast(T set2, int col, int row, int bit)
+{
+#ifdef ARRAY2_CHECKED
+        assert(set2 != NULL);
+        assert(bit == 0 || bit == 1);
+        assert(0 <= col && col < set2->width);
+        assert(0 <= row && row < set2->height);
+#endif
+        size_t n = (size_t)set2->stride * row + col;
+        uint64_t *word = &set2->words[n / 64];
+        int prev = (*word >> (n % 64)) & 1;
+        *word ^= (uint64_t)(prev ^ bit) << (n % 64);
+        return prev;
+}
 
 #undef T
 #endif
@@ -0,0 +1,541 @@
+/*
+ * Filename: blackedges.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Black edge removal engines used by unblackedges. A black edge is
+ *          a black pixel on the border of the bitmap, or a black pixel
+ *          4-connected to a black edge. Every engine turns all black edges
+ *          of the passed bitmap into white pixels and leaves every other
+ *          pixel alone, so they all produce the same image.
+ *
+ *          remove_black_edges is the original breadth first search, which
+ *          queues one packed 8 byte cell per pixel in a ring buffer, so its
+ *          memory follows the width of the search wave rather than the
+ *          number of pixels visited. remove_black_edges_scanline fills
+ *          whole runs of black pixels at once using Bit2's word level
+ *          searches, and only queues one entry per run.
+ *          remove_black_edges_dilate grows the border's black pixels by
+ *          whole-word 4-neighbor dilation, ANDed with the black mask, one
+ *          64x64 tile at a time until nothing changes.
+ *          remove_black_edges_label labels the bitmap's components with
+ *          components.c and erases the ones that touch the border.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include "bit2.h"
+#include "blackedges.h"
+#include "components.h"
+
+const int BLACK_PIXEL = 1;
+const int WHITE_PIXEL = 0;
+
+typedef struct Index {
+        int col;
+        int row;
+} Index;
+
+/* FIFO ring buffer of packed (row << 32 | col) cells used by the breadth
+   first search; capacity is always a power of two */
+typedef struct Frontier {
+        uint64_t *cells;
+        size_t head;
+        size_t length;
+        size_t capacity;
+} Frontier;
+
+/* Growable stack of run seeds used by the scanline engine */
+typedef struct Span_stack {
+        Index *spans;
+        int length;
+        int capacity;
+} Span_stack;
+
+/* Stack of tiles waiting to be grown by the dilation engine, with one flag
+   per tile so a tile is never on the stack twice. A tile is TILE_ROWS rows
+   of a single 64 bit word column */
+typedef struct Tile_stack {
+        int *tiles;
+        int length;
+        int capacity;
+        unsigned char *queued;
+} Tile_stack;
+
+enum { TILE_ROWS = 64 };
+
+void check_border(Bit2_T img_map, Frontier *frontier);
+void find_edges(Bit2_T img_map, Frontier *frontier);
+void find_next_edge(Bit2_T img_map, Frontier *frontier, int col, int row);
+void frontier_push(Frontier *frontier, int col, int row);
+uint64_t frontier_pop(Frontier *frontier);
+void push_span(Span_stack *stack, int col, int row);
+void push_row_runs(Bit2_T img_map, Span_stack *stack, int row, int lo, 
+                   int hi);
+int grow_tile(const uint64_t *black, uint64_t *edges, int words, int height,
+              int tile);
+uint64_t fill_runs(uint64_t seed, uint64_t mask);
+void push_tile(Tile_stack *stack, int tile);
+int on_border(const Component *c, void *cl);
+
+/* void remove_black_edges(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file
+ *    Returns: Nothing
+ *       Does: First indexs border of img_map, then finds additional black
+ *             edges branching from the border, finally frees the frontier
+ *             of coordinates
+ */
+void remove_black_edges(Bit2_T img_map)
+{
+        Frontier frontier = { NULL, 0, 0, 0 };
+        /* collects border black edges in frontier */
+        check_border(img_map, &frontier);
+        /* finds branching edges from the border blak edges */
+        find_edges(img_map, &frontier);
+        free(frontier.cells);
+}
+
+/* void find_edges(Bit2_T img_map, Frontier *frontier)
+ * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file 
+ *             [Frontier *frontier] - the queue of border blackedge indexs
+ *    Returns: Nothing
+ *       Does: takes the oldest black edge index off the frontier and adds
+ *             its black edge branchs to the frontier, until no black edges
+ *             are left. Pixels are turned white as they are queued, so no
+ *             pixel is ever queued twice and the frontier only holds the
+ *             current breadth first wave
+ */
+void find_edges(Bit2_T img_map, Frontier *frontier)
+{
+        /* iterates until the frontier of coordinates to check is empty */
+        while (frontier->length > 0) {
+                uint64_t cell = frontier_pop(frontier);
+                int col = (int)(cell & 0xFFFFFFFF);
+                int row = (int)(cell >> 32);
+                /* check for branching edges  */
+                find_next_edge(img_map, frontier, col - 1, row);
+                find_next_edge(img_map, frontier, col + 1, row);
+                find_next_edge(img_map, frontier, col, row - 1);
+                find_next_edge(img_map, frontier, col, row + 1);
+        }
+}
+
+/* void find_next_edge(Bit2_T img_map, Frontier *frontier, int col, int row)
+ * Parameters: [Bit2_T img_map] - the map to check for black edges
+ *             [Frontier *frontier] - queue for adding black edge indexs
+ *             [int col] - col index
+ *             [int row] - row index
+ *    Returns: Nothing
+ *       Does: checks bit at index row and column, which neighbors a black
+ *             edge, and if it is black it is a black edge too, so it is 
+ *             changed to a white pixel and its index added to the frontier
+ */
+void find_next_edge(Bit2_T img_map, Frontier *frontier, int col, int row)
+{
+        if (col > 0 && col < img_map->width - 1 && 
+            row > 0 && row < img_map->height - 1) {
+                /* Not a border pixel */
+                if (Bit2_put_fast(img_map, col, row, WHITE_PIXEL) == 
+                    BLACK_PIXEL) {
+                        frontier_push(frontier, col, row);
+                }
+        } 
+}
+
+/* void check_border(Bit2_T img_map, Frontier *frontier)
+ * Parameters: [Bit2_T img_map] - unmodified bitmap gotten from file
+ *             [Frontier *frontier] - initially empty, in function the indexs
+ *                                    of the black edges on the border are 
+ *                                    added to this queue
+ *    Returns: Nothing
+ *       Does: collects indexs of blackedges on the border of the bitmap in
+ *             frontier, turning each one white. The top and bottom rows are
+ *             searched and cleared a word at a time
+ */
+void check_border(Bit2_T img_map, Frontier *frontier)
+{
+        int bottom = img_map->height - 1;
+        int right = img_map->width - 1;
+        /* Search top and bottom borders, which are the same row when the
+           image is one row high */
+        for (int row = 0; row <= bottom; row += (bottom > 0) ? bottom : 1) {
+                int col = Bit2_next_bit(img_map, 0, row, BLACK_PIXEL);
+                while (col <= right) {
+                        frontier_push(frontier, col, row);
+                        col = Bit2_next_bit(img_map, col + 1, row, 
+                                            BLACK_PIXEL);
+                }
+                Bit2_put_run(img_map, 0, right, row, WHITE_PIXEL);
+        }
+        for (int j = 0; j < img_map->height; j++) {
+                /* Search left border */
+                if (Bit2_put_fast(img_map, 0, j, WHITE_PIXEL) == BLACK_PIXEL) {
+                        frontier_push(frontier, 0, j);
+                }
+                /* Search right border */
+                if (Bit2_put_fast(img_map, right, j, WHITE_PIXEL) == 
+                    BLACK_PIXEL) {
+                        frontier_push(frontier, right, j);
+                }      
+        }
+}
+
+/* void frontier_push(Frontier *frontier, int col, int row)
+ * Parameters: [Frontier *frontier] - the queue to add to
+ *             [int col] - col index
+ *             [int row] - row index
+ *    Returns: Nothing
+ *       Does: adds (col, row) to the back of the ring buffer, doubling it 
+ *             and unwrapping its contents when it is full
+ */
+void frontier_push(Frontier *frontier, int col, int row)
+{
+        if (frontier->length == frontier->capacity) {
+                size_t capacity = (frontier->capacity == 0) ? 
+                                  1024 : frontier->capacity * 2;
+                uint64_t *cells = malloc(capacity * sizeof(uint64_t));
+                if (cells == NULL) {
+                        fprintf(stderr, "Error: memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+                for (size_t i = 0; i < frontier->length; i++) {
+                        cells[i] = frontier->cells[(frontier->head + i) & 
+                                                   (frontier->capacity - 1)];
+                }
+                free(frontier->cells);
+                frontier->cells = cells;
+                frontier->head = 0;
+                frontier->capacity = capacity;
+        }
+        size_t tail = (frontier->head + frontier->length) & 
+                      (frontier->capacity - 1);
+        frontier->cells[tail] = ((uint64_t)row << 32) | (uint32_t)col;
+        frontier->length++;
+}
+
+/* uint64_t frontier_pop(Frontier *frontier)
+ * Parameters: [Frontier *frontier] - a nonempty queue
+ *    Returns: the packed (row << 32 | col) cell at the front of the queue
+ *       Does: removes the front cell
+ */
+uint64_t frontier_pop(Frontier *frontier)
+{
+        uint64_t cell = frontier->cells[frontier->head];
+        frontier->head = (frontier->head + 1) & (frontier->capacity - 1);
+        frontier->length--;
+        return cell;
+}
+
+/* void remove_black_edges_scanline(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file
+ *    Returns: Nothing
+ *       Does: Scanline flood fill from every black border pixel. Each seed
+ *             popped off the stack is grown left and right to its whole run
+ *             of black pixels, the run is turned white in one write, and
+ *             the black runs directly above and below it are pushed as new
+ *             seeds (one stack entry per run, not per pixel)
+ */
+void remove_black_edges_scanline(Bit2_T img_map)
+{
+        Span_stack stack = { NULL, 0, 0 };
+        int width = img_map->width;
+        int height = img_map->height;
+
+        /* top and bottom borders are whole rows, so seed them by run */
+        push_row_runs(img_map, &stack, 0, 0, width - 1);
+        if (height > 1) {
+                push_row_runs(img_map, &stack, height - 1, 0, width - 1);
+        }
+        /* left and right borders cross every row, so seed them by pixel */
+        for (int j = 1; j < height - 1; j++) {
+                if (Bit2_get_fast(img_map, 0, j) == BLACK_PIXEL) {
+                        push_span(&stack, 0, j);
+                }
+                if (Bit2_get_fast(img_map, width - 1, j) == BLACK_PIXEL) {
+                        push_span(&stack, width - 1, j);
+                }
+        }
+
+        while (stack.length > 0) {
+                Index seed = stack.spans[--stack.length];
+                /* seed may have been filled through another run already */
+                if (Bit2_get_fast(img_map, seed.col, seed.row) != BLACK_PIXEL) {
+                        continue;
+                }
+                int lo = Bit2_prev_bit(img_map, seed.col, seed.row,
+                                       WHITE_PIXEL) + 1;
+                int hi = Bit2_next_bit(img_map, seed.col, seed.row,
+                                       WHITE_PIXEL) - 1;
+                Bit2_put_run(img_map, lo, hi, seed.row, WHITE_PIXEL);
+                if (seed.row > 0) {
+                        push_row_runs(img_map, &stack, seed.row - 1, lo, hi);
+                }
+                if (seed.row < height - 1) {
+                        push_row_runs(img_map, &stack, seed.row + 1, lo, hi);
+                }
+        }
+        free(stack.spans);
+}
+
+/* void push_row_runs(Bit2_T img_map, Span_stack *stack, int row, int lo,
+ *                    int hi)
+ * Parameters: [Bit2_T img_map] - the map to search for black runs
+ *             [Span_stack *stack] - stack the found runs are pushed onto
+ *             [int row] - row index to search
+ *             [int lo] - first col index of the searched window
+ *             [int hi] - last col index of the searched window
+ *    Returns: Nothing
+ *       Does: pushes the first pixel of every run of black pixels that
+ *             overlaps columns lo through hi of row
+ */
+void push_row_runs(Bit2_T img_map, Span_stack *stack, int row, int lo, 
+                   int hi)
+{
+        int col = Bit2_next_bit(img_map, lo, row, BLACK_PIXEL);
+        while (col <= hi) {
+                push_span(stack, col, row);
+                col = Bit2_next_bit(img_map, col, row, WHITE_PIXEL);
+                col = Bit2_next_bit(img_map, col, row, BLACK_PIXEL);
+        }
+}
+
+/* void push_span(Span_stack *stack, int col, int row)
+ * Parameters: [Span_stack *stack] - the stack to push onto
+ *             [int col] - col index of the seed
+ *             [int row] - row index of the seed
+ *    Returns: Nothing
+ *       Does: pushes a seed, doubling the stack's storage when it is full
+ */
+void push_span(Span_stack *stack, int col, int row)
+{
+        if (stack->length == stack->capacity) {
+                stack->capacity = (stack->capacity == 0) ? 
+                                  64 : stack->capacity * 2;
+                stack->spans = realloc(stack->spans, 
+                                       stack->capacity * sizeof(Index));
+                if (stack->spans == NULL) {
+                        fprintf(stderr, "Error: memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+        stack->spans[stack->length].col = col;
+        stack->spans[stack->length].row = row;
+        stack->length++;
+}
+
+/* void remove_black_edges_dilate(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file
+ *    Returns: Nothing
+ *       Does: Copies img_map into a padded black mask and seeds a padded
+ *             edge image with the mask's border pixels, then grows the
+ *             edges through the mask until they stop growing. The work is
+ *             split into tiles of TILE_ROWS rows by one word, each grown by
+ *             grow_tile: rather than dilating the whole image a pass at a
+ *             time, as Bit2_dilate4 does, it dilates a word in place, ANDs
+ *             it with the mask and fills it out along its runs of black
+ *             with fill_runs. Only a tile that changed puts its neighbors
+ *             back on the stack, so settled parts of the image are never
+ *             swept again. Finally the edges are cleared out of img_map
+ */
+void remove_black_edges_dilate(Bit2_T img_map)
+{
+        int width = img_map->width;
+        int height = img_map->height;
+        Bit2_T black = Bit2_new_layout(width, height, BIT2_PADDED);
+        Bit2_T edges = Bit2_new_layout(width, height, BIT2_PADDED);
+        Bit2_copy(black, img_map);
+        Bit2_copy(edges, black);
+        if (width > 2 && height > 2) {
+                Bit2_put_rect(edges, 1, 1, width - 2, height - 2, 
+                              WHITE_PIXEL);
+        }
+
+        int words = Bit2_stride(black);
+        int tiles_down = (height + TILE_ROWS - 1) / TILE_ROWS;
+        Tile_stack stack = { NULL, 0, 0, NULL };
+        stack.queued = calloc((size_t)words * tiles_down, 1);
+        if (stack.queued == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        /* every tile holding a border pixel may hold a seed */
+        for (int w = 0; w < words; w++) {
+                push_tile(&stack, w);
+                push_tile(&stack, (tiles_down - 1) * words + w);
+        }
+        for (int t = 0; t < tiles_down; t++) {
+                push_tile(&stack, t * words);
+                push_tile(&stack, t * words + words - 1);
+        }
+
+        const uint64_t *mask = Bit2_row_words(black, 0);
+        uint64_t *grown = Bit2_row_words(edges, 0);
+        while (stack.length > 0) {
+                int tile = stack.tiles[--stack.length];
+                stack.queued[tile] = 0;
+                if (!grow_tile(mask, grown, words, height, tile)) {
+                        continue;
+                }
+                int w = tile % words;
+                int t = tile / words;
+                if (w > 0) {
+                        push_tile(&stack, tile - 1);
+                }
+                if (w < words - 1) {
+                        push_tile(&stack, tile + 1);
+                }
+                if (t > 0) {
+                        push_tile(&stack, tile - words);
+                }
+                if (t < tiles_down - 1) {
+                        push_tile(&stack, tile + words);
+                }
+        }
+
+        /* edges is a subset of black, so XOR clears exactly the edges */
+        Bit2_xor(black, edges);
+        Bit2_copy(img_map, black);
+        free(stack.tiles);
+        free(stack.queued);
+        Bit2_free(&black);
+        Bit2_free(&edges);
+}
+
+/* int grow_tile(const uint64_t *black, uint64_t *edges, int words,
+ *               int height, int tile)
+ * Parameters: [const uint64_t *black] - first word of the padded mask
+ *             [uint64_t *edges] - first word of the padded edge image
+ *             [int words] - words per row of both images
+ *             [int height] - rows in both images
+ *             [int tile] - index of the tile to grow, row of tiles times
+ *             words plus word column
+ *    Returns: 1 if any edge pixel of the tile was added, else 0
+ *       Does: Sweeps the tile's words down and then up, setting each to its
+ *             dilation (the word itself, the words above and below, and the
+ *             end bits of the words left and right) ANDed with the mask and
+ *             filled out along its runs of black, and repeats until a pass
+ *             changes nothing. Words are updated in place, so a pass
+ *             carries new pixels all the way down or up a tile
+ */
+int grow_tile(const uint64_t *black, uint64_t *edges, int words, int height,
+              int tile)
+{
+        int w = tile % words;
+        int first = (tile / words) * TILE_ROWS;
+        int last = (first + TILE_ROWS < height) ? first + TILE_ROWS - 1 
+                                                : height - 1;
+        int changed = 0;
+        int pass_changed;
+        do {
+                pass_changed = 0;
+                for (int step = 0; step < 2; step++) {
+                        for (int k = 0; k <= last - first; k++) {
+                                int row = (step == 0) ? first + k : last - k;
+                                size_t i = (size_t)row * words + w;
+                                uint64_t mask = black[i];
+                                uint64_t seed = edges[i];
+                                if (seed == mask) {
+                                        continue;
+                                }
+                                uint64_t near = seed;
+                                if (row > 0) {
+                                        near |= edges[i - words];
+                                }
+                                if (row < height - 1) {
+                                        near |= edges[i + words];
+                                }
+                                if (w > 0) {
+                                        near |= edges[i - 1] >> 63;
+                                }
+                                if (w < words - 1) {
+                                        near |= edges[i + 1] << 63;
+                                }
+                                uint64_t grown = fill_runs(near & mask, mask);
+                                if (grown != seed) {
+                                        edges[i] = grown;
+                                        pass_changed = 1;
+                                }
+                        }
+                }
+                changed |= pass_changed;
+        } while (pass_changed);
+        return changed;
+}
+
+/* uint64_t fill_runs(uint64_t seed, uint64_t mask)
+ * Parameters: [uint64_t seed] - pixels already reached, a subset of mask
+ *             [uint64_t mask] - black pixels of the same word
+ *    Returns: every pixel of mask in a run of 1 bits that holds a seed
+ *       Does: fills toward bit 63 with one add (the carry from a seed runs
+ *             up to the end of its run) and toward bit 0 with a shift and
+ *             mask fill that doubles its reach each step
+ */
+uint64_t fill_runs(uint64_t seed, uint64_t mask)
+{
+        uint64_t up = (((mask + seed) ^ mask) & mask) | seed;
+        uint64_t down = seed;
+        uint64_t pass = mask;
+        down |= pass & (down >> 1);
+        pass &= pass >> 1;
+        down |= pass & (down >> 2);
+        pass &= pass >> 2;
+        down |= pass & (down >> 4);
+        pass &= pass >> 4;
+        down |= pass & (down >> 8);
+        pass &= pass >> 8;
+        down |= pass & (down >> 16);
+        pass &= pass >> 16;
+        down |= pass & (down >> 32);
+        return up | down;
+}
+
+/* void push_tile(Tile_stack *stack, int tile)
+ * Parameters: [Tile_stack *stack] - the stack to push onto
+ *             [int tile] - index of the tile
+ *    Returns: Nothing
+ *       Does: pushes tile unless it is already waiting, doubling the
+ *             stack's storage when it is full
+ */
+void push_tile(Tile_stack *stack, int tile)
+{
+        if (stack->queued[tile]) {
+                return;
+        }
+        if (stack->length == stack->capacity) {
+                stack->capacity = (stack->capacity == 0) ? 
+                                  64 : stack->capacity * 2;
+                stack->tiles = realloc(stack->tiles, 
+                                       stack->capacity * sizeof(int));
+                if (stack->tiles == NULL) {
+                        fprintf(stderr, "Error: memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+        stack->queued[tile] = 1;
+        stack->tiles[stack->length++] = tile;
+}
+
+/* void remove_black_edges_label(Bit2_T img_map)
+ * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file
+ *    Returns: Nothing
+ *       Does: Labels the 4-connected components of black pixels and erases
+ *             every one with a pixel on the border, which is exactly the
+ *             set of black edges. One pass over the runs finds them all,
+ *             however deep they reach, at the cost of keeping every run
+ */
+void remove_black_edges_label(Bit2_T img_map)
+{
+        Components_T comps = Components_label(img_map, 4);
+        Components_erase(comps, img_map, on_border, NULL);
+        Components_free(&comps);
+}
+
+/* int on_border(const Component *c, void *cl)
+ * Returns: 1 if the component c touches the border of the bitmap, else 0
+ */
+int on_border(const Component *c, void *cl)
+{
+        (void) cl;
+        return c->border;
+}
@@ -0,0 +1,19 @@
+/* blackedges.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for the black edge removal engines, functions explained in 
+ * implementation
+ */
+
+#include "bit2.h"
+
+#ifndef BLACKEDGES_INCLUDED
+#define BLACKEDGES_INCLUDED
+
+extern void remove_black_edges(Bit2_T img_map);
+extern void remove_black_edges_scanline(Bit2_T img_map);
+extern void remove_black_edges_dilate(Bit2_T img_map);
+extern void remove_black_edges_label(Bit2_T img_map);
+
+#endif
@@ -0,0 +1,400 @@
+/*
+ * Filename: boards.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the boards.h interface. A batch
+ *          holds up to 32 boards with cell i of every board next to each
+ *          other, so one 16 or 32 byte vector load picks up the same cell
+ *          of 16 or 32 boards and every board is validated in the same
+ *          instructions.
+ *
+ *          A board is valid under the same rules as check_board in
+ *          sudokucheck.c: every row, column and 3x3 submap holds each of
+ *          1-9 exactly once. Each kernel turns a cell into a 10-bit digit
+ *          mask (bit d for digit d, split over a low byte for 1-7 and a high
+ *          byte for 8-9, and nothing at all for a value outside 1-9) and
+ *          ORs it into its row, column and submap. A unit of nine cells is
+ *          then valid exactly when its mask has all of bits 1-9 set.
+ *
+ *          The SSE2 kernel builds the masks with byte compares, the AVX2
+ *          kernel with two byte shuffles (pshufb table lookups) per cell.
+ *          SSE2 is part of every x86-64 processor; AVX2 is compiled in with
+ *          a target attribute and only used when the processor reports it,
+ *          so the build flags do not change. Anywhere else the scalar
+ *          kernel is used.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "assert.h"
+#include "boards.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BOARDS_X86 1
+#include <immintrin.h>
+#else
+#define BOARDS_X86 0
+#endif
+
+/* the two mask bytes of a unit holding each of 1-9 exactly once */
+#define FULL_LO 0xFE
+#define FULL_HI 0x03
+
+static uint32_t check_scalar(Boards_T boards);
+#if BOARDS_X86
+static uint32_t check_sse2(Boards_T boards, int first);
+static uint32_t check_avx2(Boards_T boards);
+#endif
+
+/* Boards_T Boards_new(void)
+ * Returns:
+ *             Boards_T: a new, empty batch
+ */
+Boards_T Boards_new(void)
+{
+        Boards_T boards = malloc(sizeof(*boards));
+        assert(boards != NULL);
+        Boards_clear(boards);
+        return boards;
+}
+
+/* void Boards_free(Boards_T *boards)
+ * Parameters:
+ *            Boards_T *boards - pointer to the batch to be freed
+ * Does:
+ *            frees memory
+ */
+void Boards_free(Boards_T *boards)
+{
+        assert(boards != NULL && *boards != NULL);
+        free(*boards);
+        *boards = NULL;
+}
+
+/* void Boards_clear(Boards_T boards)
+ * Parameters:
+ *             Boards_T boards: the batch
+ * Does:
+ *             Empties the batch so it can be refilled. Unused lanes are all
+ *             zero, which no kernel accepts as a valid board
+ */
+void Boards_clear(Boards_T boards)
+{
+        assert(boards != NULL);
+        boards->count = 0;
+        memset(boards->cells, 0, sizeof(boards->cells));
+}
+
+/* int Boards_add(Boards_T boards, UArray2_T board)
+ * Parameters:
+ *             Boards_T boards: a batch with room for one more board
+ *             UArray2_T board: 9x9 array of ints, as filled by
+ *                              populate_board in sudoku.c
+ * Returns:
+ *             int: the lane the board was copied into, which is its bit in
+ *             the result of Boards_check
+ * Does:
+ *             Copies the board into the next free lane. A value that does
+ *             not fit in a byte is stored as 0, which is never a digit
+ */
+int Boards_add(Boards_T boards, UArray2_T board)
+{
+        assert(boards != NULL && boards->count < BOARDS_LANES);
+        assert(UArray2_width(board) == 9 && UArray2_height(board) == 9);
+        int lane = boards->count++;
+        for (int row = 0; row < 9; row++) {
+                const int *cells = UArray2_row(board, row);
+                for (int col = 0; col < 9; col++) {
+                        int val = cells[col];
+                        boards->cells[9 * row + col][lane] =
+                                (val < 0 || val > 255) ? 0 : (uint8_t)val;
+                }
+        }
+        return lane;
+}
+
+/* int Boards_add_cells(Boards_T boards, const uint8_t cells[81])
+ * Parameters:
+ *             Boards_T boards: a batch with room for one more board
+ *             const uint8_t cells[81]: a board in row major order
+ * Returns:
+ *             int: the lane the board was copied into
+ * Does:
+ *             Copies an already compact board into the next free lane
+ */
+int Boards_add_cells(Boards_T boards, const uint8_t cells[81])
+{
+        assert(boards != NULL && boards->count < BOARDS_LANES);
+        int lane = boards->count++;
+        for (int i = 0; i < 81; i++) {
+                boards->cells[i][lane] = cells[i];
+        }
+        return lane;
+}
+
+/* int Boards_supported(Boards_kernel kernel)
+ * Returns: 1 if the kernel can run on this machine, else 0
+ */
+int Boards_supported(Boards_kernel kernel)
+{
+        switch (kernel) {
+        case BOARDS_SCALAR:
+                return 1;
+#if BOARDS_X86
+        case BOARDS_SSE2:
+                return 1;
+        case BOARDS_AVX2:
+                return __builtin_cpu_supports("avx2") != 0;
+#endif
+        default:
+                return 0;
+        }
+}
+
+/* const char *Boards_kernel_name(Boards_kernel kernel)
+ * Returns: the kernel's name, for reports
+ */
+const char *Boards_kernel_name(Boards_kernel kernel)
+{
+        static const char *names[] = { "scalar", "sse2", "avx2" };
+        assert(kernel >= BOARDS_SCALAR && kernel <= BOARDS_AVX2);
+        return names[kernel];
+}
+
+/* uint32_t Boards_check(Boards_T boards)
+ * Parameters:
+ *             Boards_T boards: the batch
+ * Returns:
+ *             uint32_t: bit i is set exactly when board i is a solved
+ *             sudoku; bits at or above boards->count are clear
+ * Does:
+ *             Validates the whole batch with the fastest supported kernel.
+ *             The kernel is looked up on every call rather than cached, so
+ *             any number of threads can call this at once; the lookup only
+ *             reads the processor's feature flags. A caller checking many
+ *             batches can pick the kernel once and use Boards_check_kernel
+ */
+uint32_t Boards_check(Boards_T boards)
+{
+        Boards_kernel best = BOARDS_AVX2;
+        while (!Boards_supported(best)) {
+                best--;
+        }
+        return Boards_check_kernel(boards, best);
+}
+
+/* uint32_t Boards_check_kernel(Boards_T boards, Boards_kernel kernel)
+ * Parameters:
+ *             Boards_T boards: the batch
+ *             Boards_kernel kernel: a supported kernel
+ * Returns:
+ *             uint32_t: the same result as Boards_check
+ * Does:
+ *             Validates the whole batch with the given kernel
+ */
+uint32_t Boards_check_kernel(Boards_T boards, Boards_kernel kernel)
+{
+        assert(boards != NULL);
+        assert(Boards_supported(kernel));
+        uint32_t valid;
+#if BOARDS_X86
+        if (kernel == BOARDS_AVX2) {
+                valid = check_avx2(boards);
+        } else if (kernel == BOARDS_SSE2) {
+                valid = check_sse2(boards, 0);
+                if (boards->count > 16) {
+                        valid |= check_sse2(boards, 16) << 16;
+                }
+        } else {
+                valid = check_scalar(boards);
+        }
+#else
+        (void)kernel;
+        valid = check_scalar(boards);
+#endif
+        /* clear lanes are never valid, but mask them off all the same */
+        if (boards->count < BOARDS_LANES) {
+                valid &= ((uint32_t)1 << boards->count) - 1;
+        }
+        return valid;
+}
+
+/* static uint32_t check_scalar(Boards_T boards)
+ * Returns: the valid board mask, computed one board at a time with the
+ *          same 16-bit digit masks as check_board_mask
+ */
+static uint32_t check_scalar(Boards_T boards)
+{
+        uint32_t valid = 0;
+        for (int lane = 0; lane < boards->count; lane++) {
+                uint16_t rows[9] = { 0 };
+                uint16_t cols[9] = { 0 };
+                uint16_t boxes[9] = { 0 };
+                for (int row = 0; row < 9; row++) {
+                        for (int col = 0; col < 9; col++) {
+                                unsigned val = boards->cells[9 * row + col]
+                                                            [lane];
+                                uint16_t bit = (val >= 1 && val <= 9) ?
+                                               (uint16_t)(1u << val) : 0;
+                                rows[row] |= bit;
+                                cols[col] |= bit;
+                                boxes[(row / 3) * 3 + col / 3] |= bit;
+                        }
+                }
+                /* nine cells cover bits 1-9 only if they are 1-9 once each */
+                int full = 1;
+                for (int i = 0; i < 9; i++) {
+                        full &= (rows[i] == 0x3FE) & (cols[i] == 0x3FE) &
+                                (boxes[i] == 0x3FE);
+                }
+                valid |= (uint32_t)full << lane;
+        }
+        return valid;
+}
+
+#if BOARDS_X86
+
+/* static uint32_t check_sse2(Boards_T boards, int first)
+ * Parameters: int first - first of the 16 lanes to check, 0 or 16
+ * Returns: the valid board mask of those 16 lanes, in bits 0-15
+ * Does: Builds each cell's two mask bytes with one compare per digit, then
+ *       ORs them into the row, column and submap accumulators. Rows are
+ *       walked in order, so only one row and three submaps are live at a
+ *       time
+ */
+static uint32_t check_sse2(Boards_T boards, int first)
+{
+        const __m128i zero = _mm_setzero_si128();
+        __m128i col_lo[9], col_hi[9];
+        __m128i ok = _mm_cmpeq_epi8(zero, zero);
+        for (int col = 0; col < 9; col++) {
+                col_lo[col] = zero;
+                col_hi[col] = zero;
+        }
+        for (int band = 0; band < 9; band += 3) {
+                __m128i box_lo[3] = { zero, zero, zero };
+                __m128i box_hi[3] = { zero, zero, zero };
+                for (int row = band; row < band + 3; row++) {
+                        __m128i row_lo = zero;
+                        __m128i row_hi = zero;
+                        for (int col = 0; col < 9; col++) {
+                                __m128i v = _mm_loadu_si128((const __m128i *)
+                                        &boards->cells[9 * row + col][first]);
+                                __m128i lo = zero;
+                                for (int d = 1; d <= 7; d++) {
+                                        __m128i eq = _mm_cmpeq_epi8(v,
+                                                _mm_set1_epi8((char)d));
+                                        lo = _mm_or_si128(lo, _mm_and_si128(
+                                                eq, _mm_set1_epi8(
+                                                (char)(1 << d))));
+                                }
+                                __m128i hi = _mm_or_si128(
+                                        _mm_and_si128(_mm_cmpeq_epi8(v,
+                                                _mm_set1_epi8(8)),
+                                                _mm_set1_epi8(1)),
+                                        _mm_and_si128(_mm_cmpeq_epi8(v,
+                                                _mm_set1_epi8(9)),
+                                                _mm_set1_epi8(2)));
+                                row_lo = _mm_or_si128(row_lo, lo);
+                                row_hi = _mm_or_si128(row_hi, hi);
+                                col_lo[col] = _mm_or_si128(col_lo[col], lo);
+                                col_hi[col] = _mm_or_si128(col_hi[col], hi);
+                                box_lo[col / 3] = _mm_or_si128(
+                                        box_lo[col / 3], lo);
+                                box_hi[col / 3] = _mm_or_si128(
+                                        box_hi[col / 3], hi);
+                        }
+                        ok = _mm_and_si128(ok, _mm_cmpeq_epi8(row_lo,
+                                        _mm_set1_epi8((char)FULL_LO)));
+                        ok = _mm_and_si128(ok, _mm_cmpeq_epi8(row_hi,
+                                        _mm_set1_epi8(FULL_HI)));
+                }
+                for (int box = 0; box < 3; box++) {
+                        ok = _mm_and_si128(ok, _mm_cmpeq_epi8(box_lo[box],
+                                        _mm_set1_epi8((char)FULL_LO)));
+                        ok = _mm_and_si128(ok, _mm_cmpeq_epi8(box_hi[box],
+                                        _mm_set1_epi8(FULL_HI)));
+                }
+        }
+        for (int col = 0; col < 9; col++) {
+                ok = _mm_and_si128(ok, _mm_cmpeq_epi8(col_lo[col],
+                                _mm_set1_epi8((char)FULL_LO)));
+                ok = _mm_and_si128(ok, _mm_cmpeq_epi8(col_hi[col],
+                                _mm_set1_epi8(FULL_HI)));
+        }
+        return (uint32_t)_mm_movemask_epi8(ok) & 0xFFFF;
+}
+
+/* static uint32_t check_avx2(Boards_T boards)
+ * Returns: the valid board mask of all 32 lanes
+ * Does: Same walk as check_sse2 over 32 lanes at once, but each cell's mask
+ *       bytes are two table lookups with vpshufb. Values above 15 are
+ *       clamped to 15 first, and the tables map 0 and 10-15 to no bits
+ */
+__attribute__((target("avx2")))
+static uint32_t check_avx2(Boards_T boards)
+{
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i lo_table = _mm256_setr_epi8(
+                0, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i hi_table = _mm256_setr_epi8(
+                0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 0, 0, 0, 0, 0,
+                0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 0, 0, 0, 0, 0);
+        const __m256i fifteen = _mm256_set1_epi8(15);
+        const __m256i full_lo = _mm256_set1_epi8((char)FULL_LO);
+        const __m256i full_hi = _mm256_set1_epi8(FULL_HI);
+        __m256i col_lo[9], col_hi[9];
+        __m256i ok = _mm256_cmpeq_epi8(zero, zero);
+        for (int col = 0; col < 9; col++) {
+                col_lo[col] = zero;
+                col_hi[col] = zero;
+        }
+        for (int band = 0; band < 9; band += 3) {
+                __m256i box_lo[3] = { zero, zero, zero };
+                __m256i box_hi[3] = { zero, zero, zero };
+                for (int row = band; row < band + 3; row++) {
+                        __m256i row_lo = zero;
+                        __m256i row_hi = zero;
+                        for (int col = 0; col < 9; col++) {
+                                __m256i v = _mm256_loadu_si256(
+                                        (const __m256i *)
+                                        boards->cells[9 * row + col]);
+                                v = _mm256_min_epu8(v, fifteen);
+                                __m256i lo = _mm256_shuffle_epi8(lo_table,
+                                                                 v);
+                                __m256i hi = _mm256_shuffle_epi8(hi_table,
+                                                                 v);
+                                row_lo = _mm256_or_si256(row_lo, lo);
+                                row_hi = _mm256_or_si256(row_hi, hi);
+                                col_lo[col] = _mm256_or_si256(col_lo[col],
+                                                              lo);
+                                col_hi[col] = _mm256_or_si256(col_hi[col],
+                                                              hi);
+                                box_lo[col / 3] = _mm256_or_si256(
+                                        box_lo[col / 3], lo);
+                                box_hi[col / 3] = _mm256_or_si256(
+                                        box_hi[col / 3], hi);
+                        }
+                        ok = _mm256_and_si256(ok,
+                                _mm256_cmpeq_epi8(row_lo, full_lo));
+                        ok = _mm256_and_si256(ok,
+                                _mm256_cmpeq_epi8(row_hi, full_hi));
+                }
+                for (int box = 0; box < 3; box++) {
+                        ok = _mm256_and_si256(ok,
+                                _mm256_cmpeq_epi8(box_lo[box], full_lo));
+                        ok = _mm256_and_si256(ok,
+                                _mm256_cmpeq_epi8(box_hi[box], full_hi));
+                }
+        }
+        for (int col = 0; col < 9; col++) {
+                ok = _mm256_and_si256(ok,
+                        _mm256_cmpeq_epi8(col_lo[col], full_lo));
+                ok = _mm256_and_si256(ok,
+                        _mm256_cmpeq_epi8(col_hi[col], full_hi));
+        }
+        return (uint32_t)_mm256_movemask_epi8(ok);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/* boards.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for boards, a batch of up to BOARDS_LANES 9x9 sudoku boards
+ * stored one byte per cell in structure of arrays order, so that SIMD
+ * kernels can validate every board in the batch at once, functions
+ * explained in implementation
+ */
+
+#include <stdint.h>
+#include "uarray2.h"
+
+#ifndef BOARDS_INCLUDED
+#define BOARDS_INCLUDED
+
+#define BOARDS_LANES 32
+
+#define T Boards_T
+typedef struct T{
+  int count; /* number of boards loaded, at most BOARDS_LANES */
+  uint8_t cells[81][BOARDS_LANES]; /* cells[9 * row + col][board] */
+} *T;
+
+/* the validation kernels, from slowest to fastest */
+typedef enum Boards_kernel {
+        BOARDS_SCALAR, BOARDS_SSE2, BOARDS_AVX2
+} Boards_kernel;
+
+extern T Boards_new(void);
+extern void Boards_free(T *boards);
+extern void Boards_clear(T boards);
+extern int Boards_add(T boards, UArray2_T board);
+extern int Boards_add_cells(T boards, const uint8_t cells[81]);
+extern int Boards_supported(Boards_kernel kernel);
+extern const char *Boards_kernel_name(Boards_kernel kernel);
+extern uint32_t Boards_check(T boards);
+extern uint32_t Boards_check_kernel(T boards, Boards_kernel kernel);
+
+#undef T
+#endif
@@ -0,0 +1,492 @@
+/*
+ * Filename: components.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the components.h interface, a
+ *          two pass connected component labeler for Bit2 bitmaps that
+ *          works on runs of 1 bits rather than on pixels.
+ *
+ *          The first pass finds the runs of each row a word at a time,
+ *          from the bits where a word differs from itself shifted by one
+ *          column, and matches them against the runs of the row above: a
+ *          run takes the label of the first run above it touches and is
+ *          united with the others (union-find, keeping the smaller label
+ *          as the root), and a run that touches none starts a new label.
+ *          Two runs touch when they share a column, or with 8-connectivity
+ *          when they also meet at a corner. These steps are exported too
+ *          (Components_row_runs, Components_match_runs and the Label_forest
+ *          functions), and streamedges.c and paredges.c label their bands
+ *          and strips with them.
+ *          The second pass numbers the roots 1, 2, ... in the order they
+ *          were made and gives every run its root's number, which is one
+ *          pass over the labels since every label's parent is smaller than
+ *          the label, and then adds each run to its component's area,
+ *          bounding box and border flag.
+ *
+ *          The runs and their labels are kept, so the labeling can be
+ *          queried afterwards without touching pixels: the label of a
+ *          pixel is a binary search of its row's runs, a label image is
+ *          one fill per run, and erasing the components that match a test
+ *          (remove_black_edges_label in blackedges.c erases those on the
+ *          border) is one Bit2_put_run per run.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "assert.h"
+#include "bit2.h"
+#include "uarray2.h"
+#include "components.h"
+
+static void label_row(Components_T comps, Bit2_T image, int row,
+                      int *capacity, Label_forest *forest);
+static void grow_runs(Components_T comps, int *capacity);
+static void number_components(Components_T comps, Label_forest *forest);
+static void add_stats(Components_T comps);
+
+/* Components_T Components_label(Bit2_T image, int connectivity)
+ * Parameters:
+ *             Bit2_T image: the bitmap whose 1 bits are labeled
+ *             int connectivity: 4 to join pixels that share a side, 8 to
+ *                               also join pixels that share a corner
+ * Returns:
+ *             Components_T: every component of image, with its stats and
+ *             the runs it is made of
+ * Does:
+ *             Labels image in the two passes described above. Memory is
+ *             12 bytes per run plus 4 per first pass label and 32 per
+ *             component, all freed by Components_free; the bitmap itself
+ *             is only read
+ */
+Components_T Components_label(Bit2_T image, int connectivity)
+{
+        assert(image != NULL);
+        assert(connectivity == 4 || connectivity == 8);
+        Components_T comps = malloc(sizeof(*comps));
+        assert(comps != NULL);
+        comps->width = image->width;
+        comps->height = image->height;
+        comps->connectivity = connectivity;
+        comps->row_first = malloc((image->height + 1) * sizeof(int));
+        assert(comps->row_first != NULL);
+        comps->lo = NULL;
+        comps->hi = NULL;
+        comps->label = NULL;
+        int capacity = 0;
+        Label_forest forest = { NULL, 0, 0 };
+        comps->row_first[0] = 0;
+        for (int row = 0; row < image->height; row++) {
+                label_row(comps, image, row, &capacity, &forest);
+        }
+        number_components(comps, &forest);
+        free(forest.parent);
+        add_stats(comps);
+        return comps;
+}
+
+/* void Components_free(Components_T *comps)
+ * Parameters:
+ *             Components_T *comps: pointer to the labeling to be freed
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Frees the labeling and sets *comps to NULL
+ */
+void Components_free(Components_T *comps)
+{
+        assert(comps != NULL && *comps != NULL);
+        free((*comps)->stats);
+        free((*comps)->row_first);
+        free((*comps)->lo);
+        free((*comps)->hi);
+        free((*comps)->label);
+        free(*comps);
+        *comps = NULL;
+}
+
+/* int Components_count(Components_T comps)
+ * Returns: the number of components, which are labeled 1 to that number
+ */
+int Components_count(Components_T comps)
+{
+        assert(comps != NULL);
+        return comps->count;
+}
+
+/* Component Components_stats(Components_T comps, int label)
+ * Returns: the area, bounding box and border flag of component label,
+ *          which must be 1 to Components_count(comps)
+ */
+Component Components_stats(Components_T comps, int label)
+{
+        assert(comps != NULL);
+        assert(1 <= label && label <= comps->count);
+        return comps->stats[label];
+}
+
+/* int Components_at(Components_T comps, int col, int row)
+ * Parameters:
+ *             Components_T comps: the labeling being queried
+ *             int col, int row: a pixel of the labeled bitmap
+ * Returns:
+ *             int: the label of the component holding the pixel, or 0 if
+ *             the pixel was a 0 bit
+ * Does:
+ *             Binary searches the runs of row for one covering col
+ */
+int Components_at(Components_T comps, int col, int row)
+{
+        assert(comps != NULL);
+        assert(0 <= col && col < comps->width);
+        assert(0 <= row && row < comps->height);
+        int first = comps->row_first[row];
+        int end = comps->row_first[row + 1];
+        /* find the first run that ends at or after col */
+        while (first < end) {
+                int middle = first + (end - first) / 2;
+                if (comps->hi[middle] < col) {
+                        first = middle + 1;
+                } else {
+                        end = middle;
+                }
+        }
+        if (first < comps->row_first[row + 1] && comps->lo[first] <= col) {
+                return comps->label[first];
+        }
+        return 0;
+}
+
+/* UArray2_T Components_image(Components_T comps)
+ * Returns: a new row major width x height array of ints holding the label
+ *          of every pixel, 0 for the 0 bits, which the caller frees with
+ *          UArray2_free
+ */
+UArray2_T Components_image(Components_T comps)
+{
+        assert(comps != NULL);
+        UArray2_T labels = UArray2_new(comps->width, comps->height,
+                                       sizeof(int));
+        for (int row = 0; row < comps->height; row++) {
+                int *elems = UArray2_row(labels, row);
+                for (int k = comps->row_first[row];
+                     k < comps->row_first[row + 1]; k++) {
+                        int label = comps->label[k];
+                        for (int col = comps->lo[k]; col <= comps->hi[k];
+                             col++) {
+                                elems[col] = label;
+                        }
+                }
+        }
+        return labels;
+}
+
+/* void Components_erase(Components_T comps, Bit2_T image,
+ *                       int erase(const Component *c, void *cl), void *cl)
+ * Parameters:
+ *             Components_T comps: a labeling of image
+ *             Bit2_T image: the bitmap comps was made from
+ *             int erase(const Component *c, void *cl): test called once
+ *                  per component, returning nonzero for the ones to erase
+ *             void *cl: closure passed to erase
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Turns every pixel of each component erase picks into a 0
+ *             bit, a run at a time. comps still describes the image as it
+ *             was, so it should not be used on image again afterwards
+ */
+void Components_erase(Components_T comps, Bit2_T image,
+                      int erase(const Component *c, void *cl), void *cl)
+{
+        assert(comps != NULL && image != NULL);
+        assert(image->width == comps->width);
+        assert(image->height == comps->height);
+        unsigned char *gone = malloc(comps->count + 1);
+        assert(gone != NULL);
+        for (int label = 1; label <= comps->count; label++) {
+                gone[label] = erase(&comps->stats[label], cl) != 0;
+        }
+        for (int row = 0; row < comps->height; row++) {
+                for (int k = comps->row_first[row];
+                     k < comps->row_first[row + 1]; k++) {
+                        if (gone[comps->label[k]]) {
+                                Bit2_put_run(image, comps->lo[k],
+                                             comps->hi[k], row, 0);
+                        }
+                }
+        }
+        free(gone);
+}
+
+/* void Components_row_runs(Bit2_T image, int row, Run_list *runs)
+ * Parameters:
+ *             Bit2_T image: the bitmap read
+ *             int row: the row of image whose runs are found
+ *             Run_list *runs: where the runs go, with room for
+ *                             (width + 1) / 2 of them, the most a row of
+ *                             width pixels can hold
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Sets runs to the first and last column of every run of 1
+ *             bits in the row, left to right, leaving the labels alone.
+ *             The row is read 64 bits at a time; XORing a word with itself
+ *             shifted by one column leaves a 1 wherever a run starts or
+ *             ends, so each run costs two count trailing zeros no matter
+ *             how short or long it is
+ */
+void Components_row_runs(Bit2_T image, int row, Run_list *runs)
+{
+        assert(image != NULL && runs != NULL);
+        assert(0 <= row && row < image->height);
+        int width = image->width;
+        int length = 0;
+        int start = -1; /* column the open run started at, -1 if none */
+        uint64_t last = 0; /* the bit left of the word, 0 at the left edge */
+        for (int col = 0; col < width; col += 64) {
+                int n = (width - col < 64) ? width - col : 64;
+                uint64_t bits = Bit2_get_bits(image, col, row, n);
+                /* bits past n are 0, so a run reaching the right edge
+                   ends at bit n of edges, unless n is 64 */
+                uint64_t edges = bits ^ ((bits << 1) | last);
+                last = bits >> 63;
+                while (edges != 0) {
+                        int at = col + __builtin_ctzll(edges);
+                        edges &= edges - 1;
+                        if (start < 0) {
+                                start = at;
+                                continue;
+                        }
+                        runs->lo[length] = start;
+                        runs->hi[length] = at - 1;
+                        length++;
+                        start = -1;
+                }
+        }
+        if (start >= 0) {
+                runs->lo[length] = start;
+                runs->hi[length] = width - 1;
+                length++;
+        }
+        runs->length = length;
+}
+
+/* void Components_match_runs(const Run_list *above, Run_list *below,
+ *                            int connectivity, Label_forest *forest)
+ * Parameters:
+ *             const Run_list *above: the labeled runs of a row
+ *             Run_list *below: the runs of the next row down, labeled here
+ *             int connectivity: 4 or 8, as for Components_label
+ *             Label_forest *forest: the forest above's labels belong to,
+ *                                   or NULL to only look labels up
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Walks the two sorted lists together, giving each run of
+ *             below the label of the first run of above that touches it.
+ *             With a forest, that label is united with the label of every
+ *             other run of above the run touches, and a run that touches
+ *             none gets a new label; without one, such a run is labeled
+ *             COMPONENTS_NO_LABEL
+ */
+void Components_match_runs(const Run_list *above, Run_list *below,
+                           int connectivity, Label_forest *forest)
+{
+        assert(above != NULL && below != NULL);
+        assert(connectivity == 4 || connectivity == 8);
+        /* how far past its ends a run reaches into the row above */
+        int reach = (connectivity == 8) ? 1 : 0;
+        int i = 0;
+        for (int k = 0; k < below->length; k++) {
+                int lo = below->lo[k] - reach;
+                int hi = below->hi[k] + reach;
+                uint32_t label = COMPONENTS_NO_LABEL;
+                /* skip the runs above that end before this one reaches */
+                while (i < above->length && above->hi[i] < lo) {
+                        i++;
+                }
+                for (int n = i; n < above->length && above->lo[n] <= hi;
+                     n++) {
+                        if (label == COMPONENTS_NO_LABEL) {
+                                label = above->label[n];
+                        } else if (forest != NULL) {
+                                Components_unite(forest->parent, label,
+                                                 above->label[n]);
+                        }
+                }
+                if (label == COMPONENTS_NO_LABEL && forest != NULL) {
+                        label = Components_new_label(forest);
+                }
+                below->label[k] = label;
+        }
+}
+
+/* uint32_t Components_new_label(Label_forest *forest)
+ * Parameters:
+ *             Label_forest *forest: the forest grown, which starts out as
+ *                                   { NULL, 0, 0 } and whose parent the
+ *                                   caller frees
+ * Returns:
+ *             uint32_t: the next label, forest->length before the call,
+ *             in a set of its own
+ * Does:
+ *             Doubles forest->parent when it is full, so pointers into it
+ *             do not outlive the call
+ */
+uint32_t Components_new_label(Label_forest *forest)
+{
+        assert(forest != NULL);
+        if (forest->length == forest->capacity) {
+                assert(forest->capacity < COMPONENTS_NO_LABEL / 2);
+                forest->capacity = (forest->capacity == 0) ?
+                                   1024 : forest->capacity * 2;
+                forest->parent = realloc(forest->parent, forest->capacity *
+                                                         sizeof(uint32_t));
+                assert(forest->parent != NULL);
+        }
+        uint32_t label = forest->length++;
+        forest->parent[label] = label;
+        return label;
+}
+
+/* uint32_t Components_find(uint32_t *parent, uint32_t label)
+ * Parameters:
+ *             uint32_t *parent: a union-find forest, parent[i] being i
+ *                               for a root
+ *             uint32_t label: a label of the forest
+ * Returns:
+ *             uint32_t: the root of label's set
+ * Does:
+ *             Points every other label on the way at its grandparent (path
+ *             halving), so later finds along the path are shorter
+ */
+uint32_t Components_find(uint32_t *parent, uint32_t label)
+{
+        assert(parent != NULL);
+        while (parent[label] != label) {
+                parent[label] = parent[parent[label]];
+                label = parent[label];
+        }
+        return label;
+}
+
+/* void Components_unite(uint32_t *parent, uint32_t a, uint32_t b)
+ * Parameters:
+ *             uint32_t *parent: a union-find forest
+ *             uint32_t a, uint32_t b: labels of the forest
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Merges the sets of a and b, the larger root pointing at the
+ *             smaller. A forest built only by Components_new_label and
+ *             this keeps every parent at or below its label, so one pass
+ *             in label order can point every label at its root
+ */
+void Components_unite(uint32_t *parent, uint32_t a, uint32_t b)
+{
+        uint32_t root_a = Components_find(parent, a);
+        uint32_t root_b = Components_find(parent, b);
+        if (root_a < root_b) {
+                parent[root_b] = root_a;
+        } else if (root_b < root_a) {
+                parent[root_a] = root_b;
+        }
+}
+
+/* static void label_row(Components_T comps, Bit2_T image, int row,
+ *                       int *capacity, Label_forest *forest)
+ * Does: appends the runs of row of image to the runs of comps, ends the
+ *       row in row_first, and labels the runs against the row above
+ */
+static void label_row(Components_T comps, Bit2_T image, int row,
+                      int *capacity, Label_forest *forest)
+{
+        int first = comps->row_first[row];
+        while (*capacity - first < (image->width + 1) / 2) {
+                grow_runs(comps, capacity);
+        }
+        Run_list above = { NULL, NULL, NULL, 0 };
+        if (row > 0) {
+                int above_first = comps->row_first[row - 1];
+                above.lo = comps->lo + above_first;
+                above.hi = comps->hi + above_first;
+                above.label = comps->label + above_first;
+                above.length = first - above_first;
+        }
+        Run_list runs = { comps->lo + first, comps->hi + first,
+                          comps->label + first, 0 };
+        Components_row_runs(image, row, &runs);
+        Components_match_runs(&above, &runs, comps->connectivity, forest);
+        comps->row_first[row + 1] = first + runs.length;
+}
+
+/* static void grow_runs(Components_T comps, int *capacity)
+ * Does: doubles the storage for runs, whose size is *capacity
+ */
+static void grow_runs(Components_T comps, int *capacity)
+{
+        assert(*capacity < INT_MAX / 2);
+        *capacity = (*capacity == 0) ? 1024 : *capacity * 2;
+        comps->lo = realloc(comps->lo, *capacity * sizeof(int));
+        comps->hi = realloc(comps->hi, *capacity * sizeof(int));
+        comps->label = realloc(comps->label, *capacity * sizeof(uint32_t));
+        assert(comps->lo != NULL && comps->hi != NULL &&
+               comps->label != NULL);
+}
+
+/* static void number_components(Components_T comps, Label_forest *forest)
+ * Does: numbers the roots of forest 1, 2, ... in label order, which is the
+ *       row major order of each component's first pixel, sets count, and
+ *       replaces every run's first pass label with its root's number
+ */
+static void number_components(Components_T comps, Label_forest *forest)
+{
+        uint32_t *parent = forest->parent;
+        int count = 0;
+        /* a label's parent is smaller, so it is numbered already; parent
+           entries below label hold numbers from here on, not labels */
+        for (uint32_t label = 0; label < forest->length; label++) {
+                if (parent[label] == label) {
+                        parent[label] = ++count;
+                } else {
+                        parent[label] = parent[parent[label]];
+                }
+        }
+        comps->count = count;
+        int runs = comps->row_first[comps->height];
+        for (int k = 0; k < runs; k++) {
+                comps->label[k] = parent[comps->label[k]];
+        }
+}
+
+/* static void add_stats(Components_T comps)
+ * Does: fills comps->stats with the area, bounding box and border flag of
+ *       each component, from its runs
+ */
+static void add_stats(Components_T comps)
+{
+        comps->stats = calloc(comps->count + 1, sizeof(Component));
+        assert(comps->stats != NULL);
+        for (int row = 0; row < comps->height; row++) {
+                int edge_row = (row == 0 || row == comps->height - 1);
+                for (int k = comps->row_first[row];
+                     k < comps->row_first[row + 1]; k++) {
+                        Component *c = &comps->stats[comps->label[k]];
+                        int lo = comps->lo[k];
+                        int hi = comps->hi[k];
+                        if (c->area == 0) {
+                                c->left = lo;
+                                c->right = hi;
+                                c->top = row;
+                        }
+                        c->area += hi - lo + 1;
+                        c->left = (lo < c->left) ? lo : c->left;
+                        c->right = (hi > c->right) ? hi : c->right;
+                        c->bottom = row;
+                        if (edge_row || lo == 0 || hi == comps->width - 1) {
+                                c->border = 1;
+                        }
+                }
+        }
+}
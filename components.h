@@ -0,0 +1,81 @@
+/* components.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for components, the connected component labeler for Bit2
+ * bitmaps, functions explained in implementation
+ */
+
+#include <stdint.h>
+#include "bit2.h"
+#include "uarray2.h"
+
+#ifndef COMPONENTS_INCLUDED
+#define COMPONENTS_INCLUDED
+
+/* what the labeler knows about one component (a blob of 1 bits) */
+typedef struct Component {
+  long area; /* number of pixels */
+  int left; /* bounding box, inclusive */
+  int top;
+  int right;
+  int bottom;
+  int border; /* 1 if any pixel is on the edge of the bitmap */
+} Component;
+
+#define T Components_T
+typedef struct T {
+  int width; /* size of the labeled bitmap */
+  int height;
+  int connectivity; /* 4 or 8 */
+  int count; /* components, labeled 1 to count in the order their first
+                pixels come in row major order */
+  Component *stats; /* stats[label] for label 1 to count; stats[0] is
+                       unused */
+  int *row_first; /* runs of row r are row_first[r] to row_first[r + 1] - 1 */
+  int *lo; /* first column of each run of 1 bits, row by row */
+  int *hi; /* last column of each run */
+  uint32_t *label; /* label of each run */
+} *T;
+
+extern T Components_label(Bit2_T image, int connectivity);
+extern void Components_free(T *comps);
+extern int Components_count(T comps);
+extern Component Components_stats(T comps, int label);
+extern int Components_at(T comps, int col, int row);
+extern UArray2_T Components_image(T comps);
+extern void Components_erase(T comps, Bit2_T image,
+                             int erase(const Component *c, void *cl),
+                             void *cl);
+
+/* The pieces the labeler is built from, for the black edge engines that
+   label a strip or a band at a time instead of a whole bitmap */
+
+/* run label that means "touches no run in the row above" */
+#define COMPONENTS_NO_LABEL UINT32_MAX
+
+/* the runs of 1 bits of one row, left to right, and their labels */
+typedef struct Run_list {
+  int *lo; /* first column of each run */
+  int *hi; /* last column of each run */
+  uint32_t *label;
+  int length;
+} Run_list;
+
+/* union-find forest over labels, in which every label's parent is at or
+   below the label itself */
+typedef struct Label_forest {
+  uint32_t *parent;
+  uint32_t length; /* labels handed out */
+  uint32_t capacity;
+} Label_forest;
+
+extern void Components_row_runs(Bit2_T image, int row, Run_list *runs);
+extern void Components_match_runs(const Run_list *above, Run_list *below,
+                                  int connectivity, Label_forest *forest);
+extern uint32_t Components_new_label(Label_forest *forest);
+extern uint32_t Components_find(uint32_t *parent, uint32_t label);
+extern void Components_unite(uint32_t *parent, uint32_t a, uint32_t b);
+
+#undef T
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Filename: hugemem.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the hugemem.h interface, which
+ *          maps zeroed storage for large UArray2 and Bit2 images straight
+ *          from the kernel. A block of at least HUGEMEM_PAGE_BYTES starts
+ *          on a huge page boundary, is a whole number of huge pages long,
+ *          and is marked MADV_HUGEPAGE, so where transparent huge pages
+ *          are enabled one TLB entry covers 2 MB of the image instead of
+ *          4 KB; a column major map or a flood fill over a 500 MB image
+ *          otherwise touches a new 4 KB page on almost every step. A
+ *          smaller block is mapped in ordinary pages. Either way the block
+ *          is page aligned, which covers any cache line or vector alignment.
+ *
+ *          Where the kernel has no MADV_HUGEPAGE, or has huge pages turned
+ *          off, the advice is ignored and the block is still aligned.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "assert.h"
+#include "hugemem.h"
+
+static size_t mapped_bytes(size_t bytes);
+
+/* void *Hugemem_alloc(size_t bytes)
+ * Parameters:
+ *             size_t bytes: size of the block, above 0
+ * Returns:
+ *             void *: a page aligned block of bytes bytes, all 0
+ * Does:
+ *             Maps the block as described above, raising Assert_Failed if
+ *             the kernel refuses the mapping. The block must be released
+ *             with Hugemem_free and the same byte count, not with free
+ */
+void *Hugemem_alloc(size_t bytes)
+{
+        assert(bytes > 0);
+        size_t length = mapped_bytes(bytes);
+        if (length < HUGEMEM_PAGE_BYTES) {
+                void *block = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                assert(block != MAP_FAILED);
+                return block;
+        }
+
+        /* map one huge page extra, then trim both ends so what is left
+           starts on a huge page boundary */
+        char *map = mmap(NULL, length + HUGEMEM_PAGE_BYTES,
+                         PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+        assert(map != MAP_FAILED);
+        size_t head = (HUGEMEM_PAGE_BYTES -
+                       (uintptr_t)map % HUGEMEM_PAGE_BYTES) %
+                      HUGEMEM_PAGE_BYTES;
+        if (head != 0) {
+                munmap(map, head);
+        }
+        munmap(map + head + length, HUGEMEM_PAGE_BYTES - head);
+        char *block = map + head;
+#ifdef MADV_HUGEPAGE
+        madvise(block, length, MADV_HUGEPAGE);
+#endif
+        return block;
+}
+
+/* void Hugemem_free(void *block, size_t bytes)
+ * Parameters:
+ *             void *block: a block from Hugemem_alloc, or NULL
+ *             size_t bytes: the byte count block was allocated with
+ * Returns:
+ *             void: Nothing
+ * Does:
+ *             Unmaps block, returning its pages to the kernel
+ */
+void Hugemem_free(void *block, size_t bytes)
+{
+        if (block == NULL) {
+                return;
+        }
+        munmap(block, mapped_bytes(bytes));
+}
+
+/* static size_t mapped_bytes(size_t bytes)
+ * Returns: bytes rounded up to whole huge pages if it is at least one huge
+ *          page, otherwise to whole ordinary pages
+ */
+static size_t mapped_bytes(size_t bytes)
+{
+        size_t page = HUGEMEM_PAGE_BYTES;
+        if (bytes < HUGEMEM_PAGE_BYTES) {
+                page = sysconf(_SC_PAGESIZE);
+        }
+        return (bytes + page - 1) / page * page;
+}
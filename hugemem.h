@@ -0,0 +1,20 @@
+/* hugemem.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for hugemem, the page mapped storage behind the UARRAY2_HUGE
+ * and BIT2_HUGE creation flags, functions explained in implementation
+ */
+
+#include <stddef.h>
+
+#ifndef HUGEMEM_INCLUDED
+#define HUGEMEM_INCLUDED
+
+/* the x86-64 transparent huge page size */
+#define HUGEMEM_PAGE_BYTES (2 * 1024 * 1024)
+
+extern void *Hugemem_alloc(size_t bytes);
+extern void Hugemem_free(void *block, size_t bytes);
+
+#endif
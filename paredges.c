@@ -0,0 +1,371 @@
+/*
+ * Filename: paredges.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Multithreaded black edge removal. The bitmap is cut into
+ *          horizontal strips, one per thread, and the work runs in three
+ *          steps:
+ *
+ *          1. (parallel) each thread labels the black 4-connected
+ *             components of its strip with the labeler's steps from
+ *             components.c: Components_row_runs finds the runs of black
+ *             pixels in each row and Components_match_runs labels them
+ *             against the runs of the row above, in a forest per strip
+ *          2. (serial) the strips' forests are joined into one, the labels
+ *             of runs that overlap across each strip boundary are united,
+ *             the forest is flattened so every label points straight at its
+ *             root, and every component with a run on the border of the
+ *             image is flagged
+ *          3. (parallel) each thread turns the runs of flagged components
+ *             in its strip white
+ *
+ *          Bit2_T rows are packed back to back, so the last row of one strip
+ *          can share a word with the first row of the next. Step 3 leaves
+ *          the first and last row of every strip alone and those rows are
+ *          cleared serially afterwards. That keeps the rows two threads
+ *          write 2 * width + 1 bits apart, which is a word or more once the
+ *          image is 32 pixels wide (or padded, when rows never share a
+ *          word); a narrower packed image is cleared on one thread, since
+ *          two threads could otherwise write the same word and lose an
+ *          update. The result is bit identical to remove_black_edges.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <assert.h>
+#include "bit2.h"
+#include "components.h"
+#include "paredges.h"
+
+/* one thread's share of the image and of the labeling */
+typedef struct Strip {
+        Bit2_T img_map;
+        int first_row;        /* first row of the strip */
+        int end_row;          /* one past the last row of the strip */
+        int *lo;              /* every black run in the strip, row by row */
+        int *hi;
+        uint32_t *label;      /* label of each run in forest */
+        size_t length;
+        size_t capacity;
+        size_t *row_start;    /* index in lo of each row's first run, plus
+                                 one entry for the end of the last row */
+        Label_forest forest;  /* the strip's labels, in step 1 */
+        uint32_t offset;      /* global number of the strip's label 0 */
+        const uint32_t *parent; /* the joined forest, from step 2 on */
+        const uint8_t *flagged; /* per root: 1 if it touches the border */
+} Strip;
+
+static void *label_strip(void *cl);
+static void *clear_strip(void *cl);
+static void run_threads(Strip *strips, int nthreads, void *work(void *cl));
+static void join_strips(Strip *above, Strip *below, uint32_t *parent);
+static void grow_runs(Strip *strip, size_t need);
+static void clear_row(Strip *strip, int row);
+static void *checked_alloc(size_t nbytes);
+
+/* int paredges_default_threads(void)
+ * Returns: the number of online processors, or 1 if it cannot be found
+ */
+int paredges_default_threads(void)
+{
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return (n > 0) ? (int)n : 1;
+}
+
+/* void remove_black_edges_parallel(Bit2_T img_map, int nthreads)
+ * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file
+ *             [int nthreads] - number of threads, or 0 for one per processor
+ *    Returns: Nothing
+ *       Does: Turns every black edge white with the three steps described
+ *             at the top of this file
+ */
+void remove_black_edges_parallel(Bit2_T img_map, int nthreads)
+{
+        assert(img_map != NULL);
+        if (nthreads <= 0) {
+                nthreads = paredges_default_threads();
+        }
+        if (nthreads > img_map->height) {
+                nthreads = img_map->height;
+        }
+
+        Strip *strips = checked_alloc(nthreads * sizeof(Strip));
+        for (int s = 0; s < nthreads; s++) {
+                Strip *strip = &strips[s];
+                strip->img_map = img_map;
+                strip->first_row = (int)((int64_t)img_map->height * s /
+                                         nthreads);
+                strip->end_row = (int)((int64_t)img_map->height * (s + 1) /
+                                       nthreads);
+                strip->lo = NULL;
+                strip->hi = NULL;
+                strip->label = NULL;
+                strip->length = 0;
+                strip->capacity = 0;
+                strip->row_start = NULL;
+                strip->forest.parent = NULL;
+                strip->forest.length = 0;
+                strip->forest.capacity = 0;
+                strip->parent = NULL;
+                strip->flagged = NULL;
+        }
+
+        /* step 1 */
+        run_threads(strips, nthreads, label_strip);
+
+        /* step 2: one forest over every strip's labels, numbered strip by
+           strip */
+        size_t total = 0;
+        for (int s = 0; s < nthreads; s++) {
+                strips[s].offset = (uint32_t)total;
+                total += strips[s].forest.length;
+                assert(total < UINT32_MAX);
+        }
+        uint32_t *parent = checked_alloc((total + 1) * sizeof(uint32_t));
+        for (int s = 0; s < nthreads; s++) {
+                Strip *strip = &strips[s];
+                for (uint32_t i = 0; i < strip->forest.length; i++) {
+                        parent[strip->offset + i] = strip->forest.parent[i] +
+                                                    strip->offset;
+                }
+                free(strip->forest.parent);
+                strip->parent = parent;
+        }
+        for (int s = 1; s < nthreads; s++) {
+                join_strips(&strips[s - 1], &strips[s], parent);
+        }
+        /* Components_unite keeps every parent at or below its label, so
+           one pass in label order points every label at its root */
+        for (size_t i = 0; i < total; i++) {
+                parent[i] = parent[parent[i]];
+        }
+
+        uint8_t *flagged = checked_alloc(total + 1);
+        memset(flagged, 0, total + 1);
+        int last_col = img_map->width - 1;
+        for (int s = 0; s < nthreads; s++) {
+                Strip *strip = &strips[s];
+                int nrows = strip->end_row - strip->first_row;
+                for (int r = 0; r < nrows; r++) {
+                        int row = strip->first_row + r;
+                        int edge_row = (row == 0 ||
+                                        row == img_map->height - 1);
+                        for (size_t i = strip->row_start[r];
+                             i < strip->row_start[r + 1]; i++) {
+                                if (edge_row || strip->lo[i] == 0 ||
+                                    strip->hi[i] == last_col) {
+                                        flagged[parent[strip->offset +
+                                                       strip->label[i]]] = 1;
+                                }
+                        }
+                }
+                strip->flagged = flagged;
+        }
+
+        /* step 3, then the rows at the strip boundaries */
+        if (img_map->stride % 64 == 0 || 2 * img_map->width >= 64) {
+                run_threads(strips, nthreads, clear_strip);
+        } else {
+                for (int s = 0; s < nthreads; s++) {
+                        clear_strip(&strips[s]);
+                }
+        }
+        for (int s = 0; s < nthreads; s++) {
+                clear_row(&strips[s], strips[s].first_row);
+                if (strips[s].end_row - 1 != strips[s].first_row) {
+                        clear_row(&strips[s], strips[s].end_row - 1);
+                }
+        }
+
+        for (int s = 0; s < nthreads; s++) {
+                free(strips[s].lo);
+                free(strips[s].hi);
+                free(strips[s].label);
+                free(strips[s].row_start);
+        }
+        free(flagged);
+        free(parent);
+        free(strips);
+}
+
+/* static void *label_strip(void *cl)
+ * Parameters: [void *cl] - the Strip to label
+ *    Returns: NULL
+ *       Does: Step 1 for one strip. Each row's runs are appended to the
+ *             strip's runs and labeled against the row above, starting
+ *             fresh at the strip's first row
+ */
+static void *label_strip(void *cl)
+{
+        Strip *strip = cl;
+        Bit2_T img_map = strip->img_map;
+        int max_runs = (img_map->width + 1) / 2;
+        int nrows = strip->end_row - strip->first_row;
+        strip->row_start = checked_alloc((nrows + 1) * sizeof(size_t));
+
+        for (int r = 0; r < nrows; r++) {
+                size_t first = strip->length;
+                strip->row_start[r] = first;
+                grow_runs(strip, first + max_runs);
+                Run_list above = { NULL, NULL, NULL, 0 };
+                if (r > 0) {
+                        size_t above_first = strip->row_start[r - 1];
+                        above.lo = strip->lo + above_first;
+                        above.hi = strip->hi + above_first;
+                        above.label = strip->label + above_first;
+                        above.length = (int)(first - above_first);
+                }
+                Run_list runs = { strip->lo + first, strip->hi + first,
+                                  strip->label + first, 0 };
+                Components_row_runs(img_map, strip->first_row + r, &runs);
+                Components_match_runs(&above, &runs, 4, &strip->forest);
+                strip->length += runs.length;
+        }
+        strip->row_start[nrows] = strip->length;
+        return NULL;
+}
+
+/* static void *clear_strip(void *cl)
+ * Parameters: [void *cl] - the Strip to clear
+ *    Returns: NULL
+ *       Does: Step 3 for one strip, leaving its first and last rows alone.
+ *             The flattened forest is only read here, so the threads can
+ *             share it
+ */
+static void *clear_strip(void *cl)
+{
+        Strip *strip = cl;
+        for (int row = strip->first_row + 1; row < strip->end_row - 1;
+             row++) {
+                int r = row - strip->first_row;
+                for (size_t i = strip->row_start[r];
+                     i < strip->row_start[r + 1]; i++) {
+                        uint32_t root = strip->parent[strip->offset +
+                                                      strip->label[i]];
+                        if (strip->flagged[root]) {
+                                Bit2_put_run(strip->img_map, strip->lo[i],
+                                             strip->hi[i], row, 0);
+                        }
+                }
+        }
+        return NULL;
+}
+
+/* static void clear_row(Strip *strip, int row)
+ * Parameters: [Strip *strip] - strip holding row
+ *             [int row] - row index to clear
+ *    Returns: Nothing
+ *       Does: Turns the runs of flagged components in one row white
+ */
+static void clear_row(Strip *strip, int row)
+{
+        int r = row - strip->first_row;
+        for (size_t i = strip->row_start[r]; i < strip->row_start[r + 1];
+             i++) {
+                uint32_t root = strip->parent[strip->offset +
+                                              strip->label[i]];
+                if (strip->flagged[root]) {
+                        Bit2_put_run(strip->img_map, strip->lo[i],
+                                     strip->hi[i], row, 0);
+                }
+        }
+}
+
+/* static void run_threads(Strip *strips, int nthreads, void *work(void *cl))
+ * Parameters: [Strip *strips] - one strip per thread
+ *             [int nthreads] - number of strips
+ *             [void *work(void *cl)] - function run on each strip
+ *    Returns: Nothing
+ *       Does: Runs work on every strip at once, the first strip on the
+ *             calling thread, and waits for all of them to finish
+ */
+static void run_threads(Strip *strips, int nthreads, void *work(void *cl))
+{
+        pthread_t *threads = checked_alloc(nthreads * sizeof(pthread_t));
+        for (int s = 1; s < nthreads; s++) {
+                if (pthread_create(&threads[s], NULL, work, &strips[s]) != 0) {
+                        fprintf(stderr, "Error: could not create thread\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+        work(&strips[0]);
+        for (int s = 1; s < nthreads; s++) {
+                pthread_join(threads[s], NULL);
+        }
+        free(threads);
+}
+
+/* static void join_strips(Strip *above, Strip *below, uint32_t *parent)
+ * Parameters: [Strip *above] - strip whose last row meets below
+ *             [Strip *below] - the next strip down
+ *             [uint32_t *parent] - the joined forest
+ *    Returns: Nothing
+ *       Does: Unites the labels of the runs of above's last row with
+ *             those of the runs of below's first row that overlap them
+ */
+static void join_strips(Strip *above, Strip *below, uint32_t *parent)
+{
+        int last = above->end_row - above->first_row - 1;
+        size_t a = above->row_start[last];
+        size_t a_end = above->row_start[last + 1];
+        size_t b = below->row_start[0];
+        size_t b_end = below->row_start[1];
+        while (a < a_end && b < b_end) {
+                if (above->lo[a] <= below->hi[b] &&
+                    below->lo[b] <= above->hi[a]) {
+                        Components_unite(parent,
+                                         above->offset + above->label[a],
+                                         below->offset + below->label[b]);
+                }
+                /* step past whichever run ends first */
+                if (above->hi[a] < below->hi[b]) {
+                        a++;
+                } else {
+                        b++;
+                }
+        }
+}
+
+/* static void grow_runs(Strip *strip, size_t need)
+ * Parameters: [Strip *strip] - strip being labeled
+ *             [size_t need] - number of runs the arrays must hold
+ *    Returns: Nothing
+ *       Does: Doubles the strip's run arrays until they hold need runs
+ */
+static void grow_runs(Strip *strip, size_t need)
+{
+        if (need <= strip->capacity) {
+                return;
+        }
+        while (strip->capacity < need) {
+                strip->capacity = (strip->capacity == 0) ?
+                                  1024 : strip->capacity * 2;
+        }
+        strip->lo = realloc(strip->lo, strip->capacity * sizeof(int));
+        strip->hi = realloc(strip->hi, strip->capacity * sizeof(int));
+        strip->label = realloc(strip->label,
+                               strip->capacity * sizeof(uint32_t));
+        if (strip->lo == NULL || strip->hi == NULL || strip->label == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+/* static void *checked_alloc(size_t nbytes)
+ * Returns: nbytes of fresh memory, exiting if malloc fails
+ */
+static void *checked_alloc(size_t nbytes)
+{
+        void *p = malloc(nbytes == 0 ? 1 : nbytes);
+        if (p == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        return p;
+}
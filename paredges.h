@@ -0,0 +1,17 @@
+/* paredges.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for the multithreaded black edge removal engine, functions 
+ * explained in implementation
+ */
+
+#include "bit2.h"
+
+#ifndef PAREDGES_INCLUDED
+#define PAREDGES_INCLUDED
+
+extern int paredges_default_threads(void);
+extern void remove_black_edges_parallel(Bit2_T img_map, int nthreads);
+
+#endif
@@ -0,0 +1,602 @@
+/*
+ * Filename: parsudoku.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Multithreaded version of sudoku's batch mode. The work is a
+ *          pipeline of three stages joined by two bounded queues:
+ *
+ *          1. reader threads each take the next file off the list, parse
+ *             its boards into 81 byte jobs and push them onto the board
+ *             queue
+ *          2. validator threads pop up to 32 jobs at a time, check them all
+ *             at once with one Boards_T kernel call, and push the verdicts
+ *             onto the result queue
+ *          3. the calling thread is the writer: it pops verdicts in
+ *             whatever order they finish, holds each until every earlier
+ *             board has been printed, and prints the same lines, in the
+ *             same order, as the serial batch mode
+ *
+ *          Both queues are the bounded multi-producer multi-consumer ring
+ *          of sequence-numbered slots described by Dmitry Vyukov: a push or
+ *          pop claims a slot with one compare-and-swap on its end of the
+ *          ring and never takes a lock. A thread that finds its queue full
+ *          (or empty) yields and tries again, so a slow writer holds the
+ *          readers back instead of letting jobs pile up.
+ *
+ *          The Boards_T kernels only know 9x9 boards. A board of another
+ *          n*n by n*n size is rare enough that its reader checks it with
+ *          check_board_mask itself and sends the verdict straight on.
+ *
+ *          Hanson exceptions keep one global handler stack, so readers
+ *          never use TRY; each reader sets rdr->trap to its own jmp_buf and
+ *          Pnmread longjmps there on a malformed file.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include "pnmread.h"
+#include "boards.h"
+#include "uarray2.h"
+#include "sudokucheck.h"
+#include "parsudoku.h"
+
+#define QUEUE_SIZE 4096 /* slots per queue, a power of two */
+#define CACHE_LINE 64
+
+/* What a job is or what became of it. CHECK jobs carry a board to check;
+   the rest are the lines the writer prints, plus END_OF_FILE, whose board
+   field is the number of lines its file produced */
+typedef enum Verdict {
+        CHECK, VALID, INVALID, ERR_OPEN, ERR_DIR, ERR_HEADER, ERR_TYPE,
+        ERR_SIZE, ERR_PIXELS, END_OF_FILE, PENDING
+} Verdict;
+
+/* the reason printed for each error verdict, as in serial batch mode */
+static const char *reasons[] = {
+        [ERR_OPEN] = "trouble reading file",
+        [ERR_DIR] = "trouble reading directory",
+        [ERR_HEADER] = "bad format, could not read image",
+        [ERR_TYPE] = "incorrect file type, requires pgm file",
+        [ERR_SIZE] = "incorrect dimensions or denominator",
+        [ERR_PIXELS] = "could not read pixels",
+};
+
+typedef struct Job {
+        int file;          /* index of the file in the list */
+        int board;         /* index of the board in the file, from 0 */
+        uint8_t verdict;   /* a Verdict */
+        uint8_t cells[81]; /* the board, row major, for CHECK jobs */
+} Job;
+
+typedef struct Slot {
+        size_t seq; /* which lap of the ring may use the slot next */
+        Job job;
+} Slot;
+
+/* bounded lock-free MPMC queue; head and tail sit on separate cache lines
+   so producers and consumers do not fight over one line */
+typedef struct Queue {
+        Slot *slots;
+        size_t mask;
+        char pad0[CACHE_LINE];
+        size_t head; /* next slot to push into */
+        char pad1[CACHE_LINE];
+        size_t tail; /* next slot to pop from */
+        char pad2[CACHE_LINE];
+} Queue;
+
+typedef struct Pool {
+        char **files;
+        int nfiles;
+        Queue boards;        /* readers to validators */
+        Queue results;       /* validators to writer */
+        int next_file;       /* next file for a reader to take */
+        int readers_left;    /* readers that have not finished yet */
+        Boards_kernel kernel;
+} Pool;
+
+/* one reader's place in the file it is reading */
+typedef struct Reader {
+        Pool *pool;
+        int file;
+        int board;   /* index of the next line this file produces */
+        int header;  /* 1 while reading a header, 0 while in a raster */
+        UArray2_T other; /* holds a board that is not 9x9, or NULL */
+} Reader;
+
+/* the writer's held back verdicts for one file */
+typedef struct File_lines {
+        uint8_t *verdicts; /* PENDING until the line arrives */
+        int length;
+        int capacity;
+        int total;         /* number of lines, or -1 until END_OF_FILE */
+} File_lines;
+
+static void *read_files(void *cl);
+static void read_file(Pool *pool, int file);
+static void read_boards(Reader *reader, Pnmread_T rdr);
+static int read_board(Reader *reader, Pnmread_T rdr);
+static void check_other_size(Reader *reader, Pnmread_T rdr);
+static void emit(Reader *reader, Verdict verdict);
+static void *validate_boards(void *cl);
+static int write_results(Pool *pool);
+static void hold_line(File_lines *lines, const Job *job);
+static void queue_init(Queue *queue, size_t size);
+static int queue_try_push(Queue *queue, const Job *job);
+static int queue_try_pop(Queue *queue, Job *job);
+static void queue_push(Queue *queue, const Job *job);
+static void *checked_alloc(size_t size);
+static pthread_t start_thread(void *(*work)(void *), void *cl);
+
+/* int parsudoku_default_threads(void)
+ * Returns: the number of online processors, or 1 if it cannot be found
+ */
+int parsudoku_default_threads(void)
+{
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return (n > 0) ? (int)n : 1;
+}
+
+/* int check_files_parallel(char **files, int nfiles, int nreaders,
+ *                          int nvalidators)
+ * Parameters: [char **files] - files of concatenated pgms; a NULL entry
+ *                              stands for stdin, printed as "-"
+ *             [int nfiles] - number of files
+ *             [int nreaders] - reader threads (at most one per file)
+ *             [int nvalidators] - validator threads
+ *    Returns: 1 if every board was valid, else 0
+ *       Does: Validates every board of every file and prints one line per
+ *             board to stdout, exactly as serial batch mode does
+ */
+int check_files_parallel(char **files, int nfiles, int nreaders,
+                         int nvalidators)
+{
+        assert(nreaders > 0 && nvalidators > 0);
+        if (nfiles == 0) {
+                return 1;
+        }
+        if (nreaders > nfiles) {
+                nreaders = nfiles;
+        }
+        Pool pool;
+        pool.files = files;
+        pool.nfiles = nfiles;
+        pool.next_file = 0;
+        pool.readers_left = nreaders;
+        pool.kernel = BOARDS_AVX2;
+        while (!Boards_supported(pool.kernel)) {
+                pool.kernel--;
+        }
+        queue_init(&pool.boards, QUEUE_SIZE);
+        queue_init(&pool.results, QUEUE_SIZE);
+
+        pthread_t *threads = checked_alloc((nreaders + nvalidators) *
+                                           sizeof(pthread_t));
+        for (int i = 0; i < nreaders; i++) {
+                threads[i] = start_thread(read_files, &pool);
+        }
+        for (int i = 0; i < nvalidators; i++) {
+                threads[nreaders + i] = start_thread(validate_boards, &pool);
+        }
+        int all_valid = write_results(&pool);
+        for (int i = 0; i < nreaders + nvalidators; i++) {
+                pthread_join(threads[i], NULL);
+        }
+        free(threads);
+        free(pool.boards.slots);
+        free(pool.results.slots);
+        return all_valid;
+}
+
+/* static void *read_files(void *cl)
+ * Does: Reader thread. Reads files off the shared list until there are
+ *       none left
+ */
+static void *read_files(void *cl)
+{
+        Pool *pool = cl;
+        for (;;) {
+                int file = __atomic_fetch_add(&pool->next_file, 1,
+                                              __ATOMIC_RELAXED);
+                if (file >= pool->nfiles) {
+                        break;
+                }
+                read_file(pool, file);
+        }
+        /* release, so a validator that sees zero also sees every push */
+        __atomic_fetch_sub(&pool->readers_left, 1, __ATOMIC_RELEASE);
+        return NULL;
+}
+
+/* static void read_file(Pool *pool, int file)
+ * Does: Pushes a job for every board of one file, then its END_OF_FILE.
+ *       A file that cannot be opened produces one error line, as in serial
+ *       batch mode
+ */
+static void read_file(Pool *pool, int file)
+{
+        Reader reader = { pool, file, 0, 1, NULL };
+        const char *path = pool->files[file];
+        FILE *fp = stdin;
+        struct stat st;
+        if (path != NULL && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+                emit(&reader, ERR_DIR);
+                fp = NULL;
+        } else if (path != NULL) {
+                fp = fopen(path, "rb");
+                if (fp == NULL) {
+                        emit(&reader, ERR_OPEN);
+                }
+        }
+        if (fp != NULL) {
+                Pnmread_T rdr = Pnmread_open(fp);
+                read_boards(&reader, rdr);
+                rdr->trap = NULL;
+                Pnmread_free(&rdr);
+                if (reader.other != NULL) {
+                        UArray2_free(&reader.other);
+                }
+                if (fp != stdin) {
+                        fclose(fp);
+                }
+        }
+        Job end;
+        end.file = file;
+        end.board = reader.board;
+        end.verdict = END_OF_FILE;
+        queue_push(&pool->boards, &end);
+}
+
+/* static void read_boards(Reader *reader, Pnmread_T rdr)
+ * Does: Reads every board in the stream. An error in a header or raster
+ *       longjmps back here and ends the stream with one error line, since
+ *       there is no way to find the next board after it
+ */
+static void read_boards(Reader *reader, Pnmread_T rdr)
+{
+        jmp_buf trap;
+        rdr->trap = &trap;
+        if (setjmp(trap) != 0) {
+                emit(reader, reader->header ? ERR_HEADER : ERR_PIXELS);
+                return;
+        }
+        if (!Pnmread_next(rdr)) {
+                /* an empty stream does not even hold one header */
+                emit(reader, ERR_HEADER);
+                return;
+        }
+        do {
+                reader->header = 0;
+                if (!read_board(reader, rdr)) {
+                        return;
+                }
+                reader->header = 1;
+        } while (Pnmread_next(rdr));
+}
+
+/* static int read_board(Reader *reader, Pnmread_T rdr)
+ * Returns: 0 if the stream cannot be read past this image, else 1
+ * Does: Pushes the board as a CHECK job, skipping a pgm of the wrong size
+ *       with an error line. A digit outside 1-9 is stored as 0, which the
+ *       validators never accept. A board of another sudoku size is checked
+ *       here and pushed already decided
+ */
+static int read_board(Reader *reader, Pnmread_T rdr)
+{
+        if (rdr->format != 2 && rdr->format != 5) {
+                emit(reader, ERR_TYPE);
+                return 0;
+        }
+        if (sudoku_box_size(rdr->width, rdr->height, rdr->maxval) == 0) {
+                size_t pixels = (size_t)rdr->width * rdr->height;
+                for (size_t i = 0; i < pixels; i++) {
+                        Pnmread_pixel(rdr);
+                }
+                emit(reader, ERR_SIZE);
+                return 1;
+        }
+        if (rdr->width != 9) {
+                check_other_size(reader, rdr);
+                return 1;
+        }
+        Job job;
+        for (int i = 0; i < 81; i++) {
+                unsigned val = Pnmread_pixel(rdr);
+                job.cells[i] = (val >= 1 && val <= 9) ? val : 0;
+        }
+        /* numbered only once it is read, since a truncated raster takes
+           this number for its error line instead */
+        job.file = reader->file;
+        job.board = reader->board++;
+        job.verdict = CHECK;
+        queue_push(&reader->pool->boards, &job);
+        return 1;
+}
+
+/* static void check_other_size(Reader *reader, Pnmread_T rdr)
+ * Does: Reads a board that is not 9x9 into the reader's own board, which
+ *       is kept for the next one of the same size, and emits its verdict
+ */
+static void check_other_size(Reader *reader, Pnmread_T rdr)
+{
+        int side = rdr->width;
+        if (reader->other == NULL || UArray2_width(reader->other) != side) {
+                /* UArray2_free leaves the pointer as it was */
+                if (reader->other != NULL) {
+                        UArray2_free(&reader->other);
+                }
+                reader->other = UArray2_new(side, side, sizeof(int));
+        }
+        for (int row = 0; row < side; row++) {
+                int *cells = UArray2_row(reader->other, row);
+                for (int col = 0; col < side; col++) {
+                        cells[col] = Pnmread_pixel(rdr);
+                }
+        }
+        emit(reader, check_board_mask(reader->other) ? VALID : INVALID);
+}
+
+/* static void emit(Reader *reader, Verdict verdict)
+ * Does: Pushes a job that is already decided, taking the next line number
+ */
+static void emit(Reader *reader, Verdict verdict)
+{
+        Job job;
+        job.file = reader->file;
+        job.board = reader->board++;
+        job.verdict = verdict;
+        queue_push(&reader->pool->boards, &job);
+}
+
+/* static void *validate_boards(void *cl)
+ * Does: Validator thread. Pops as many jobs as are waiting, up to one
+ *       batch, checks their boards in one kernel call, and passes every
+ *       job on to the writer. Stops once the readers are done and the
+ *       board queue is empty
+ */
+static void *validate_boards(void *cl)
+{
+        Pool *pool = cl;
+        Boards_T boards = Boards_new();
+        Job jobs[BOARDS_LANES];
+        for (;;) {
+                int n = 0;
+                while (n < BOARDS_LANES &&
+                       queue_try_pop(&pool->boards, &jobs[n])) {
+                        n++;
+                }
+                if (n == 0) {
+                        int done = __atomic_load_n(&pool->readers_left,
+                                                   __ATOMIC_ACQUIRE) == 0;
+                        /* the queue may have filled up before the load */
+                        if (done && !queue_try_pop(&pool->boards, jobs)) {
+                                break;
+                        } else if (!done) {
+                                sched_yield();
+                                continue;
+                        }
+                        n = 1;
+                }
+                Boards_clear(boards);
+                for (int i = 0; i < n; i++) {
+                        if (jobs[i].verdict == CHECK) {
+                                Boards_add_cells(boards, jobs[i].cells);
+                        }
+                }
+                uint32_t valid = Boards_check_kernel(boards, pool->kernel);
+                int lane = 0;
+                for (int i = 0; i < n; i++) {
+                        if (jobs[i].verdict == CHECK) {
+                                jobs[i].verdict = ((valid >> lane) & 1) ?
+                                                  VALID : INVALID;
+                                lane++;
+                        }
+                        queue_push(&pool->results, &jobs[i]);
+                }
+        }
+        Boards_free(&boards);
+        return NULL;
+}
+
+/* static int write_results(Pool *pool)
+ * Returns: 1 if every line was "valid", else 0
+ * Does: Writer. Pops verdicts as they come and prints each file's lines
+ *       in order, file after file, holding back any that arrive early
+ */
+static int write_results(Pool *pool)
+{
+        File_lines *files = checked_alloc(pool->nfiles * sizeof(File_lines));
+        for (int f = 0; f < pool->nfiles; f++) {
+                files[f].verdicts = NULL;
+                files[f].length = 0;
+                files[f].capacity = 0;
+                files[f].total = -1;
+        }
+        int all_valid = 1;
+        int file = 0; /* file being printed */
+        int line = 0; /* next line of it to print */
+        while (file < pool->nfiles) {
+                Job job;
+                if (!queue_try_pop(&pool->results, &job)) {
+                        sched_yield();
+                        continue;
+                }
+                hold_line(&files[job.file], &job);
+                while (file < pool->nfiles) {
+                        File_lines *lines = &files[file];
+                        const char *name = pool->files[file] ?
+                                           pool->files[file] : "-";
+                        if (line < lines->length &&
+                            lines->verdicts[line] != PENDING) {
+                                Verdict verdict = lines->verdicts[line++];
+                                if (verdict == VALID) {
+                                        printf("%s:%d valid\n", name, line);
+                                } else if (verdict == INVALID) {
+                                        printf("%s:%d invalid\n", name, line);
+                                } else {
+                                        printf("%s:%d error: %s\n", name,
+                                               line, reasons[verdict]);
+                                }
+                                all_valid &= (verdict == VALID);
+                        } else if (line == lines->total) {
+                                free(lines->verdicts);
+                                file++;
+                                line = 0;
+                        } else {
+                                break;
+                        }
+                }
+        }
+        free(files);
+        return all_valid;
+}
+
+/* static void hold_line(File_lines *lines, const Job *job)
+ * Does: Records a finished job in its file's lines, growing them as needed
+ */
+static void hold_line(File_lines *lines, const Job *job)
+{
+        if (job->verdict == END_OF_FILE) {
+                lines->total = job->board;
+                return;
+        }
+        if (job->board >= lines->capacity) {
+                int capacity = lines->capacity ? lines->capacity : 64;
+                while (capacity <= job->board) {
+                        capacity *= 2;
+                }
+                lines->verdicts = realloc(lines->verdicts, capacity);
+                if (lines->verdicts == NULL) {
+                        fprintf(stderr, "Error: memory allocation failed.\n");
+                        exit(EXIT_FAILURE);
+                }
+                lines->capacity = capacity;
+        }
+        while (lines->length <= job->board) {
+                lines->verdicts[lines->length++] = PENDING;
+        }
+        lines->verdicts[job->board] = job->verdict;
+}
+
+/* static void queue_init(Queue *queue, size_t size)
+ * Does: Sets up an empty queue of size slots, size a power of two. Slot i
+ *       starts with sequence number i, meaning free for the push at i
+ */
+static void queue_init(Queue *queue, size_t size)
+{
+        assert((size & (size - 1)) == 0);
+        queue->slots = checked_alloc(size * sizeof(Slot));
+        queue->mask = size - 1;
+        for (size_t i = 0; i < size; i++) {
+                queue->slots[i].seq = i;
+        }
+        queue->head = 0;
+        queue->tail = 0;
+}
+
+/* static int queue_try_push(Queue *queue, const Job *job)
+ * Returns: 1 if the job was pushed, 0 if the queue was full
+ * Does: Claims the head slot when its sequence number says it is free on
+ *       this lap, copies the job in, and then publishes it by moving the
+ *       sequence number one past the claimed position
+ */
+static int queue_try_push(Queue *queue, const Job *job)
+{
+        size_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        for (;;) {
+                Slot *slot = &queue->slots[pos & queue->mask];
+                size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                        if (__atomic_compare_exchange_n(&queue->head, &pos,
+                                        pos + 1, 1, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+                                slot->job = *job;
+                                __atomic_store_n(&slot->seq, pos + 1,
+                                                 __ATOMIC_RELEASE);
+                                return 1;
+                        }
+                } else if (diff < 0) {
+                        return 0;
+                } else {
+                        pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+                }
+        }
+}
+
+/* static int queue_try_pop(Queue *queue, Job *job)
+ * Returns: 1 if a job was popped into *job, 0 if the queue was empty
+ * Does: Claims the tail slot once its push is published, copies the job
+ *       out, and frees the slot for the push one lap later
+ */
+static int queue_try_pop(Queue *queue, Job *job)
+{
+        size_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        for (;;) {
+                Slot *slot = &queue->slots[pos & queue->mask];
+                size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0) {
+                        if (__atomic_compare_exchange_n(&queue->tail, &pos,
+                                        pos + 1, 1, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+                                *job = slot->job;
+                                __atomic_store_n(&slot->seq,
+                                                 pos + queue->mask + 1,
+                                                 __ATOMIC_RELEASE);
+                                return 1;
+                        }
+                } else if (diff < 0) {
+                        return 0;
+                } else {
+                        pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+                }
+        }
+}
+
+/* static void queue_push(Queue *queue, const Job *job)
+ * Does: Pushes the job, yielding the processor while the queue is full
+ */
+static void queue_push(Queue *queue, const Job *job)
+{
+        while (!queue_try_push(queue, job)) {
+                sched_yield();
+        }
+}
+
+/* static void *checked_alloc(size_t size)
+ * Returns: size bytes of memory, exiting with an error if there are none
+ */
+static void *checked_alloc(size_t size)
+{
+        void *p = malloc(size > 0 ? size : 1);
+        if (p == NULL) {
+                fprintf(stderr, "Error: memory allocation failed.\n");
+                exit(EXIT_FAILURE);
+        }
+        return p;
+}
+
+/* static pthread_t start_thread(void *(*work)(void *), void *cl)
+ * Returns: a new thread running work(cl), exiting with an error if it
+ *          cannot be created
+ */
+static pthread_t start_thread(void *(*work)(void *), void *cl)
+{
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, work, cl) != 0) {
+                fprintf(stderr, "Error: could not create thread\n");
+                exit(EXIT_FAILURE);
+        }
+        return thread;
+}
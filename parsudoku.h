@@ -0,0 +1,16 @@
+/* parsudoku.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for the multithreaded sudoku corpus validator, functions
+ * explained in implementation
+ */
+
+#ifndef PARSUDOKU_INCLUDED
+#define PARSUDOKU_INCLUDED
+
+extern int parsudoku_default_threads(void);
+extern int check_files_parallel(char **files, int nfiles, int nreaders,
+                                int nvalidators);
+
+#endif
@@ -0,0 +1,283 @@
+/*
+ * Filename: pbm.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the pbm.h interface. Rows are moved
+ *          between the input and a Bit2_T up to 64 pixels at a time with
+ *          Bit2_put_bits instead of one Bit2_put per pixel.
+ *
+ *          A raw (P4) row is packed 8 pixels per byte with the leftmost
+ *          pixel in the high bit, while Bit2_T keeps the leftmost pixel in
+ *          the low bit, so each 8 byte group is read little endian and the
+ *          bits of every byte are reversed in place. Writing a raw row 
+ *          does the same thing in the other direction.
+ *
+ *          Output is formatted into one large buffer that is handed to
+ *          fwrite whenever it fills, rather than one printf per pixel.
+ */
+
+#include <stdlib.h>
+#include "assert.h"
+#include "pbm.h"
+
+#define OUT_SIZE (1 << 20)
+
+/* plain pbm lines are cut after this many pixels (70 characters) */
+#define PLAIN_LINE 35
+
+/* output buffer flushed to fp whenever it fills */
+typedef struct Out_buf {
+        FILE *fp;
+        char *buf;
+        size_t len;
+        size_t capacity;
+} Out_buf;
+
+static void read_raw(Pnmread_T rdr, Bit2_T img_map, int count);
+static void read_plain(Pnmread_T rdr, Bit2_T img_map, int count);
+static void write_raw_row(Out_buf *out, Bit2_T img_map, int row);
+static void write_plain_row(Out_buf *out, Bit2_T img_map, int row);
+static void reserve(Out_buf *out, size_t n);
+static uint64_t reverse_byte_bits(uint64_t word);
+
+/* Bit2_T Pbm_read(Pnmread_T rdr)
+ * Parameters:
+ *             Pnmread_T rdr: reader whose header has been read, over a P1
+ *             or P4 image with nonzero width and height
+ * Returns: 
+ *             Bit2_T: a new bitmap holding the image, 1 for black
+ * Does: 
+ *             Reads the whole raster, raising Pnmread_Count if the input
+ *             ends early and Pnmread_Badformat on a bad plain pixel
+ */
+Bit2_T Pbm_read(Pnmread_T rdr)
+{
+        assert(rdr != NULL);
+        assert(rdr->format == 1 || rdr->format == 4);
+        Bit2_T img_map = Bit2_new(rdr->width, rdr->height);
+        assert(img_map != NULL);
+        Pbm_read_rows(rdr, img_map, img_map->height);
+        return img_map;
+}
+
+/* void Pbm_read_rows(Pnmread_T rdr, Bit2_T img_map, int count)
+ * Parameters:
+ *             Pnmread_T rdr: reader over a P1 or P4 image, positioned at
+ *             the start of a raster row
+ *             Bit2_T img_map: bitmap as wide as the image, with at least
+ *             count rows
+ *             int count: number of raster rows to read
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Reads the next count rows of the raster into rows 0 through
+ *             count - 1 of img_map, so a large image can be read a band at
+ *             a time. Raises the same exceptions as Pbm_read
+ */
+void Pbm_read_rows(Pnmread_T rdr, Bit2_T img_map, int count)
+{
+        assert(rdr != NULL && img_map != NULL);
+        assert(rdr->format == 1 || rdr->format == 4);
+        assert((unsigned)img_map->width == rdr->width);
+        assert(count >= 0 && count <= img_map->height);
+        if (rdr->format == 4) {
+                read_raw(rdr, img_map, count);
+        } else {
+                read_plain(rdr, img_map, count);
+        }
+}
+
+/* static void read_raw(Pnmread_T rdr, Bit2_T img_map, int count)
+ * Does: fills count rows of img_map from a P4 raster one packed row at a
+ *       time
+ */
+static void read_raw(Pnmread_T rdr, Bit2_T img_map, int count)
+{
+        int width = img_map->width;
+        size_t row_bytes = ((size_t)width + 7) / 8;
+
+        for (int j = 0; j < count; j++) {
+                /* the row is decoded where it sits in the reader's buffer */
+                const unsigned char *row = Pnmread_span(rdr, row_bytes);
+                for (int i = 0; i < width; i += 64) {
+                        const unsigned char *p = row + i / 8;
+                        int n = (width - i < 64) ? width - i : 64;
+                        int nbytes = (n + 7) / 8;
+                        uint64_t word = 0;
+                        for (int k = 0; k < nbytes; k++) {
+                                word |= (uint64_t)p[k] << (8 * k);
+                        }
+                        Bit2_put_bits(img_map, i, j, reverse_byte_bits(word),
+                                      n);
+                }
+        }
+}
+
+/* static void read_plain(Pnmread_T rdr, Bit2_T img_map, int count)
+ * Does: fills count rows of img_map from a P1 raster, 64 digits per
+ *       Pnmread call
+ */
+static void read_plain(Pnmread_T rdr, Bit2_T img_map, int count)
+{
+        int width = img_map->width;
+        for (int j = 0; j < count; j++) {
+                for (int i = 0; i < width; i += 64) {
+                        int n = (width - i < 64) ? width - i : 64;
+                        Bit2_put_bits(img_map, i, j, 
+                                      Pnmread_plain_bits(rdr, n), n);
+                }
+        }
+}
+
+/* void Pbm_write(FILE *fp, Bit2_T img_map, int raw, const char *comment)
+ * Parameters:
+ *             FILE *fp: stream the image is written to
+ *             Bit2_T img_map: the bitmap to write, 1 for black
+ *             int raw: 1 to write a raw (P4) pbm, 0 for a plain (P1) pbm
+ *             const char *comment: text of the header comment line, or NULL
+ *             for no comment
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Writes img_map as a pbm. Plain output puts a space between
+ *             pixels and a newline after every 35 pixels and at the end of
+ *             every row
+ */
+void Pbm_write(FILE *fp, Bit2_T img_map, int raw, const char *comment)
+{
+        assert(fp != NULL && img_map != NULL);
+        Pbm_write_header(fp, img_map->width, img_map->height, raw, comment);
+        Pbm_write_rows(fp, img_map, img_map->height, raw);
+}
+
+/* void Pbm_write_header(FILE *fp, int width, int height, int raw,
+ *                       const char *comment)
+ * Parameters:
+ *             FILE *fp: stream the header is written to
+ *             int width, int height: size of the image that will follow
+ *             int raw: 1 for a raw (P4) pbm, 0 for a plain (P1) pbm
+ *             const char *comment: text of the header comment line, or NULL
+ *             for no comment
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Writes the header Pbm_write starts with, for an image whose
+ *             rows are then written a band at a time with Pbm_write_rows
+ */
+void Pbm_write_header(FILE *fp, int width, int height, int raw,
+                      const char *comment)
+{
+        assert(fp != NULL);
+        fprintf(fp, "P%c\n", raw ? '4' : '1');
+        if (comment != NULL) {
+                fprintf(fp, "# %s\n", comment);
+        }
+        fprintf(fp, "%d %d\n", width, height);
+}
+
+/* void Pbm_write_rows(FILE *fp, Bit2_T img_map, int count, int raw)
+ * Parameters:
+ *             FILE *fp: stream the rows are written to
+ *             Bit2_T img_map: bitmap holding the rows, 1 for black
+ *             int count: number of rows to write, starting from row 0
+ *             int raw: 1 for raw (P4) rows, 0 for plain (P1) rows
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Writes rows 0 through count - 1 of img_map in the raster
+ *             format of Pbm_write, with no header
+ */
+void Pbm_write_rows(FILE *fp, Bit2_T img_map, int count, int raw)
+{
+        assert(fp != NULL && img_map != NULL);
+        assert(count >= 0 && count <= img_map->height);
+        Out_buf out = { fp, malloc(OUT_SIZE), 0, OUT_SIZE };
+        assert(out.buf != NULL);
+        for (int j = 0; j < count; j++) {
+                if (raw) {
+                        write_raw_row(&out, img_map, j);
+                } else {
+                        write_plain_row(&out, img_map, j);
+                }
+        }
+        fwrite(out.buf, 1, out.len, fp);
+        free(out.buf);
+}
+
+/* static void write_raw_row(Out_buf *out, Bit2_T img_map, int row)
+ * Does: appends one packed P4 row, 8 bytes per Bit2_get_bits call
+ */
+static void write_raw_row(Out_buf *out, Bit2_T img_map, int row)
+{
+        int width = img_map->width;
+        for (int i = 0; i < width; i += 64) {
+                int n = (width - i < 64) ? width - i : 64;
+                uint64_t word = reverse_byte_bits(
+                                Bit2_get_bits(img_map, i, row, n));
+                int nbytes = (n + 7) / 8;
+                reserve(out, nbytes);
+                for (int k = 0; k < nbytes; k++) {
+                        out->buf[out->len++] = (char)(word >> (8 * k));
+                }
+        }
+}
+
+/* static void write_plain_row(Out_buf *out, Bit2_T img_map, int row)
+ * Does: appends one P1 row, two characters per pixel
+ */
+static void write_plain_row(Out_buf *out, Bit2_T img_map, int row)
+{
+        int width = img_map->width;
+        int linelen = 0;
+        reserve(out, 2 * (size_t)width);
+        char *p = out->buf + out->len;
+        for (int i = 0; i < width; i += 64) {
+                int n = (width - i < 64) ? width - i : 64;
+                uint64_t bits = Bit2_get_bits(img_map, i, row, n);
+                for (int k = 0; k < n; k++) {
+                        *p++ = (char)('0' + ((bits >> k) & 1));
+                        linelen++;
+                        if (i + k + 1 == width || linelen == PLAIN_LINE) {
+                                *p++ = '\n';
+                                linelen = 0;
+                        } else {
+                                *p++ = ' ';
+                        }
+                }
+        }
+        out->len = p - out->buf;
+}
+
+/* static void reserve(Out_buf *out, size_t n)
+ * Does: makes room for n more bytes, flushing the buffer to its stream 
+ *       first if they do not fit, and growing it for a row longer than 
+ *       the whole buffer
+ */
+static void reserve(Out_buf *out, size_t n)
+{
+        if (out->len + n <= out->capacity) {
+                return;
+        }
+        fwrite(out->buf, 1, out->len, out->fp);
+        out->len = 0;
+        if (n > out->capacity) {
+                out->capacity = n;
+                out->buf = realloc(out->buf, n);
+                assert(out->buf != NULL);
+        }
+}
+
+/* static uint64_t reverse_byte_bits(uint64_t word)
+ * Returns: word with the bit order of each of its 8 bytes reversed, leaving
+ *          the bytes themselves where they are
+ */
+static uint64_t reverse_byte_bits(uint64_t word)
+{
+        word = ((word >> 1) & 0x5555555555555555ULL) |
+               ((word & 0x5555555555555555ULL) << 1);
+        word = ((word >> 2) & 0x3333333333333333ULL) |
+               ((word & 0x3333333333333333ULL) << 2);
+        word = ((word >> 4) & 0x0F0F0F0F0F0F0F0FULL) |
+               ((word & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        return word;
+}
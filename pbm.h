@@ -0,0 +1,24 @@
+/* pbm.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for pbm, which converts between pbm rasters and Bit2_T
+ * bitmaps, functions explained in implementation
+ */
+
+#include <stdio.h>
+#include "bit2.h"
+#include "pnmread.h"
+
+#ifndef PBM_INCLUDED
+#define PBM_INCLUDED
+
+extern Bit2_T Pbm_read(Pnmread_T rdr);
+extern void Pbm_read_rows(Pnmread_T rdr, Bit2_T img_map, int count);
+extern void Pbm_write(FILE *fp, Bit2_T img_map, int raw, 
+                      const char *comment);
+extern void Pbm_write_header(FILE *fp, int width, int height, int raw,
+                             const char *comment);
+extern void Pbm_write_rows(FILE *fp, Bit2_T img_map, int count, int raw);
+
+#endif
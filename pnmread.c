@@ -0,0 +1,477 @@
+/*
+ * Filename: pnmread.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the pnmread.h interface, a
+ *          replacement for Pnmrdr on large images. Pnmrdr_get costs one
+ *          function call and one stdio call per pixel; pnmread instead reads
+ *          the input in large blocks and decodes raw rows or runs of plain
+ *          digits straight out of its own buffer. Errors are reported the
+ *          same way Pnmrdr reports them, by raising Pnmread_Badformat for a
+ *          malformed file and Pnmread_Count when the pixels run out early.
+ *
+ *          When the stream is a regular file, the whole file is mmapped and
+ *          the buffer is the mapping itself, so the input is parsed in place
+ *          with no copy through stdio and the kernel is told to read ahead.
+ *          Pipes and terminals fall back to filling a malloced buffer with
+ *          fread.
+ *
+ *          Hanson exceptions keep one global stack of handlers, so TRY can
+ *          only be used from one thread. A reader used off the main thread
+ *          can set rdr->trap to a jmp_buf of its own; its errors then 
+ *          longjmp there with rdr->error set, instead of being raised.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "assert.h"
+#include "pnmread.h"
+
+#define BUF_SIZE (1 << 20)
+
+const Except_T Pnmread_Badformat = { "Badly formatted pnm file" };
+const Except_T Pnmread_Count = { "Pnm file ended before its last pixel" };
+
+static Pnmread_T new_mapped(FILE *fp);
+static Pnmread_T new_stream(FILE *fp);
+static Pnmread_T read_header(Pnmread_T rdr);
+static int parse_header(Pnmread_T rdr);
+static int refill(Pnmread_T rdr);
+static int next_char(Pnmread_T rdr);
+static int skip_space(Pnmread_T rdr);
+static void fail(Pnmread_T rdr, const Except_T *error);
+
+/* Pnmread_T Pnmread_new(FILE *fp)
+ * Parameters:
+ *             FILE *fp: opened stream positioned at the start of a pnm image
+ * Returns: 
+ *             Pnmread_T: a reader positioned at the first pixel, with format,
+ *             width, height and maxval filled in from the header
+ * Does: 
+ *             Maps the file if fp is a regular file, otherwise sets up a
+ *             streaming buffer, then parses the header, raising 
+ *             Pnmread_Badformat if it is not a pnm header
+ */
+Pnmread_T Pnmread_new(FILE *fp)
+{
+        assert(fp != NULL);
+        Pnmread_T rdr = new_mapped(fp);
+        if (rdr == NULL) {
+                return Pnmread_new_stream(fp);
+        }
+        return read_header(rdr);
+}
+
+/* Pnmread_T Pnmread_open(FILE *fp)
+ * Parameters:
+ *             FILE *fp: opened stream of zero or more concatenated pnms
+ * Returns: 
+ *             Pnmread_T: a reader positioned before the first header
+ * Does: 
+ *             Sets up the reader like Pnmread_new but reads nothing, so it
+ *             cannot fail; Pnmread_next then reads each header in turn
+ *             (returning 0 straight away for an empty stream). This lets a
+ *             caller set rdr->trap before the first header is parsed
+ */
+Pnmread_T Pnmread_open(FILE *fp)
+{
+        assert(fp != NULL);
+        Pnmread_T rdr = new_mapped(fp);
+        if (rdr == NULL) {
+                rdr = new_stream(fp);
+        }
+        rdr->format = 0;
+        rdr->width = 0;
+        rdr->height = 0;
+        rdr->maxval = 0;
+        return rdr;
+}
+
+/* Pnmread_T Pnmread_new_stream(FILE *fp)
+ * Parameters:
+ *             FILE *fp: opened stream positioned at the start of a pnm image
+ * Returns: 
+ *             Pnmread_T: a reader positioned at the first pixel
+ * Does: 
+ *             Same as Pnmread_new, but always reads through fread, even for
+ *             a regular file
+ */
+Pnmread_T Pnmread_new_stream(FILE *fp)
+{
+        assert(fp != NULL);
+        return read_header(new_stream(fp));
+}
+
+/* static Pnmread_T new_stream(FILE *fp)
+ * Returns: a reader that fills a malloced buffer from fp with fread
+ */
+static Pnmread_T new_stream(FILE *fp)
+{
+        Pnmread_T rdr = malloc(sizeof(*rdr));
+        assert(rdr != NULL);
+        rdr->buf = malloc(BUF_SIZE);
+        assert(rdr->buf != NULL);
+        rdr->fp = fp;
+        rdr->pos = 0;
+        rdr->len = 0;
+        rdr->capacity = BUF_SIZE;
+        rdr->mapped = 0;
+        rdr->trap = NULL;
+        rdr->error = NULL;
+        return rdr;
+}
+
+/* static Pnmread_T new_mapped(FILE *fp)
+ * Returns: a reader over a read-only mapping of fp's file, starting at fp's
+ *          current position, or NULL if fp is not a regular file that can
+ *          be mapped
+ */
+static Pnmread_T new_mapped(FILE *fp)
+{
+        struct stat st;
+        long start = ftell(fp);
+        if (start < 0 || fstat(fileno(fp), &st) != 0 || 
+            !S_ISREG(st.st_mode) || st.st_size <= start) {
+                return NULL;
+        }
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, 
+                         fileno(fp), 0);
+        if (map == MAP_FAILED) {
+                return NULL;
+        }
+        /* the file is read front to back exactly once */
+        posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+        posix_madvise(map, st.st_size, POSIX_MADV_WILLNEED);
+
+        Pnmread_T rdr = malloc(sizeof(*rdr));
+        assert(rdr != NULL);
+        rdr->buf = map;
+        rdr->fp = fp;
+        rdr->pos = start;
+        rdr->len = st.st_size;
+        rdr->capacity = st.st_size;
+        rdr->mapped = 1;
+        rdr->trap = NULL;
+        rdr->error = NULL;
+        return rdr;
+}
+
+/* static Pnmread_T read_header(Pnmread_T rdr)
+ * Returns: rdr, after filling in format, width, height and maxval from the
+ *          header at the current position
+ */
+static Pnmread_T read_header(Pnmread_T rdr)
+{
+        if (!parse_header(rdr)) {
+                Pnmread_free(&rdr);
+                RAISE(Pnmread_Badformat);
+        }
+        return rdr;
+}
+
+/* static int parse_header(Pnmread_T rdr)
+ * Returns: 1 after filling in format, width, height and maxval from the
+ *          header at the current position, 0 if the magic number is not
+ *          that of a pnm
+ */
+static int parse_header(Pnmread_T rdr)
+{
+        if (next_char(rdr) != 'P') {
+                return 0;
+        }
+        rdr->format = next_char(rdr) - '0';
+        if (rdr->format < 1 || rdr->format > 6) {
+                return 0;
+        }
+        rdr->width = Pnmread_number(rdr);
+        rdr->height = Pnmread_number(rdr);
+        if (rdr->format == 1 || rdr->format == 4) {
+                rdr->maxval = 1;
+        } else {
+                rdr->maxval = Pnmread_number(rdr);
+        }
+        /* Pnmread_number already ate the single whitespace that ends the
+           header, so a raw raster starts at rdr->pos */
+        return 1;
+}
+
+/* int Pnmread_next(Pnmread_T rdr)
+ * Parameters:
+ *             Pnmread_T rdr: a reader that has consumed a whole raster
+ * Returns: 
+ *             int: 1 if another image follows, 0 at the end of input
+ * Does: 
+ *             Reads the header of the next image of a stream of concatenated
+ *             pnms, reusing the reader and its buffer (or mapping). Raises
+ *             Pnmread_Badformat if what follows is not a pnm header, and
+ *             Pnmread_Count if it ends inside the header
+ */
+int Pnmread_next(Pnmread_T rdr)
+{
+        if (skip_space(rdr) == EOF) {
+                return 0;
+        }
+        /* the byte skip_space stopped on is still in the buffer */
+        rdr->pos--;
+        if (!parse_header(rdr)) {
+                fail(rdr, &Pnmread_Badformat);
+        }
+        return 1;
+}
+
+/* void Pnmread_free(Pnmread_T *rdr)
+ * Parameters: 
+ *            Pnmread_T *rdr - pointer to the reader to be freed
+ * Returns:
+ *            Nothing
+ * Does:
+ *            frees memory and unmaps the file, the stream itself is left 
+ *            open for the caller
+ */
+void Pnmread_free(Pnmread_T *rdr)
+{
+        assert(rdr != NULL && *rdr != NULL);
+        if ((*rdr)->mapped) {
+                munmap((*rdr)->buf, (*rdr)->len);
+        } else {
+                free((*rdr)->buf);
+        }
+        free(*rdr);
+        *rdr = NULL;
+}
+
+/* unsigned Pnmread_number(Pnmread_T rdr)
+ * Parameters:
+ *             Pnmread_T rdr: the reader
+ * Returns: 
+ *             unsigned: the next ascii decimal number in the input, at
+ *             most INT_MAX
+ * Does: 
+ *             Skips whitespace and comments, then reads digits up to and
+ *             including the character that ends the number. Raises
+ *             Pnmread_Badformat once the number passes INT_MAX, since
+ *             every caller keeps widths and heights in an int
+ */
+unsigned Pnmread_number(Pnmread_T rdr)
+{
+        int c = skip_space(rdr);
+        if (c == EOF) {
+                fail(rdr, &Pnmread_Count);
+        }
+        if (c < '0' || c > '9') {
+                fail(rdr, &Pnmread_Badformat);
+        }
+        unsigned value = 0;
+        while (c >= '0' && c <= '9') {
+                if (value > ((unsigned)INT_MAX - (c - '0')) / 10) {
+                        fail(rdr, &Pnmread_Badformat);
+                }
+                value = value * 10 + (c - '0');
+                c = next_char(rdr);
+        }
+        return value;
+}
+
+/* unsigned Pnmread_pixel(Pnmread_T rdr)
+ * Parameters:
+ *             Pnmread_T rdr: a reader over a pgm raster, plain or raw
+ * Returns: 
+ *             unsigned: the next pixel value
+ * Does: 
+ *             Reads one ascii number from a plain (P2) raster, or one byte 
+ *             (two big endian bytes when maxval > 255) from a raw (P5) one
+ */
+unsigned Pnmread_pixel(Pnmread_T rdr)
+{
+        if (rdr->format != 5) {
+                return Pnmread_number(rdr);
+        }
+        int c = next_char(rdr);
+        if (c == EOF) {
+                fail(rdr, &Pnmread_Count);
+        }
+        if (rdr->maxval < 256) {
+                return c;
+        }
+        int low = next_char(rdr);
+        if (low == EOF) {
+                fail(rdr, &Pnmread_Count);
+        }
+        return ((unsigned)c << 8) | low;
+}
+
+/* uint64_t Pnmread_plain_bits(Pnmread_T rdr, int n)
+ * Parameters:
+ *             Pnmread_T rdr: a reader over a plain (P1) pbm raster
+ *             int n: number of pixels to read, 1 to 64
+ * Returns: 
+ *             uint64_t: the next n pixels, the first one in bit 0
+ * Does: 
+ *             Reads n '0'/'1' digits, skipping any whitespace between them,
+ *             in one tight loop over the buffer
+ */
+uint64_t Pnmread_plain_bits(Pnmread_T rdr, int n)
+{
+        assert(n > 0 && n <= 64);
+        uint64_t bits = 0;
+        int i = 0;
+        while (i < n) {
+                if (rdr->pos == rdr->len && !refill(rdr)) {
+                        fail(rdr, &Pnmread_Count);
+                }
+                /* digits in the buffer are consumed without a call each */
+                while (i < n && rdr->pos < rdr->len) {
+                        int c = rdr->buf[rdr->pos++];
+                        if (c == '0' || c == '1') {
+                                bits |= (uint64_t)(c - '0') << i;
+                                i++;
+                        } else if (c == '#') {
+                                /* let skip_space eat the comment, then put
+                                   back the byte it stopped on */
+                                rdr->pos--;
+                                if (skip_space(rdr) == EOF) {
+                                        fail(rdr, &Pnmread_Count);
+                                }
+                                rdr->pos--;
+                        } else if (c != ' ' && c != '\n' && c != '\t' &&
+                                   c != '\r' && c != '\v' && c != '\f') {
+                                fail(rdr, &Pnmread_Badformat);
+                        }
+                }
+        }
+        return bits;
+}
+
+/* void Pnmread_bytes(Pnmread_T rdr, void *dst, size_t n)
+ * Parameters:
+ *             Pnmread_T rdr: a reader over a raw raster
+ *             void *dst: where the bytes are copied to
+ *             size_t n: number of bytes to copy
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Copies the next n raster bytes out of the buffer, refilling it
+ *             as needed, and raises Pnmread_Count if the input runs out
+ */
+void Pnmread_bytes(Pnmread_T rdr, void *dst, size_t n)
+{
+        unsigned char *out = dst;
+        while (n > 0) {
+                if (rdr->pos == rdr->len && !refill(rdr)) {
+                        fail(rdr, &Pnmread_Count);
+                }
+                size_t chunk = rdr->len - rdr->pos;
+                if (chunk > n) {
+                        chunk = n;
+                }
+                memcpy(out, rdr->buf + rdr->pos, chunk);
+                rdr->pos += chunk;
+                out += chunk;
+                n -= chunk;
+        }
+}
+
+/* const unsigned char *Pnmread_span(Pnmread_T rdr, size_t n)
+ * Parameters:
+ *             Pnmread_T rdr: a reader over a raw raster
+ *             size_t n: number of bytes wanted
+ * Returns: 
+ *             const unsigned char *: pointer to the next n raster bytes,
+ *             valid until the next call on rdr
+ * Does: 
+ *             Consumes n bytes without copying them out. A mapped file is
+ *             already contiguous; a streaming buffer slides its unread tail
+ *             to the front and reads more (growing if n is larger than the
+ *             buffer). Raises Pnmread_Count if the input runs out
+ */
+const unsigned char *Pnmread_span(Pnmread_T rdr, size_t n)
+{
+        if (rdr->len - rdr->pos < n && !rdr->mapped) {
+                size_t have = rdr->len - rdr->pos;
+                memmove(rdr->buf, rdr->buf + rdr->pos, have);
+                if (n > rdr->capacity) {
+                        rdr->capacity = n;
+                        rdr->buf = realloc(rdr->buf, n);
+                        assert(rdr->buf != NULL);
+                }
+                rdr->pos = 0;
+                rdr->len = have;
+                while (rdr->len < n) {
+                        size_t got = fread(rdr->buf + rdr->len, 1, 
+                                           rdr->capacity - rdr->len, rdr->fp);
+                        if (got == 0) {
+                                break;
+                        }
+                        rdr->len += got;
+                }
+        }
+        if (rdr->len - rdr->pos < n) {
+                fail(rdr, &Pnmread_Count);
+        }
+        const unsigned char *span = rdr->buf + rdr->pos;
+        rdr->pos += n;
+        return span;
+}
+
+/* static int refill(Pnmread_T rdr)
+ * Returns: 1 if more input was read into the buffer, 0 at end of input 
+ *          (always 0 for a mapped file, which is all in the buffer already)
+ */
+static int refill(Pnmread_T rdr)
+{
+        if (rdr->mapped) {
+                return 0;
+        }
+        rdr->pos = 0;
+        rdr->len = fread(rdr->buf, 1, rdr->capacity, rdr->fp);
+        return rdr->len > 0;
+}
+
+/* static int next_char(Pnmread_T rdr)
+ * Returns: the next input byte, or EOF at the end of input
+ */
+static int next_char(Pnmread_T rdr)
+{
+        if (rdr->pos == rdr->len && !refill(rdr)) {
+                return EOF;
+        }
+        return rdr->buf[rdr->pos++];
+}
+
+/* static int skip_space(Pnmread_T rdr)
+ * Returns: the first byte that is neither whitespace nor part of a '#'
+ *          comment, which is consumed, or EOF
+ */
+static int skip_space(Pnmread_T rdr)
+{
+        for (;;) {
+                int c = next_char(rdr);
+                if (c == '#') {
+                        while (c != '\n' && c != EOF) {
+                                c = next_char(rdr);
+                        }
+                } else if (c != ' ' && c != '\n' && c != '\t' && 
+                           c != '\r' && c != '\v' && c != '\f') {
+                        return c;
+                }
+        }
+}
+
+/* static void fail(Pnmread_T rdr, const Except_T *error)
+ * Does: Reports an error in the input, by a longjmp to rdr->trap with
+ *       rdr->error set if the reader has a trap, else by raising it
+ */
+static void fail(Pnmread_T rdr, const Except_T *error)
+{
+        if (rdr->trap != NULL) {
+                rdr->error = error;
+                longjmp(*rdr->trap, 1);
+        }
+        RAISE(*error);
+}
@@ -0,0 +1,50 @@
+/* pnmread.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for pnmread, a buffered pnm reader that hands out whole
+ * blocks of pixels instead of one pixel per call, functions explained in
+ * implementation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <except.h>
+
+#ifndef PNMREAD_INCLUDED
+#define PNMREAD_INCLUDED
+
+#define T Pnmread_T
+typedef struct T{
+  int format; /* digit after the magic 'P': 1/4 pbm, 2/5 pgm, 3/6 ppm */
+  unsigned width; /* width of the image in pixels */
+  unsigned height; /* height of the image in pixels */
+  unsigned maxval; /* largest pixel value, 1 for pbm */
+  FILE *fp; /* stream the buffer is refilled from */
+  unsigned char *buf; /* input buffer, or the whole mapped file */
+  size_t pos; /* index of the next unread byte in buf */
+  size_t len; /* number of valid bytes in buf */
+  size_t capacity; /* allocated size of buf */
+  int mapped; /* 1 if buf is an mmap of the file rather than a buffer */
+  jmp_buf *trap; /* if not NULL, errors longjmp here instead of raising */
+  const Except_T *error; /* the error that last longjmped to trap */
+} *T;
+
+extern const Except_T Pnmread_Badformat;
+extern const Except_T Pnmread_Count;
+
+extern T Pnmread_new(FILE *fp);
+extern T Pnmread_new_stream(FILE *fp);
+extern T Pnmread_open(FILE *fp);
+extern void Pnmread_free(T *rdr);
+extern int Pnmread_next(T rdr);
+extern unsigned Pnmread_number(T rdr);
+extern unsigned Pnmread_pixel(T rdr);
+extern uint64_t Pnmread_plain_bits(T rdr, int n);
+extern void Pnmread_bytes(T rdr, void *dst, size_t n);
+extern const unsigned char *Pnmread_span(T rdr, size_t n);
+
+#undef T
+#endif
@@ -0,0 +1,269 @@
+/*
+ * Filename: streamedges.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Black edge removal for pbms too large to hold in memory. The
+ *          input is read twice, a band of BAND_ROWS rows at a time, and
+ *          only the current band, the black runs of one row and a table of
+ *          labels are kept, so memory is O(width) plus the label table
+ *          rather than O(width * height).
+ *
+ *          The first pass labels runs of black pixels with the labeler's
+ *          own steps from components.c (Components_row_runs and
+ *          Components_match_runs): a run takes the label of the first run
+ *          it touches in the row above and is united with the others it
+ *          touches; a run that touches none starts the next new label. Only
+ *          components' first runs get labels, so the forest is far smaller
+ *          than the number of runs. The root of every run on the border is
+ *          flagged, and when the pass ends the flags are gathered at the
+ *          roots, every label's flag is replaced by its root's, and the
+ *          flags are packed down to one bit each. The second pass hands out
+ *          labels by the same rule over
+ *          the same runs without a table: a new label goes to the same runs
+ *          in the same order, and an inherited one always belongs to the
+ *          run's component, which is all its bit depends on. So the first
+ *          pass is free to keep each run's root rather than its label, and
+ *          the second turns a run white when its label's bit is set before
+ *          the band is written out.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "assert.h"
+#include "bit2.h"
+#include "components.h"
+#include "pnmread.h"
+#include "pbm.h"
+#include "streamedges.h"
+
+#define BAND_ROWS 64
+
+const Except_T Streamedges_Seek = { "Input cannot be read a second time" };
+
+/* Union-find forest over component labels, with a border flag per label
+   that is only gathered at the roots once the first pass ends */
+typedef struct Label_table {
+        Label_forest forest;
+        unsigned char *border;
+        uint32_t border_capacity;
+} Label_table;
+
+static Pnmread_T open_pbm(FILE *in);
+static uint64_t *label_runs(Pnmread_T rdr, Bit2_T band);
+static void clear_runs(Pnmread_T rdr, Bit2_T band, const uint64_t *border,
+                       FILE *out, int raw);
+static void new_rows(Run_list rows[2], int width);
+static void free_rows(Run_list rows[2]);
+static void grow_border(Label_table *table);
+
+/* void remove_black_edges_stream(FILE *in, FILE *out, int raw)
+ * Parameters:
+ *             FILE *in: seekable stream positioned at the start of a P1 or
+ *             P4 pbm with nonzero width and height
+ *             FILE *out: stream the result is written to
+ *             int raw: 1 to write a raw (P4) pbm, 0 for a plain (P1) pbm
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Writes the pbm read from in to out with every black edge
+ *             turned white, the same image the in memory engines produce.
+ *             Raises Streamedges_Seek if in cannot be rewound for the
+ *             second pass, Pnmread_Badformat if it is not a pbm of nonzero
+ *             size or a plain pixel is bad, and Pnmread_Count if it ends
+ *             early
+ */
+void remove_black_edges_stream(FILE *in, FILE *out, int raw)
+{
+        assert(in != NULL && out != NULL);
+        long start = ftell(in);
+        if (start < 0) {
+                RAISE(Streamedges_Seek);
+        }
+        Pnmread_T rdr = open_pbm(in);
+        int width = rdr->width;
+        int height = rdr->height;
+        Bit2_T band = Bit2_new(width, height < BAND_ROWS ? height 
+                                                          : BAND_ROWS);
+        uint64_t *border = label_runs(rdr, band);
+        Pnmread_free(&rdr);
+
+        if (fseek(in, start, SEEK_SET) != 0) {
+                Bit2_free(&band);
+                free(border);
+                RAISE(Streamedges_Seek);
+        }
+        rdr = open_pbm(in);
+        Pbm_write_header(out, width, height, raw, "Black Edges Removed");
+        clear_runs(rdr, band, border, out, raw);
+        Pnmread_free(&rdr);
+        Bit2_free(&band);
+        free(border);
+}
+
+/* static Pnmread_T open_pbm(FILE *in)
+ * Returns: a reader over in positioned at the first pixel, raising
+ *          Pnmread_Badformat if the image is not a pbm of nonzero size. It
+ *          always reads through a fixed size buffer, never a mapping of
+ *          the whole file
+ */
+static Pnmread_T open_pbm(FILE *in)
+{
+        Pnmread_T rdr = Pnmread_new_stream(in);
+        if (rdr->width == 0 || rdr->height == 0 || 
+            (rdr->format != 1 && rdr->format != 4)) {
+                Pnmread_free(&rdr);
+                RAISE(Pnmread_Badformat);
+        }
+        return rdr;
+}
+
+/* static uint64_t *label_runs(Pnmread_T rdr, Bit2_T band)
+ * Does: the first pass. Labels the black runs of the image, unites the
+ *       runs that touch across neighboring rows, and flags the roots of
+ *       runs on the border
+ * Returns: a bit per label, set if the label's component touches the
+ *          border
+ */
+static uint64_t *label_runs(Pnmread_T rdr, Bit2_T band)
+{
+        int width = rdr->width;
+        int height = rdr->height;
+        Label_table table = { { NULL, 0, 0 }, NULL, 0 };
+        Run_list rows[2];
+        new_rows(rows, width);
+        Run_list *above = &rows[0];
+        Run_list *cur = &rows[1];
+
+        for (int first = 0; first < height; first += band->height) {
+                int count = (height - first < band->height) ? 
+                            height - first : band->height;
+                Pbm_read_rows(rdr, band, count);
+                for (int j = 0; j < count; j++) {
+                        int row = first + j;
+                        Components_row_runs(band, j, cur);
+                        Components_match_runs(above, cur, 4, &table.forest);
+                        grow_border(&table);
+                        for (int k = 0; k < cur->length; k++) {
+                                /* the next row then unites from roots */
+                                cur->label[k] = Components_find(
+                                        table.forest.parent, cur->label[k]);
+                                if (row == 0 || row == height - 1 || 
+                                    cur->lo[k] == 0 || 
+                                    cur->hi[k] == width - 1) {
+                                        table.border[cur->label[k]] = 1;
+                                }
+                        }
+                        Run_list *done = above;
+                        above = cur;
+                        cur = done;
+                }
+        }
+        free_rows(rows);
+
+        /* parent[i] <= i, so a backward pass carries every flag up to its
+           root and a forward pass gives each label its root's flag */
+        uint32_t length = table.forest.length;
+        uint32_t *parent = table.forest.parent;
+        for (uint32_t i = length; i-- > 0; ) {
+                table.border[parent[i]] |= table.border[i];
+        }
+        uint64_t *border = calloc(length / 64 + 1, sizeof(uint64_t));
+        assert(border != NULL);
+        for (uint32_t i = 0; i < length; i++) {
+                table.border[i] = table.border[parent[i]];
+                border[i / 64] |= (uint64_t)table.border[i] << (i % 64);
+        }
+        free(table.forest.parent);
+        free(table.border);
+        return border;
+}
+
+/* static void clear_runs(Pnmread_T rdr, Bit2_T band, 
+ *                        const uint64_t *border, FILE *out, int raw)
+ * Does: the second pass. Reads the image again, labels its runs the way
+ *       the first pass did, turns white every run whose label's border bit
+ *       is set, and writes each band to out
+ */
+static void clear_runs(Pnmread_T rdr, Bit2_T band, const uint64_t *border,
+                       FILE *out, int raw)
+{
+        int height = rdr->height;
+        uint32_t next_label = 0;
+        Run_list rows[2];
+        new_rows(rows, rdr->width);
+        Run_list *above = &rows[0];
+        Run_list *cur = &rows[1];
+
+        for (int first = 0; first < height; first += band->height) {
+                int count = (height - first < band->height) ? 
+                            height - first : band->height;
+                Pbm_read_rows(rdr, band, count);
+                for (int j = 0; j < count; j++) {
+                        Components_row_runs(band, j, cur);
+                        Components_match_runs(above, cur, 4, NULL);
+                        for (int k = 0; k < cur->length; k++) {
+                                if (cur->label[k] == COMPONENTS_NO_LABEL) {
+                                        cur->label[k] = next_label++;
+                                }
+                                uint32_t label = cur->label[k];
+                                if ((border[label / 64] >> (label % 64)) & 
+                                    1) {
+                                        Bit2_put_run(band, cur->lo[k], 
+                                                     cur->hi[k], j, 0);
+                                }
+                        }
+                        Run_list *done = above;
+                        above = cur;
+                        cur = done;
+                }
+                Pbm_write_rows(out, band, count, raw);
+        }
+        free_rows(rows);
+}
+
+/* static void new_rows(Run_list rows[2], int width)
+ * Does: allocates two run lists, each long enough for any row of width
+ *       pixels, which has at most (width + 1) / 2 runs
+ */
+static void new_rows(Run_list rows[2], int width)
+{
+        int max_runs = (width + 1) / 2;
+        for (int k = 0; k < 2; k++) {
+                rows[k].lo = malloc(max_runs * sizeof(int));
+                rows[k].hi = malloc(max_runs * sizeof(int));
+                rows[k].label = malloc(max_runs * sizeof(uint32_t));
+                assert(rows[k].lo != NULL && rows[k].hi != NULL && 
+                       rows[k].label != NULL);
+                rows[k].length = 0;
+        }
+}
+
+/* static void free_rows(Run_list rows[2])
+ * Does: frees the two run lists made by new_rows
+ */
+static void free_rows(Run_list rows[2])
+{
+        for (int k = 0; k < 2; k++) {
+                free(rows[k].lo);
+                free(rows[k].hi);
+                free(rows[k].label);
+        }
+}
+
+/* static void grow_border(Label_table *table)
+ * Does: gives the border flags as much room as the forest has labels, the
+ *       new flags clear
+ */
+static void grow_border(Label_table *table)
+{
+        uint32_t capacity = table->forest.capacity;
+        if (capacity == table->border_capacity) {
+                return;
+        }
+        table->border = realloc(table->border, capacity);
+        assert(table->border != NULL);
+        memset(table->border + table->border_capacity, 0,
+               capacity - table->border_capacity);
+        table->border_capacity = capacity;
+}
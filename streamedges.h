@@ -0,0 +1,19 @@
+/* streamedges.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for the streaming black edge remover, which never holds more
+ * than a band of rows of the image, functions explained in implementation
+ */
+
+#include <stdio.h>
+#include <except.h>
+
+#ifndef STREAMEDGES_INCLUDED
+#define STREAMEDGES_INCLUDED
+
+extern const Except_T Streamedges_Seek;
+
+extern void remove_black_edges_stream(FILE *in, FILE *out, int raw);
+
+#endif
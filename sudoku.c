@@ -5,73 +5,641 @@
  * Summary: This program is used to take in a sudoku board in pgm format,
  *          determine whether it is a valid solution for a sudoku board in 
  *          which case it will return zero. Otherwise it will return 1. 
+ *          Besides the usual 9x9 game, any n*n by n*n board with n by n
+ *          submaps is accepted (a 16x16 board is a 16x16 pgm with maxval
+ *          16, and so on).
  *
+ *          Usage: sudoku [-v validator] [file.pgm]
+ *                 sudoku [-v validator] -b [-j threads] [file|directory]...
+ *                 sudoku -s [file.pgm]
+ *          validator is mask (the default, a single pass over the board with
+ *          a bitmask per row, column and submap) or classic (the original
+ *          map based checks); both give the same answers.
+ *          With -b the program runs in batch mode: every argument is either
+ *          a file holding any number of concatenated pgms or a directory of
+ *          such files (stdin when there are no arguments), and one line
+ *          "<name>:<board> valid|invalid|error: <reason>" is printed per
+ *          board. One board and check array are allocated up front and
+ *          reused for every board. The exit code is zero only if
+ *          every board was valid.
+ *
+ *          With -j, batch mode runs on threads reader threads (at most one
+ *          per file) and threads validator threads, which check boards 32
+ *          at a time with the Boards_T kernels, and prints exactly the same
+ *          lines; see parsudoku.c. -v does not apply there.
+ *
+ *          With -s the board is a puzzle instead, where 0 marks an empty
+ *          cell. It is solved (see sudokusolve.c) and the solution is
+ *          written to stdout as a plain pgm; the exit code is 1 if the
+ *          puzzle has no solution. The solver handles 9x9 puzzles only.
  */
 
-
-
-
+#define _POSIX_C_SOURCE 200112L
 
 #include <stdio.h>
 #include <except.h>
 #include <stdlib.h>
-#include "pnmrdr.h"
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "pnmread.h"
 #include "uarray2.h"
 #include "uarray.h"
 #include "seq.h"
 #include "assert.h"
+#include "sudokucheck.h"
+#include "parsudoku.h"
+#include "sudokusolve.h"
 
 
 FILE *check_arguments(FILE *fp, UArray2_T board, int argc, char *argv[]);
 
-void fill_board(FILE *fp, UArray2_T board);
+typedef struct Batch Batch;
+
+void fill_board(FILE *fp, Batch *batch, int puzzle);
 
-void populate_board(int col, int row, UArray2_T board, void *p1, void *cl);
+void populate_board(int row, UArray2_T board, void *elems, int length, 
+                    void *cl);
 
-void check_board(UArray2_T board);
+void populate_puzzle(int row, UArray2_T board, void *elems, int length,
+                     void *cl);
 
-void check_rows(int col, int row, UArray2_T board, void *p1, void *cl);
+void read_row(Pnmread_T rdr, int *cells, int length);
 
-void check_cols(int col, int row, UArray2_T board, void *p1, void *cl);
+void write_board(FILE *out, UArray2_T board);
 
-void check_box(UArray2_T board);
+void print_cell(int col, int row, UArray2_T board, void *p1, void *cl);
 
-Seq_T check_inside_box(int col, int row, UArray2_T board, Seq_T seq);
+void error(FILE *fp, UArray2_T board, char *msg);
 
-void check_box_dupes(UArray2_T board, Seq_T seq);
+void error_rdr(FILE *fp, Pnmread_T rdr, UArray2_T board, char *msg);
 
-void check_dupes(UArray2_T board, UArray2_T check_arr, void *p1);
+/* A named board validator that can be picked with -v */
+typedef struct Validator {
+        const char *name;
+        int (*check)(Batch *batch);
+} Validator;
 
-void clear_arr(int col, int row, UArray2_T board, void *p1, void *cl);
+/* Everything batch mode allocates once and reuses for every board */
+struct Batch {
+        Arena_T arena; /* holds board and check_arr, reset to resize them */
+        UArray2_T board; /* the board being checked */
+        UArray2_T check_arr; /* side x 1, marks digits seen in a row, column
+                                or submap */
+        const Validator *validator; /* checks batch->board */
+        int all_valid; /* 0 once any board was invalid or unreadable */
+};
 
-void error(FILE *fp, UArray2_T board, char *msg);
+int check_mask(Batch *batch);
+
+int check_classic(Batch *batch);
+
+static const Validator validators[] = {
+        { "mask",    check_mask },
+        { "classic", check_classic },
+};
+static const int NUM_VALIDATORS = sizeof(validators) / sizeof(validators[0]);
+
+/* Outcome of reading one board in batch mode */
+typedef enum Board_status { BOARD_OK, BOARD_SKIPPED, BOARD_FATAL } 
+        Board_status;
+
+const Validator *find_validator(const char *name);
+
+Batch *new_batch(const Validator *validator);
+
+void free_batch(Batch **batch);
+
+void resize_batch(Batch *batch, int side);
 
-void error_rdr(FILE *fp, Pnmrdr_T rdr, UArray2_T board, char *msg);
+int run_batch(Batch *batch, int npaths, char *paths[], int nthreads);
 
-/* constant integers representing the height and width of the sudoku board*/
+void collect_paths(const char *path, Seq_T files);
+
+char *copy_name(const char *name);
+
+void batch_path(Batch *batch, const char *path);
+
+int compare_names(const void *a, const void *b);
+
+void batch_stream(Batch *batch, FILE *fp, const char *name);
+
+Pnmread_T open_batch_reader(FILE *fp);
+
+Board_status read_batch_board(Batch *batch, Pnmread_T rdr, 
+                              const char **reason);
+
+Board_status load_board(Batch *batch, Pnmread_T rdr);
+
+int next_batch_board(Pnmread_T rdr);
+
+void load_row(int row, UArray2_T board, void *elems, int length, void *cl);
+
+/* constant integers representing the height and width of the usual sudoku
+   board, which boards start out at and the only size -s solves */
 const int HEIGHT = 9;
 const int WIDTH = 9;
 
 
 int main(int argc, char *argv[])
 {
-        UArray2_T board = UArray2_new(WIDTH, HEIGHT, sizeof(int));
+        const Validator *validator = &validators[0];
+        int batch_mode = 0;
+        int solve_mode = 0;
+        int nthreads = 0; /* 0 to validate on this thread only */
+        int first = 1; /* index of the first argument that is not an option */
+        while (first < argc) {
+                if (strcmp(argv[first], "-b") == 0) {
+                        batch_mode = 1;
+                } else if (strcmp(argv[first], "-s") == 0) {
+                        solve_mode = 1;
+                } else if (strcmp(argv[first], "-v") == 0 && 
+                           first + 1 < argc) {
+                        validator = find_validator(argv[++first]);
+                } else if (strcmp(argv[first], "-j") == 0 &&
+                           first + 1 < argc) {
+                        nthreads = atoi(argv[++first]);
+                        if (nthreads <= 0) {
+                                error(NULL, NULL, "Error: thread count must "
+                                      "be positive\n");
+                        }
+                } else {
+                        break;
+                }
+                first++;
+        }
+        if (batch_mode && solve_mode) {
+                error(NULL, NULL, "Error: -s solves a single board\n");
+        }
+
+        Batch *batch = new_batch(validator);
+        if (batch_mode) {
+                int status = run_batch(batch, argc - first, argv + first,
+                                       nthreads);
+                free_batch(&batch);
+                return status;
+        }
+
         FILE *fp = NULL;
-        /* making sure arguments are valid */
-        fp = check_arguments(fp, board, argc, argv);
+        /* making sure arguments are valid, with the options dropped */
+        argv[first - 1] = argv[0];
+        fp = check_arguments(fp, batch->board, argc - first + 1, 
+                             argv + first - 1);
 
         /* populating board with elements from pgm */
-        fill_board(fp, board);
+        fill_board(fp, batch, solve_mode);
 
         fclose(fp);
 
+        if (solve_mode) {
+                int solved = solve_board(batch->board);
+                if (solved) {
+                        write_board(stdout, batch->board);
+                } else {
+                        fprintf(stderr, "Error: puzzle has no solution\n");
+                }
+                free_batch(&batch);
+                exit(solved ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
         /* checks board for any duplicates */
-        check_board(board);
+        int valid = validator->check(batch);
 
-        UArray2_free(&board);
+        free_batch(&batch);
 
         /* exits with code 0 if there are no duplicates */
-        exit(EXIT_SUCCESS);
+        exit(valid ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+
+/* const Validator *find_validator(const char *name)
+ * Parameters: const char *name - validator name given on the command line
+ * Returns: pointer to the validators table entry called name
+ * Does: Looks up a validator by name, exiting with an error if there is no
+ *       such validator
+ */
+const Validator *find_validator(const char *name)
+{
+        for (int i = 0; i < NUM_VALIDATORS; i++) {
+                if (strcmp(validators[i].name, name) == 0) {
+                        return &validators[i];
+                }
+        }
+        error(NULL, NULL, "Error: unknown validator\n");
+        return NULL;
+}
+
+
+
+/* int check_mask(Batch *batch)
+ * Does: Runs the bitmask validator on batch->board
+ */
+int check_mask(Batch *batch)
+{
+        return check_board_mask(batch->board);
+}
+
+
+
+/* int check_classic(Batch *batch)
+ * Does: Runs the original validator on batch->board with the batch's 
+ *       reused scratch array
+ */
+int check_classic(Batch *batch)
+{
+        return check_board(batch->board, batch->check_arr);
+}
+
+
+
+/* Batch *new_batch(const Validator *validator)
+ * Parameters: const Validator *validator - validator used on every board
+ * Returns: a new Batch, with its board and scratch space allocated
+ * Does: Allocates everything validating a board needs, once
+ */
+Batch *new_batch(const Validator *validator)
+{
+        Batch *batch = malloc(sizeof(*batch));
+        assert(batch != NULL);
+        batch->arena = Arena_new();
+        batch->board = UArray2_new_arena(batch->arena, WIDTH, HEIGHT, 
+                                         sizeof(int));
+        batch->check_arr = UArray2_new_arena(batch->arena, WIDTH, 1, 
+                                             sizeof(int));
+        batch->validator = validator;
+        batch->all_valid = 1;
+        return batch;
+}
+
+
+
+/* void resize_batch(Batch *batch, int side)
+ * Parameters: Batch *batch - the batch to be resized
+ *             int side - width and height of the next board
+ * Returns: Nothing
+ * Does: Replaces the board and check array with ones for a side x side 
+ *       board, unless they already have that size. Both come from the
+ *       batch's arena, which is reset first, so once its chunks are on
+ *       CII's free list a mix of board sizes costs no malloc or free
+ */
+void resize_batch(Batch *batch, int side)
+{
+        if (UArray2_width(batch->board) == side) {
+                return;
+        }
+        Arena_free(batch->arena);
+        batch->board = UArray2_new_arena(batch->arena, side, side, 
+                                         sizeof(int));
+        batch->check_arr = UArray2_new_arena(batch->arena, side, 1, 
+                                             sizeof(int));
+}
+
+
+
+/* void free_batch(Batch **batch)
+ * Parameters: Batch **batch - pointer to the batch to be freed
+ * Returns: Nothing
+ * Does: frees the batch and everything it holds
+ */
+void free_batch(Batch **batch)
+{
+        assert(batch != NULL && *batch != NULL);
+        Arena_dispose(&(*batch)->arena);
+        free(*batch);
+        *batch = NULL;
+}
+
+
+
+/* int run_batch(Batch *batch, int npaths, char *paths[], int nthreads)
+ * Parameters: Batch *batch - the reused batch state
+ *             int npaths - number of paths given after -b
+ *             char *paths[] - the files and directories to validate
+ *             int nthreads - threads given with -j, or 0
+ * Returns: EXIT_SUCCESS if every board read was valid, else EXIT_FAILURE
+ * Does: Expands the paths into the list of files to read (stdin if there 
+ *       are none), then validates every board in every file, either with
+ *       the one batch or on nthreads threads, printing one line per board
+ */
+int run_batch(Batch *batch, int npaths, char *paths[], int nthreads)
+{
+        Seq_T files = Seq_new(64);
+        if (npaths == 0) {
+                /* NULL stands for stdin */
+                Seq_addhi(files, NULL);
+        }
+        for (int i = 0; i < npaths; i++) {
+                collect_paths(paths[i], files);
+        }
+
+        int nfiles = Seq_length(files);
+        if (nthreads > 0) {
+                char **list = malloc((nfiles + 1) * sizeof(char *));
+                assert(list != NULL);
+                for (int i = 0; i < nfiles; i++) {
+                        list[i] = Seq_get(files, i);
+                }
+                batch->all_valid = check_files_parallel(list, nfiles, 
+                                                        nthreads, nthreads);
+                free(list);
+        } else {
+                for (int i = 0; i < nfiles; i++) {
+                        char *path = Seq_get(files, i);
+                        if (path == NULL) {
+                                batch_stream(batch, stdin, "-");
+                        } else {
+                                batch_path(batch, path);
+                        }
+                }
+        }
+
+        for (int i = 0; i < nfiles; i++) {
+                free(Seq_get(files, i));
+        }
+        Seq_free(&files);
+        return batch->all_valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
+/* void collect_paths(const char *path, Seq_T files)
+ * Parameters: const char *path - a file of pgms or a directory of them
+ *             Seq_T files - list the files to read are added to
+ * Returns: Nothing
+ * Does: Adds a copy of path, or if it is a directory that can be read,
+ *       every entry in it (hidden ones skipped) in name order, so the
+ *       output does not depend on readdir's order
+ */
+void collect_paths(const char *path, Seq_T files)
+{
+        struct stat st;
+        DIR *dir = NULL;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+                dir = opendir(path);
+        }
+        if (dir == NULL) {
+                /* batch_path reports it if it cannot be read */
+                Seq_addhi(files, copy_name(path));
+                return;
+        }
+        Seq_T names = Seq_new(64);
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+                if (entry->d_name[0] == '.') {
+                        continue;
+                }
+                size_t len = strlen(path) + strlen(entry->d_name) + 2;
+                char *name = malloc(len);
+                assert(name != NULL);
+                snprintf(name, len, "%s/%s", path, entry->d_name);
+                Seq_addhi(names, name);
+        }
+        closedir(dir);
+
+        int count = Seq_length(names);
+        char **sorted = malloc((count + 1) * sizeof(char *));
+        assert(sorted != NULL);
+        for (int i = 0; i < count; i++) {
+                sorted[i] = Seq_get(names, i);
+        }
+        qsort(sorted, count, sizeof(char *), compare_names);
+        for (int i = 0; i < count; i++) {
+                collect_paths(sorted[i], files);
+                free(sorted[i]);
+        }
+        free(sorted);
+        Seq_free(&names);
+}
+
+
+
+/* char *copy_name(const char *name)
+ * Returns: a malloced copy of name
+ */
+char *copy_name(const char *name)
+{
+        size_t len = strlen(name) + 1;
+        char *copy = malloc(len);
+        assert(copy != NULL);
+        memcpy(copy, name, len);
+        return copy;
+}
+
+
+
+/* void batch_path(Batch *batch, const char *path)
+ * Parameters: Batch *batch - the reused batch state
+ *             const char *path - a file of pgms
+ * Returns: Nothing
+ * Does: Validates every board in the file, printing an error line if it 
+ *       cannot be opened (or is a directory that could not be read)
+ */
+void batch_path(Batch *batch, const char *path)
+{
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+                printf("%s:1 error: trouble reading directory\n", path);
+                batch->all_valid = 0;
+                return;
+        }
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) {
+                printf("%s:1 error: trouble reading file\n", path);
+                batch->all_valid = 0;
+                return;
+        }
+        batch_stream(batch, fp, path);
+        fclose(fp);
+}
+
+
+
+/* int compare_names(const void *a, const void *b)
+ * Does: qsort comparison of two char * file names
+ */
+int compare_names(const void *a, const void *b)
+{
+        return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+
+
+/* void batch_stream(Batch *batch, FILE *fp, const char *name)
+ * Parameters: Batch *batch - the reused batch state
+ *             FILE *fp - open stream of zero or more concatenated pgms
+ *             const char *name - name the result lines are printed under
+ * Returns: Nothing
+ * Does: Validates each board in the stream with one reader, printing
+ *       "name:n valid", "name:n invalid" or "name:n error: reason". A board
+ *       of the wrong size is skipped over; after a malformed header or a
+ *       truncated raster there is no way to find the next board, so the
+ *       rest of the stream is dropped
+ */
+void batch_stream(Batch *batch, FILE *fp, const char *name)
+{
+        Pnmread_T rdr = open_batch_reader(fp);
+        if (rdr == NULL) {
+                printf("%s:1 error: bad format, could not read image\n", 
+                       name);
+                batch->all_valid = 0;
+                return;
+        }
+        int more = 1;
+        for (int n = 1; more; n++) {
+                const char *reason = "";
+                Board_status status = read_batch_board(batch, rdr, &reason);
+                if (status != BOARD_OK) {
+                        printf("%s:%d error: %s\n", name, n, reason);
+                        batch->all_valid = 0;
+                        if (status == BOARD_FATAL) {
+                                break;
+                        }
+                } else if (batch->validator->check(batch)) {
+                        printf("%s:%d valid\n", name, n);
+                } else {
+                        printf("%s:%d invalid\n", name, n);
+                        batch->all_valid = 0;
+                }
+                more = next_batch_board(rdr);
+                if (more < 0) {
+                        printf("%s:%d error: bad format, could not read "
+                               "image\n", name, n + 1);
+                        batch->all_valid = 0;
+                        break;
+                }
+        }
+        Pnmread_free(&rdr);
+}
+
+
+
+/* Pnmread_T open_batch_reader(FILE *fp)
+ * Parameters: FILE *fp - open stream of pgms
+ * Returns: a reader positioned at the first board's raster, or NULL if the
+ *          stream does not start with a pnm header
+ */
+Pnmread_T open_batch_reader(FILE *fp)
+{
+        /* volatile so its value survives the longjmp out of Pnmread_new */
+        Pnmread_T volatile rdr = NULL;
+        TRY
+                rdr = Pnmread_new(fp);
+        EXCEPT(Pnmread_Badformat)
+                rdr = NULL;
+        EXCEPT(Pnmread_Count)
+                rdr = NULL;
+        END_TRY;
+        return rdr;
+}
+
+
+
+/* Board_status read_batch_board(Batch *batch, Pnmread_T rdr,
+ *                               const char **reason)
+ * Parameters: Batch *batch - batch state holding the reused board
+ *             Pnmread_T rdr - reader positioned at a board's raster
+ *             const char **reason - set to why the board was not read
+ * Returns: BOARD_OK once the board is loaded, BOARD_SKIPPED if the image was
+ *          read but is not an n*n by n*n pgm with maxval n*n, or 
+ *          BOARD_FATAL if the stream cannot be read any further
+ * Does: Loads the next board into batch->board
+ */
+Board_status read_batch_board(Batch *batch, Pnmread_T rdr, 
+                              const char **reason)
+{
+        if (rdr->format != 2 && rdr->format != 5) {
+                *reason = "incorrect file type, requires pgm file";
+                return BOARD_FATAL;
+        }
+        Board_status status = load_board(batch, rdr);
+        if (status == BOARD_FATAL) {
+                *reason = "could not read pixels";
+        } else if (status == BOARD_SKIPPED) {
+                *reason = "incorrect dimensions or denominator";
+        }
+        return status;
+}
+
+
+
+/* Board_status load_board(Batch *batch, Pnmread_T rdr)
+ * Parameters: Batch *batch - batch state holding the reused board
+ *             Pnmread_T rdr - reader positioned at a pgm raster
+ * Returns: BOARD_OK, BOARD_SKIPPED for a pgm of the wrong size (whose
+ *          pixels are read and dropped) or BOARD_FATAL if the raster is
+ *          malformed or ends early
+ */
+Board_status load_board(Batch *batch, Pnmread_T rdr)
+{
+        Board_status volatile status = BOARD_OK;
+        TRY
+                if (sudoku_box_size(rdr->width, rdr->height, 
+                                    rdr->maxval) == 0) {
+                        size_t pixels = (size_t)rdr->width * rdr->height;
+                        for (size_t i = 0; i < pixels; i++) {
+                                Pnmread_pixel(rdr);
+                        }
+                        status = BOARD_SKIPPED;
+                } else {
+                        resize_batch(batch, rdr->width);
+                        UArray2_map_rows(batch->board, load_row, rdr);
+                }
+        EXCEPT(Pnmread_Badformat)
+                status = BOARD_FATAL;
+        EXCEPT(Pnmread_Count)
+                status = BOARD_FATAL;
+        END_TRY;
+        return status;
+}
+
+
+
+/* int next_batch_board(Pnmread_T rdr)
+ * Parameters: Pnmread_T rdr - reader that has consumed a whole raster
+ * Returns: 1 if another board follows, 0 at end of input, -1 if what
+ *          follows is not a pnm header
+ */
+int next_batch_board(Pnmread_T rdr)
+{
+        int volatile more = 0;
+        TRY
+                more = Pnmread_next(rdr);
+        EXCEPT(Pnmread_Badformat)
+                more = -1;
+        EXCEPT(Pnmread_Count)
+                more = -1;
+        END_TRY;
+        return more;
+}
+
+
+
+/* void load_row(int row, UArray2_T board, void *elems, int length, 
+ *               void *cl)
+ * Parameters: int row - row number
+ *             UArray2_T board - the board being loaded
+ *             void *elems - the row's cells
+ *             int length - number of cells in the row
+ *             void *cl - holds the Pnmread_T object
+ * Returns: Nothing
+ * Does: Batch mode version of populate_board; a digit outside 1 to side is
+ *       stored as 0, which check_dupes rejects, instead of failing an
+ *       assertion, so one bad board does not end the batch
+ */
+void load_row(int row, UArray2_T board, void *elems, int length, void *cl)
+{
+        (void) row;
+        (void) board;
+        int *cells = elems;
+        read_row(cl, cells, length);
+        for (int col = 0; col < length; col++) {
+                /* 0 and negatives wrap around past length */
+                if ((unsigned)cells[col] - 1 >= (unsigned)length) {
+                        cells[col] = 0;
+                }
+        }
 }
 
 
@@ -110,322 +678,186 @@ FILE *check_arguments(FILE *fp, UArray2_T board, int argc, char *argv[])
 
 
 
-/* void fill_board(FILE *fp, UArray2_T board)
- * Parameters: FILE *fp - opened file to become a Pnmrdr_T object
- *             UArray2_T board - array representing full sudoku board
+/* void fill_board(FILE *fp, Batch *batch, int puzzle)
+ * Parameters: FILE *fp - opened file to become a Pnmread_T object
+ *             Batch *batch - holds the array representing the full sudoku
+ *                            board, resized to fit the pgm
+ *             int puzzle - nonzero if cells may be 0 (empty)
  * Returns: Nothing
- * Does: This function creates a Pnmrdr_T object, checks that the data for
+ * Does: This function creates a Pnmread_T object, checks that the data for
  *       that object is correct for the formatting, and then uses
- *       UArray2_map_row_major to call a helper function to populate the array
+ *       UArray2_map_rows to call a helper function to populate the array
  *
  */
-void fill_board(FILE *fp, UArray2_T board) 
+void fill_board(FILE *fp, Batch *batch, int puzzle) 
 {
-        Pnmrdr_T rdr;
-        Pnmrdr_mapdata data;
+        Pnmread_T rdr = NULL;
 
-        /* TRY/EXCEPT statements used to make sure that Pnmrdr_T object is
+        /* TRY/EXCEPT statements used to make sure that Pnmread_T object is
            in the correct format all around || this one creates an object used
            to check the pixel intensity */
          TRY
-                 rdr = Pnmrdr_new(fp);
+                 rdr = Pnmread_new(fp);
          
-         EXCEPT(Pnmrdr_Badformat)
-                 error_rdr(fp, rdr, board,
+         EXCEPT(Pnmread_Badformat)
+                 error_rdr(fp, rdr, batch->board,
                            "Error: bad format, could not read image\n");
          
-         EXCEPT(Pnmrdr_Count)
-                 error_rdr(fp, rdr, board,
+         EXCEPT(Pnmread_Count)
+                 error_rdr(fp, rdr, batch->board,
                            "Error: could not read pixels\n");
          END_TRY;
-         
-         data = Pnmrdr_data(rdr);
 
          /*makes sure board is the right size/type */
-         if (data.type != Pnmrdr_gray) {
-                error_rdr(fp, rdr, board,
+         if (rdr->format != 2 && rdr->format != 5) {
+                error_rdr(fp, rdr, batch->board,
                           "Error: incorrect file type, requires pgm file\n");
          }
          
-         if (data.width != 9 || data.height != 9 || data.denominator != 9) {
-                 error_rdr(fp, rdr, board,
+         if (sudoku_box_size(rdr->width, rdr->height, rdr->maxval) == 0) {
+                 error_rdr(fp, rdr, batch->board,
                            "Error: incorrect dimensions or denominator\n");
         }
+         if (puzzle && rdr->width != WIDTH) {
+                 error_rdr(fp, rdr, batch->board, 
+                           "Error: only 9x9 puzzles can be solved\n");
+         }
+         resize_batch(batch, rdr->width);
          
          /*fills board with the elemnts at each square of the sudoku board */
-         UArray2_map_row_major(board, populate_board, rdr);
+         UArray2_map_rows(batch->board, puzzle ? populate_puzzle 
+                                               : populate_board, rdr);
          
-         Pnmrdr_free(&rdr);
+         Pnmread_free(&rdr);
 }
 
 
 
-/* void populate_board(int col, int row, UArray2_T board, void *p1, void *cl)
- * Parameters: int col - column number
- *             int row - row number
+/* void populate_board(int row, UArray2_T board, void *elems, int length,
+ *                     void *cl)
+ * Parameters: int row - row number
  *             UArray2_T board - array representing sudoku board
- *             void *p1 - holds value at position board(i, j)
- *             void *p2 - holds the Pnmrdr_T object
+ *             void *elems - the row's cells, a plain int array
+ *             int length - number of cells in the row
+ *             void *cl - holds the Pnmread_T object
  * Returns: Nothing
- * Does: Called by UArray2_map_row_major which iterates through the board
- *       populating it with the values from p2
+ * Does: Called by UArray2_map_rows once per row of the board, populating
+ *       the row with the next length values from cl
  *
  */
-void populate_board(int col, int row, UArray2_T board, void *p1, void *cl)
+void populate_board(int row, UArray2_T board, void *elems, int length, 
+                    void *cl)
 {
-        (void) col;
         (void) row;
-        (void) board;
         
         /* makes sure arguments are correctly passed */ 
         assert(cl != NULL);
-        assert(sizeof(*(int *)p1) == UArray2_size(board));
+        assert(sizeof(int) == UArray2_size(board));
         
-        /* sets index in board (p1) to the corresponding index on the sudoku 
-           board in Pnmrdr_T format */
-        int val = Pnmrdr_get(cl);
-        assert(val > 0 && val < 10);
-        *(int *)p1 = val;
-}
-
-
-
-/* void check_board(UArray2_T board)
- * Parameters: UArray2_T board - array representing the full sudoku board
- * Returns: Nothing
- * Does: Used to call functions which check that each row, column, and 3x3
- *       submap contains a set of the numbers 1-9
- *
- */
-void check_board(UArray2_T board)
-{
-        UArray2_T check_arr = UArray2_new(9, 1, sizeof(int));
-        
-        /* checks all rows */
-        UArray2_map_row_major(board, check_rows, &check_arr);
-        /* checks all columns */
-        UArray2_map_col_major(board, check_cols, &check_arr);
-        
-        
-        UArray2_free(&check_arr);
-        
-        /* checks all 3x3 submaps */
-        check_box(board);
+        int *cells = elems;
+        read_row(cl, cells, length);
+        for (int col = 0; col < length; col++) {
+                assert(cells[col] > 0 && cells[col] <= length);
+        }
 }
 
 
 
-/* void check_rows(int col, int row, UArray2_T board, void *p1, void *cl)
- * Parameters: int col - column number
- *             int row - row number                                      
- *             UArray2_T board - array representing the sudoku board
- *             void *p1 - holds value at position board(i, j)
- *             void *p2 - holds the temporary 9x1 array used to check for 
- *                        duplicates in a row
- * Returns: Nothing
- * Does: Checks to make sure that all rows have a set of numbers 1-9 with no 
- *       duplicates
+/* void populate_puzzle(int row, UArray2_T board, void *elems, int length,
+ *                      void *cl)
+ * Does: Version of populate_board for -s, where a 0 (an empty cell) is
+ *       allowed as well as the digits 1-9
  */
-void check_rows(int col, int row, UArray2_T board, void *p1, void *cl)
+void populate_puzzle(int row, UArray2_T board, void *elems, int length,
+                     void *cl)
 {
         (void) row;
-        (void) board;
-        (void) p1;
-
-        /* if the column number is zero, it resets the 9x1 array */
-        if (col == 0) {
-                UArray2_map_row_major(*(UArray2_T *)cl, clear_arr, NULL);
-        }
-
-        /* checks for duplicates */
-        check_dupes(board, *(UArray2_T *)cl, p1);
-}
-
 
+        assert(cl != NULL);
+        assert(sizeof(int) == UArray2_size(board));
 
-/* void check_cols(int col, int row, UArray2_T board, void *p1, void *cl)
- * Parameters: int col - column number
- *             int row - row number
- *             UArray2_T board - array representing the sudoku board
- *             void *p1 - holds value at position board(i, j)
- *             void *p2 - holds the temporary 9x1 array used to check for     
- *                        duplicates in a column 
- * Returns: Nothing
- * Does:Checks to make sure that all rows have a set of numbers 1-9 with no    
- *       duplicates 
- *
- */
-void check_cols(int col, int row, UArray2_T board, void *p1, void *cl)
-{
-        (void) col;
-        (void) board;
-        (void) p1;
-
-        /* if the row number is zero, it resets the 9x1 array */
-        if (row == 0) {
-                UArray2_map_row_major(*(UArray2_T *)cl, clear_arr, NULL);
+        int *cells = elems;
+        read_row(cl, cells, length);
+        for (int col = 0; col < length; col++) {
+                assert(cells[col] >= 0 && cells[col] < 10);
         }
-
-        /* checks for duplicates */
-        check_dupes(board, *(UArray2_T *)cl, p1);
 }
 
 
 
-/* void check_box(UArray2_T board)
- * Parameters: UArray2_T board - array representing the sudoku board
+/* void read_row(Pnmread_T rdr, int *cells, int length)
+ * Parameters: Pnmread_T rdr - reader positioned in a pgm raster
+ *             int *cells - where the pixels are stored
+ *             int length - number of pixels to read
  * Returns: Nothing
- * Does: Goes to each 3x3 submap and creates a sequence containing the values 
- *       inside it to be checked for duplicates
- *
+ * Does: Reads the next length pixels. A raw pgm with one byte per pixel
+ *       hands out the whole row at once and is widened in one loop;
+ *       otherwise the pixels are read one at a time
  */
-void check_box(UArray2_T board)
+void read_row(Pnmread_T rdr, int *cells, int length)
 {
-        /* hits every submap, one per iteration of inner loop */
-        for (int i = 3; i <= UArray2_width(board); i += 3) {                 
-                for (int j = 3; j <= UArray2_height(board); j += 3) {
-                        /* new sequence initialized to be passed for each 
-                           check of a submap */         
-                        Seq_T seq = Seq_new(9);                              
-                        seq = check_inside_box(i, j, board, seq);              
-                        check_box_dupes(board, seq);                          
+        if (rdr->format == 5 && rdr->maxval < 256) {
+                const unsigned char *bytes = Pnmread_span(rdr, length);
+                for (int col = 0; col < length; col++) {
+                        cells[col] = bytes[col];
                 }
-        }                                
-}
-
-
-
-/* Seq_T check_inside_box(int col, int row, UArray2_T board, Seq_T seq)
- * Parameters: int col - the column value of the index pair
- *             int row - the row value of the index pair
- *             UArray2_T board - The array representing the sudoku board
- *             Seq_T seq - The sequence to be filled
- * Returns: Seq_T object containing the int's in one of the nine 3x3 boxes of
- *          the sudoku board
- * Does: Iterates through one of the nine 3x3 boxes important in evaluating a 
- *       correct sudoku board, and returns a sequence of those int's to be 
- *       checked for duplicates
- *
- */
-Seq_T check_inside_box(int col, int row, UArray2_T board, Seq_T seq)
-{
-        /* adds every element in a submap to a sequence to be returned */
-        for (int i = col - 3; i < col; i++) {
-                for (int j = row - 3; j < row; j++){
-                        Seq_addlo(seq, UArray2_at(board, i, j));
-                }
-        }
-        
-        return seq;
-}
-
-
-
-/* void check_box_dupes(UArray2_T board, Seq_T seq)
- * Parameters: UArray2_T board - array representing the full sudoku board
- *             Seq_T seq - sequence to be checked for duplicates 
- * Returns: Nothing
- * Does: Checks the sequence holding the values in an individual 3x3 submap
- *       for any duplicates
- *
- */
-void check_box_dupes(UArray2_T board, Seq_T seq)
-{
-        for (int i = 0; i < Seq_length(seq); i++) {
-                for (int j = i+1; j < Seq_length(seq); j++) {
-                  int val_i = *(int *)Seq_get(seq, i);
-                  int val_j = *(int *)Seq_get(seq, j);
-                        if (val_i == val_j){
-                                /* frees both objects in case this case is 
-                                   hit */
-                                Seq_free(&seq);
-                                UArray2_free(&board);
-                                exit(EXIT_FAILURE);
-                        } 
+        } else {
+                for (int col = 0; col < length; col++) {
+                        cells[col] = Pnmread_pixel(rdr);
                 }
         }
-        /* frees the sequence in case there are no duplicates */
-        Seq_free(&seq);
 }
 
 
 
-/* void check_dupes(UArray2_T board, UArray2_T check_arr, void *p1)
- * Parameters: UArray2_T board - array holding the sudoku board
- *             UArray2_T check_arr - holds a single row or column to be 
- *                                   checked
- *             void *p1 - holds vaue at check_arr(i, j)
+/* void write_board(FILE *out, UArray2_T board)
+ * Parameters: FILE *out - stream to write to
+ *             UArray2_T board - solved sudoku board
  * Returns: Nothing
- * Does: Checks the array holding either a column or a row for any duplicates
- *
+ * Does: Writes the board as a plain (P2) 9x9 pgm with maxval 9, one row of
+ *       the board per line
  */
-void check_dupes(UArray2_T board, UArray2_T check_arr, void *p1)
+void write_board(FILE *out, UArray2_T board)
 {
-        int cur = *(int *)p1;
-        int *next = NULL;
-        
-        next = (int *)UArray2_at(check_arr, (cur - 1), 0);
-        
-        if (*next == 0){
-                *next = 1;
-        } else {
-                UArray2_free(&check_arr);
-                UArray2_free(&board);
-                exit(EXIT_FAILURE);
-        }
-        
+        fprintf(out, "P2\n%d %d\n9\n", WIDTH, HEIGHT);
+        UArray2_map_row_major(board, print_cell, out);
 }
 
 
 
-/* void clear_arr(int col, int row, UArray2_T board, void *p1, void *cl)
- * Parameters: int col - column value
- *             int row - row value
- *             UArray2_T board - array holding single row or column to be 
- *                               reset each time a new one is encountered 
- *             void *p1 - holds value at board(row, col)
- *             void *p2 - NULL
- * Returns: Nothing
- * Does: Resets the array holding a single row or column each time a new row or
- *       column is encountered by the mapping functions
- *
+/* void print_cell(int col, int row, UArray2_T board, void *p1, void *cl)
+ * Does: Called by UArray2_map_row_major to print the cell p1 to the stream
+ *       cl, followed by a space or, at the end of a row, a newline
  */
-void clear_arr(int col, int row, UArray2_T board, void *p1, void *cl)
+void print_cell(int col, int row, UArray2_T board, void *p1, void *cl)
 {
-        (void) col;
         (void) row;
         (void) board;
-        (void) cl;
-        
-        assert(sizeof(*(int *)p1) == UArray2_size(board));
-        
-        /* used to reset each value in the array to 0 */
-        *(int *)p1 = 0; 
-
+        fprintf(cl, "%d%c", *(int *)p1, col == WIDTH - 1 ? '\n' : ' ');
 }
 
 
 
 /*                                                                         
- * void error_rdr(FILE *fp, Pnmrdr_T rdr, char *msg)                         
+ * void error_rdr(FILE *fp, Pnmread_T rdr, char *msg)                         
  * Parameters: FILE *fp - pointer to opened FILE object, to be closed if an   
  *                        error is encountered                                
- *            Pnmrdr_T rdr - Pnmrdr_T object passed to be freed if an error is 
+ *            Pnmread_T rdr - Pnmread_T object passed to be freed if an error is 
  *                           encountered                                       
  *            char *msg - custom error message                                
  * Returns: Nothing                                                            
- * Does: When a file exists and a Pnmrdr_T object is created, but is in the    
- *       wrong format, or the Pnmrdr_T is empty, this function is called in    
+ * Does: When a file exists and a Pnmread_T object is created, but is in the    
+ *       wrong format, or the Pnmread_T is empty, this function is called in    
  *       average_brightness in order to print an error message, close the file,
- *       free the Pnmrdr_T object, and exit the program with EXIT_FAILURE.     
+ *       free the Pnmread_T object, and exit the program with EXIT_FAILURE.     
  */ 
-void error_rdr(FILE *fp, Pnmrdr_T rdr, UArray2_T board, char *msg)
+void error_rdr(FILE *fp, Pnmread_T rdr, UArray2_T board, char *msg)
 {
         void *rdr_p = rdr;
         fprintf(stderr, "%s", msg);
         
         if (rdr_p != NULL) {
-                Pnmrdr_free(&rdr);
+                Pnmread_free(&rdr);
         }
         if (fp != NULL) {
                 fclose(fp);
@@ -0,0 +1,402 @@
+/*
+ * Filename: sudokucheck.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Sudoku validators used by sudoku. A board has n*n by n*n
+ *          cells split into n by n submaps of n*n cells each (n is 3 for
+ *          the usual 9x9 game, 4 for 16x16, 5 for 25x25). Each validator
+ *          takes a loaded board of ints and returns 1 if every row, column
+ *          and submap holds each of the digits 1 to n*n exactly once, else
+ *          0. A cell outside that range makes the board invalid.
+ *
+ *          check_board is the original validator, which makes a row major
+ *          pass and a column major pass that clear and fill an n*n by 1
+ *          array of seen flags, then does the same for each submap
+ *          through a UArray2_view_T of it. check_board_mask reads each
+ *          cell once and keeps a bitmask of the digits seen so far in
+ *          every row, column and submap, so a duplicate is one OR and one
+ *          AND away. The common sizes get their own copy of the loop,
+ *          stamped out by MASK_KERNEL with the side and submap size as
+ *          constants and the masks in the smallest integer that holds them
+ *          (16 bits for 9 and 16, 32 bits for 25), all on the stack. Any
+ *          other size runs the same loop over masks of as many 64-bit
+ *          words as it needs.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "uarray2.h"
+#include "assert.h"
+#include "sudokucheck.h"
+
+/* Closure for check_rows and check_cols */
+typedef struct Check {
+        UArray2_T check_arr;
+        int valid; /* 0 once a duplicate was found */
+} Check;
+
+void check_rows(int col, int row, UArray2_T board, void *p1, void *cl);
+
+void check_cols(int col, int row, UArray2_T board, void *p1, void *cl);
+
+int check_box(UArray2_T board, UArray2_T check_arr);
+
+void check_cell(int col, int row, UArray2_view_T *view, void *p1, void *cl);
+
+int check_dupes(UArray2_T check_arr, void *p1);
+
+int box_size_of(UArray2_T board);
+
+int check_mask_any(UArray2_T board, int box);
+
+void clear_arr(int col, int row, UArray2_T board, void *p1, void *cl);
+
+
+
+/* MASK_KERNEL(name, side, box, mask_t)
+ * Defines static int name(UArray2_T board), the check_board_mask loop for
+ * a side x side board with box x box submaps. Digit d is bit d - 1 of a
+ * mask_t, and rows[], cols[] and boxes[] hold the digits seen so far in
+ * each row, column and submap, so a cell is a duplicate exactly when its
+ * bit is already set in the OR of its three masks. Since side and box are
+ * constants, the compiler turns the divisions into multiplies and keeps
+ * the masks in as few registers and cache lines as it can
+ */
+#define MASK_KERNEL(name, side, box, mask_t)                                  \
+static int name(UArray2_T board)                                              \
+{                                                                             \
+        mask_t rows[side] = { 0 };                                            \
+        mask_t cols[side] = { 0 };                                            \
+        mask_t boxes[side] = { 0 };                                           \
+        for (int row = 0; row < (side); row++) {                              \
+                const int *cells = UArray2_row(board, row);                   \
+                mask_t *row_box = &boxes[(row / (box)) * (box)];              \
+                for (int col = 0; col < (side); col++) {                      \
+                        /* 0 and negatives wrap around to large values */     \
+                        unsigned digit = (unsigned)cells[col] - 1;            \
+                        if (digit >= (side)) {                                \
+                                return 0;                                     \
+                        }                                                     \
+                        mask_t bit = (mask_t)((mask_t)1 << digit);            \
+                        mask_t *in_box = &row_box[col / (box)];               \
+                        if ((rows[row] | cols[col] | *in_box) & bit) {        \
+                                return 0;                                     \
+                        }                                                     \
+                        rows[row] |= bit;                                     \
+                        cols[col] |= bit;                                     \
+                        *in_box |= bit;                                       \
+                }                                                             \
+        }                                                                     \
+        return 1;                                                             \
+}
+
+MASK_KERNEL(check_mask_9, 9, 3, uint16_t)
+MASK_KERNEL(check_mask_16, 16, 4, uint16_t)
+MASK_KERNEL(check_mask_25, 25, 5, uint32_t)
+
+
+
+/* int check_board_mask(UArray2_T board)
+ * Parameters: UArray2_T board - n*n by n*n array of ints holding the board
+ * Returns: 1 if the board is a solved sudoku, 0 otherwise
+ * Does: Walks the board once in row major order, keeping a mask of the
+ *       digits seen in each row, column and submap, with the kernel made
+ *       for the board's size if there is one
+ */
+int check_board_mask(UArray2_T board)
+{
+        assert(UArray2_size(board) == sizeof(int));
+        int box = box_size_of(board);
+        switch (box) {
+        case 3:
+                return check_mask_9(board);
+        case 4:
+                return check_mask_16(board);
+        case 5:
+                return check_mask_25(board);
+        default:
+                return check_mask_any(board, box);
+        }
+}
+
+
+
+/* int check_mask_any(UArray2_T board, int box)
+ * Parameters: UArray2_T board - box*box by box*box array of ints
+ *             int box - width of a submap
+ * Returns: 1 if the board is a solved sudoku, 0 otherwise
+ * Does: The MASK_KERNEL loop for sizes without a kernel of their own; each
+ *       mask is an array of 64-bit words, and all 3 * side of them share
+ *       one zeroed block, on the stack for boards up to 64 wide (one word
+ *       per mask) so a batch of them makes no allocator calls
+ */
+int check_mask_any(UArray2_T board, int box)
+{
+        int side = box * box;
+        int words = (side + 63) / 64;
+        uint64_t local[3 * 64];
+        uint64_t *rows = local;
+        if (words == 1) {
+                memset(local, 0, 3 * side * sizeof(uint64_t));
+        } else {
+                rows = calloc((size_t)3 * side * words, sizeof(uint64_t));
+                assert(rows != NULL);
+        }
+        uint64_t *cols = rows + (size_t)side * words;
+        uint64_t *boxes = cols + (size_t)side * words;
+        int valid = 1;
+
+        for (int row = 0; row < side && valid; row++) {
+                const int *cells = UArray2_row(board, row);
+                for (int col = 0; col < side; col++) {
+                        unsigned digit = (unsigned)cells[col] - 1;
+                        if (digit >= (unsigned)side) {
+                                valid = 0;
+                                break;
+                        }
+                        size_t word = digit / 64;
+                        uint64_t bit = (uint64_t)1 << (digit % 64);
+                        uint64_t *in_row = &rows[(size_t)row * words + word];
+                        uint64_t *in_col = &cols[(size_t)col * words + word];
+                        uint64_t *in_box = &boxes[(size_t)((row / box) * box
+                                                  + col / box) * words + 
+                                                  word];
+                        if ((*in_row | *in_col | *in_box) & bit) {
+                                valid = 0;
+                                break;
+                        }
+                        *in_row |= bit;
+                        *in_col |= bit;
+                        *in_box |= bit;
+                }
+        }
+        if (rows != local) {
+                free(rows);
+        }
+        return valid;
+}
+
+
+
+/* int sudoku_box_size(int width, int height, int maxval)
+ * Parameters: int width, int height, int maxval - from a pgm header
+ * Returns: n if the image can be an n*n by n*n sudoku board (square, with
+ *          a side that is a perfect square and a maxval equal to it), or 0
+ */
+int sudoku_box_size(int width, int height, int maxval)
+{
+        if (width != height || width != maxval || width < 1) {
+                return 0;
+        }
+        int box = 1;
+        while (box * box < width) {
+                box++;
+        }
+        return box * box == width ? box : 0;
+}
+
+
+
+/* int box_size_of(UArray2_T board)
+ * Returns: the submap width of the board, which must be n*n by n*n
+ */
+int box_size_of(UArray2_T board)
+{
+        int box = sudoku_box_size(UArray2_width(board), UArray2_height(board),
+                                  UArray2_width(board));
+        assert(box != 0);
+        return box;
+}
+
+
+
+/* int check_board(UArray2_T board, UArray2_T check_arr)
+ * Parameters: UArray2_T board - array representing the full sudoku board
+ *             UArray2_T check_arr - side x 1 scratch array for rows,
+ *                                   columns and submaps, side being the
+ *                                   board's width
+ * Returns: 1 if the board is a solved sudoku, 0 if it has a duplicate
+ * Does: Used to call functions which check that each row, column, and
+ *       submap contains a set of the numbers 1 to side. The scratch array
+ *       is passed in so batch mode can reuse it for every board
+ */
+int check_board(UArray2_T board, UArray2_T check_arr)
+{
+        assert(UArray2_width(check_arr) == UArray2_width(board));
+        Check check = { check_arr, 1 };
+        
+        /* checks all rows */
+        UArray2_map_row_major(board, check_rows, &check);
+        /* checks all columns */
+        UArray2_map_col_major(board, check_cols, &check);
+        
+        /* checks all submaps */
+        return check.valid && check_box(board, check_arr);
+}
+
+
+
+/* void check_rows(int col, int row, UArray2_T board, void *p1, void *cl)
+ * Parameters: int col - column number
+ *             int row - row number                                      
+ *             UArray2_T board - array representing the sudoku board
+ *             void *p1 - holds value at position board(i, j)
+ *             void *p2 - holds the Check closure with the temporary side x 1
+ *                        array used to check for duplicates in a row
+ * Returns: Nothing
+ * Does: Checks to make sure that all rows have a set of numbers 1 to side
+ *       with no duplicates, clearing the closure's valid flag if one does not
+ */
+void check_rows(int col, int row, UArray2_T board, void *p1, void *cl)
+{
+        (void) row;
+        (void) board;
+        Check *check = cl;
+
+        /* if the column number is zero, it resets the side x 1 array */
+        if (col == 0) {
+                UArray2_map_row_major(check->check_arr, clear_arr, NULL);
+        }
+
+        /* checks for duplicates */
+        if (!check_dupes(check->check_arr, p1)) {
+                check->valid = 0;
+        }
+}
+
+
+
+/* void check_cols(int col, int row, UArray2_T board, void *p1, void *cl)
+ * Parameters: int col - column number
+ *             int row - row number
+ *             UArray2_T board - array representing the sudoku board
+ *             void *p1 - holds value at position board(i, j)
+ *             void *p2 - holds the Check closure with the temporary side x 1
+ *                        array used to check for duplicates in a column 
+ * Returns: Nothing
+ * Does:Checks to make sure that all rows have a set of numbers 1 to side
+ *       with no duplicates, clearing the closure's valid flag if one does not
+ *
+ */
+void check_cols(int col, int row, UArray2_T board, void *p1, void *cl)
+{
+        (void) col;
+        (void) board;
+        Check *check = cl;
+
+        /* if the row number is zero, it resets the side x 1 array */
+        if (row == 0) {
+                UArray2_map_row_major(check->check_arr, clear_arr, NULL);
+        }
+
+        /* checks for duplicates */
+        if (!check_dupes(check->check_arr, p1)) {
+                check->valid = 0;
+        }
+}
+
+
+
+/* int check_box(UArray2_T board, UArray2_T check_arr)
+ * Parameters: UArray2_T board - array representing the sudoku board
+ *             UArray2_T check_arr - side x 1 scratch array
+ * Returns: 1 if no submap has a duplicate, else 0
+ * Does: Looks at each submap through a view of the board, clearing the
+ *       scratch array and marking the submap's digits in it the way
+ *       check_rows does for a row, so nothing is copied or allocated
+ *
+ */
+int check_box(UArray2_T board, UArray2_T check_arr)
+{
+        int box = box_size_of(board);
+        Check check = { check_arr, 1 };
+        int count = UArray2_tile_count(board, box, box);
+        /* one view per submap, a row of submaps at a time */
+        for (int k = 0; k < count && check.valid; k++) {
+                UArray2_map_row_major(check_arr, clear_arr, NULL);
+                UArray2_view_map_row_major(UArray2_tile(board, box, box, k),
+                                           check_cell, &check);
+        }
+        return check.valid;
+}
+
+
+
+/* void check_cell(int col, int row, UArray2_view_T *view, void *p1,
+ *                 void *cl)
+ * Parameters: int col, int row - position in the submap
+ *             UArray2_view_T *view - view of the submap
+ *             void *p1 - holds the value at (col, row) of the submap
+ *             void *cl - holds the Check closure with the temporary side
+ *                        x 1 array used to check for duplicates
+ * Returns: Nothing
+ * Does: Marks the cell's digit as seen in the submap, clearing the
+ *       closure's valid flag if it was seen already
+ */
+void check_cell(int col, int row, UArray2_view_T *view, void *p1, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) view;
+        Check *check = cl;
+        if (!check_dupes(check->check_arr, p1)) {
+                check->valid = 0;
+        }
+}
+
+
+
+/* int check_dupes(UArray2_T check_arr, void *p1)
+ * Parameters: UArray2_T check_arr - holds a single row or column to be 
+ *                                   checked
+ *             void *p1 - holds vaue at check_arr(i, j)
+ * Returns: 1 if the value was not seen yet in this row or column, else 0
+ * Does: Checks the array holding either a column or a row for any duplicates
+ *
+ */
+int check_dupes(UArray2_T check_arr, void *p1)
+{
+        int cur = *(int *)p1;
+        int *next = NULL;
+        
+        /* batch mode loads a digit outside 1 to side as 0 */
+        if (cur < 1 || cur > UArray2_width(check_arr)) {
+                return 0;
+        }
+        next = (int *)UArray2_at(check_arr, (cur - 1), 0);
+        
+        if (*next == 0){
+                *next = 1;
+                return 1;
+        }
+        return 0;
+}
+
+
+
+/* void clear_arr(int col, int row, UArray2_T board, void *p1, void *cl)
+ * Parameters: int col - column value
+ *             int row - row value
+ *             UArray2_T board - array holding single row or column to be 
+ *                               reset each time a new one is encountered 
+ *             void *p1 - holds value at board(row, col)
+ *             void *p2 - NULL
+ * Returns: Nothing
+ * Does: Resets the array holding a single row or column each time a new row or
+ *       column is encountered by the mapping functions
+ *
+ */
+void clear_arr(int col, int row, UArray2_T board, void *p1, void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) board;
+        (void) cl;
+        
+        assert(sizeof(*(int *)p1) == UArray2_size(board));
+        
+        /* used to reset each value in the array to 0 */
+        *(int *)p1 = 0; 
+
+}
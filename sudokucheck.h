@@ -0,0 +1,18 @@
+/* sudokucheck.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for the sudoku board validators, functions explained in 
+ * implementation
+ */
+
+#include "uarray2.h"
+
+#ifndef SUDOKUCHECK_INCLUDED
+#define SUDOKUCHECK_INCLUDED
+
+extern int check_board(UArray2_T board, UArray2_T check_arr);
+extern int check_board_mask(UArray2_T board);
+extern int sudoku_box_size(int width, int height, int maxval);
+
+#endif
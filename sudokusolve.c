@@ -0,0 +1,262 @@
+/*
+ * Filename: sudokusolve.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: Sudoku solver used by sudoku -s. A puzzle is a 9x9 board of
+ *          ints where 0 is an empty cell. The solver copies it into a
+ *          compact grid that keeps, next to the cells, a 16-bit mask of the
+ *          digits already placed in every row, column and 3x3 submap, so
+ *          the candidates of a cell are one OR and one NOT away.
+ *
+ *          Search is constraint propagation with backtracking. Propagation
+ *          repeatedly places naked singles (a cell with one candidate) and
+ *          hidden singles (a digit with one possible cell in a unit), and
+ *          fails as soon as a cell has no candidates or a unit has a digit
+ *          with nowhere to go. When it stalls, the solver branches on the
+ *          empty cell with the fewest candidates, trying each on a copy of
+ *          the grid (the grid is 140 bytes, so copying is cheaper than
+ *          undoing).
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "uarray2.h"
+#include "assert.h"
+#include "sudokusolve.h"
+
+#define ALL_DIGITS 0x3FE /* bits 1-9 */
+
+typedef struct Grid {
+        uint8_t cells[81];  /* row major, 0 for empty */
+        uint16_t rows[9];   /* digits placed in each row */
+        uint16_t cols[9];   /* digits placed in each column */
+        uint16_t boxes[9];  /* digits placed in each submap */
+        int empty;          /* number of empty cells */
+} Grid;
+
+static int search(Grid *grid);
+static int propagate(Grid *grid, int *branch);
+static int hidden_singles(Grid *grid, int *placed);
+static int place(Grid *grid, int cell, int digit);
+static uint16_t candidates(const Grid *grid, int cell);
+static uint16_t *unit_mask(Grid *grid, int unit);
+static int unit_cell(int unit, int k);
+static int box_of(int cell);
+
+/* int solve_board(UArray2_T board)
+ * Parameters: UArray2_T board - 9x9 array of ints, 0 for an empty cell
+ * Returns: 1 if the puzzle has a solution, which is written into board,
+ *          or 0 (leaving board alone) if its givens break the rules, a cell
+ *          is outside 0-9, or no way of filling it in works
+ * Does: Solves the puzzle by propagation and backtracking. If the puzzle
+ *       has more than one solution, the first one found is used
+ */
+int solve_board(UArray2_T board)
+{
+        assert(UArray2_width(board) == 9 && UArray2_height(board) == 9);
+        assert(UArray2_size(board) == sizeof(int));
+        Grid grid = { { 0 }, { 0 }, { 0 }, { 0 }, 81 };
+        for (int row = 0; row < 9; row++) {
+                const int *cells = UArray2_row(board, row);
+                for (int col = 0; col < 9; col++) {
+                        int val = cells[col];
+                        if (val < 0 || val > 9) {
+                                return 0;
+                        }
+                        if (val != 0 && !place(&grid, 9 * row + col, val)) {
+                                return 0;
+                        }
+                }
+        }
+        if (!search(&grid)) {
+                return 0;
+        }
+        for (int row = 0; row < 9; row++) {
+                int *cells = UArray2_row(board, row);
+                for (int col = 0; col < 9; col++) {
+                        cells[col] = grid.cells[9 * row + col];
+                }
+        }
+        return 1;
+}
+
+/* static int search(Grid *grid)
+ * Returns: 1 with grid solved, or 0 if it has no solution
+ * Does: Propagates, then tries each candidate of the most constrained
+ *       empty cell on a copy of the grid
+ */
+static int search(Grid *grid)
+{
+        int branch;
+        if (!propagate(grid, &branch)) {
+                return 0;
+        }
+        if (grid->empty == 0) {
+                return 1;
+        }
+        uint16_t cands = candidates(grid, branch);
+        while (cands != 0) {
+                int digit = __builtin_ctz(cands);
+                cands &= cands - 1;
+                Grid guess = *grid;
+                if (place(&guess, branch, digit) && search(&guess)) {
+                        *grid = guess;
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+/* static int propagate(Grid *grid, int *branch)
+ * Parameters: Grid *grid - the grid, filled in as far as logic allows
+ *             int *branch - set to the empty cell with fewest candidates
+ * Returns: 0 if the grid was found to have no solution, else 1
+ * Does: Places naked singles until there are none, then hidden singles,
+ *       and starts over whenever anything was placed
+ */
+static int propagate(Grid *grid, int *branch)
+{
+        for (;;) {
+                int placed = 0;
+                int fewest = 10;
+                *branch = -1;
+                for (int cell = 0; cell < 81; cell++) {
+                        if (grid->cells[cell] != 0) {
+                                continue;
+                        }
+                        uint16_t cands = candidates(grid, cell);
+                        int count = __builtin_popcount(cands);
+                        if (count == 0) {
+                                return 0;
+                        } else if (count == 1) {
+                                place(grid, cell, __builtin_ctz(cands));
+                                placed = 1;
+                        } else if (count < fewest) {
+                                fewest = count;
+                                *branch = cell;
+                        }
+                }
+                if (grid->empty == 0) {
+                        return 1;
+                }
+                if (!placed && !hidden_singles(grid, &placed)) {
+                        return 0;
+                }
+                if (!placed) {
+                        return 1;
+                }
+        }
+}
+
+/* static int hidden_singles(Grid *grid, int *placed)
+ * Parameters: Grid *grid - the grid
+ *             int *placed - set to 1 if any digit was placed
+ * Returns: 0 if some unit has a missing digit that fits in none of its
+ *          empty cells, else 1
+ * Does: For every row, column and submap, finds the digits that are a
+ *       candidate of exactly one empty cell (once & ~twice over the cells'
+ *       candidate masks) and places each in that cell
+ */
+static int hidden_singles(Grid *grid, int *placed)
+{
+        for (int unit = 0; unit < 27; unit++) {
+                uint16_t once = 0;
+                uint16_t twice = 0;
+                for (int k = 0; k < 9; k++) {
+                        int cell = unit_cell(unit, k);
+                        if (grid->cells[cell] == 0) {
+                                uint16_t cands = candidates(grid, cell);
+                                twice |= once & cands;
+                                once |= cands;
+                        }
+                }
+                if ((once | *unit_mask(grid, unit)) != ALL_DIGITS) {
+                        return 0;
+                }
+                uint16_t singles = once & ~twice;
+                while (singles != 0) {
+                        int digit = __builtin_ctz(singles);
+                        singles &= singles - 1;
+                        int k = 0;
+                        while (k < 9 &&
+                               (grid->cells[unit_cell(unit, k)] != 0 ||
+                                !(candidates(grid, unit_cell(unit, k)) &
+                                  (1u << digit)))) {
+                                k++;
+                        }
+                        /* an earlier single in this unit took its cell */
+                        if (k == 9 ||
+                            !place(grid, unit_cell(unit, k), digit)) {
+                                return 0;
+                        }
+                        *placed = 1;
+                }
+        }
+        return 1;
+}
+
+/* static int place(Grid *grid, int cell, int digit)
+ * Returns: 1 after writing digit into the empty cell, or 0 (changing
+ *          nothing) if its row, column or submap already holds digit
+ */
+static int place(Grid *grid, int cell, int digit)
+{
+        uint16_t bit = (uint16_t)(1u << digit);
+        int row = cell / 9;
+        int col = cell % 9;
+        int box = box_of(cell);
+        if ((grid->rows[row] | grid->cols[col] | grid->boxes[box]) & bit) {
+                return 0;
+        }
+        grid->rows[row] |= bit;
+        grid->cols[col] |= bit;
+        grid->boxes[box] |= bit;
+        grid->cells[cell] = digit;
+        grid->empty--;
+        return 1;
+}
+
+/* static uint16_t candidates(const Grid *grid, int cell)
+ * Returns: the mask of digits not yet in the cell's row, column or submap
+ */
+static uint16_t candidates(const Grid *grid, int cell)
+{
+        return ~(grid->rows[cell / 9] | grid->cols[cell % 9] |
+                 grid->boxes[box_of(cell)]) & ALL_DIGITS;
+}
+
+/* static uint16_t *unit_mask(Grid *grid, int unit)
+ * Returns: the placed digit mask of unit 0-8 (rows), 9-17 (columns) or
+ *          18-26 (submaps)
+ */
+static uint16_t *unit_mask(Grid *grid, int unit)
+{
+        if (unit < 9) {
+                return &grid->rows[unit];
+        } else if (unit < 18) {
+                return &grid->cols[unit - 9];
+        }
+        return &grid->boxes[unit - 18];
+}
+
+/* static int unit_cell(int unit, int k)
+ * Returns: the index of the kth cell of the unit, numbered as in unit_mask
+ */
+static int unit_cell(int unit, int k)
+{
+        if (unit < 9) {
+                return 9 * unit + k;
+        } else if (unit < 18) {
+                return 9 * k + (unit - 9);
+        }
+        int box = unit - 18;
+        return 9 * ((box / 3) * 3 + k / 3) + (box % 3) * 3 + k % 3;
+}
+
+/* static int box_of(int cell)
+ * Returns: the submap, 0-8 in row major order, that the cell is in
+ */
+static int box_of(int cell)
+{
+        return (cell / 27) * 3 + (cell % 9) / 3;
+}
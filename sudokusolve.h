@@ -0,0 +1,15 @@
+/* sudokusolve.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for the sudoku solver, functions explained in implementation
+ */
+
+#include "uarray2.h"
+
+#ifndef SUDOKUSOLVE_INCLUDED
+#define SUDOKUSOLVE_INCLUDED
+
+extern int solve_board(UArray2_T board);
+
+#endif
@@ -8,12 +8,36 @@
  *          as a 1D array which uses the column and row number of the 2D
  *          array to set the index for each element in the 1D UArray
  *
+ *          A UArray2_view_T is a rectangle of an array passed by value;
+ *          the view functions add its origin to each index and use the
+ *          array's own elements, so a submap or a crop is never copied.
+ *
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <uarray2.h>
 #include "uarray.h"
 #include "assert.h"
+#include "workpool.h"
+#include "hugemem.h"
+
+/* tile side for UArray2_map_blocked: 32 rows of 32 elements */
+#define DEFAULT_BLOCK 32
+
+/* row blocks per pool thread in UArray2_map_parallel, enough for work
+   stealing to even out blocks of uneven cost */
+#define BLOCKS_PER_THREAD 8
+
+/* a UArray2_map_parallel call, shared by its blocks */
+typedef struct Map_job {
+        UArray2_T uarray2;
+        void (*apply)(int i, int j, UArray2_T a, void *p1, void *p2);
+        void *cl;
+        int rows; /* rows per block */
+} Map_job;
+
+static void map_row_block(int block, void *cl);
 
 
 /* UArray2_T UArray2_new(int width, int height, int size)
@@ -31,19 +55,151 @@
  */
 UArray2_T UArray2_new(int width, int height, int size)
 {
-        assert (width != 0); 
-        assert(height != 0);
-        assert(size != 0);
+        return UArray2_new_layout(width, height, size, UARRAY2_ROW_MAJOR);
+}
+
+/* UArray2_T UArray2_new_layout(int width, int height, int size, int layout)
+ * Parameters:
+ *          int width, int height, int size: as for UArray2_new
+ *          int layout: UARRAY2_ROW_MAJOR or UARRAY2_TILED, optionally
+ *                      or'd with UARRAY2_HUGE
+ * Returns: 
+ *          UArray2_T: the constructed array, stored in the given layout
+ * Does: 
+ *          Creates a two dimensional array like UArray2_new. In the tiled
+ *          layout the array is padded out to whole UARRAY2_TILE x
+ *          UARRAY2_TILE tiles, each stored contiguously from a cache line
+ *          boundary, so for ints the elements above and below (col, row)
+ *          are usually in the same line rather than a full row away. The
+ *          offsets of each row and column within the tiles are tabled,
+ *          which costs a size_t per row and per column. UArray2_at and the maps
+ *          work the same in both layouts; UArray2_row and UArray2_map_rows
+ *          need contiguous rows and are a checked runtime error on a tiled
+ *          array.
+ *          With UARRAY2_HUGE the elements are mapped by Hugemem_alloc
+ *          instead of coming from UArray_new: page aligned, so aligned
+ *          for any vector load, and on 2 MB pages once the array is that
+ *          big, which takes most of the TLB misses out of column major
+ *          maps and fills over large images. It is worth it from a few
+ *          MB up; a small array still takes at least a whole page
+ */
+UArray2_T UArray2_new_layout(int width, int height, int size, int layout)
+{
+        assert(width > 0); 
+        assert(height > 0);
+        assert(size > 0);
+        int huge = layout & UARRAY2_HUGE;
+        layout &= ~UARRAY2_HUGE;
+        assert(layout == UARRAY2_ROW_MAJOR || layout == UARRAY2_TILED);
         UArray2_T uarray2 = malloc(sizeof(*uarray2));
         assert(uarray2 != NULL);
-        uarray2->uarray = UArray_new(width * height, size);
-        uarray2->size = UArray2_size(uarray2);
+        int length = width * height;
+        int pad = 0;
+        uarray2->row_offsets = NULL;
+        uarray2->col_offsets = NULL;
+        if (layout == UARRAY2_TILED) {
+                const int mask = UARRAY2_TILE - 1;
+                int tiles_across = (width + mask) / UARRAY2_TILE;
+                int tiles_down = (height + mask) / UARRAY2_TILE;
+                size_t tile_row = (size_t)tiles_across * UARRAY2_TILE * 
+                                  UARRAY2_TILE;
+                length = tile_row * tiles_down;
+                /* room to slide the tiles up to a cache line boundary */
+                pad = (UARRAY2_LINE_BYTES + size - 1) / size;
+                uarray2->row_offsets = malloc(height * sizeof(size_t));
+                uarray2->col_offsets = malloc(width * sizeof(size_t));
+                assert(uarray2->row_offsets != NULL);
+                assert(uarray2->col_offsets != NULL);
+                for (int row = 0; row < height; row++) {
+                        uarray2->row_offsets[row] = 
+                                (tile_row * (row >> UARRAY2_TILE_SHIFT) +
+                                 ((row & mask) << UARRAY2_TILE_SHIFT)) * size;
+                }
+                for (int col = 0; col < width; col++) {
+                        uarray2->col_offsets[col] = 
+                                (((size_t)(col & ~mask) << UARRAY2_TILE_SHIFT) +
+                                 (col & mask)) * size;
+                }
+        }
+        uarray2->size = size;
+        uarray2->mapped = 0;
+        if (huge) {
+                /* already page aligned, so the tiles need no sliding */
+                uarray2->uarray = NULL;
+                uarray2->mapped = (size_t)length * size;
+                uarray2->elems = Hugemem_alloc(uarray2->mapped);
+        } else {
+                uarray2->uarray = UArray_new(length + pad, size);
+                uarray2->elems = UArray_at(uarray2->uarray, 0);
+        }
+        if (layout == UARRAY2_TILED && !huge) {
+                size_t skew = (uintptr_t)uarray2->elems % UARRAY2_LINE_BYTES;
+                if (skew != 0) {
+                        uarray2->elems += UARRAY2_LINE_BYTES - skew;
+                }
+        }
         uarray2->width = width;
         uarray2->height = height;
+        uarray2->layout = layout;
         return uarray2;
 
 }
 
+/* UArray2_T UArray2_new_arena(Arena_T arena, int width, int height,
+ *                             int size)
+ * Parameters:
+ *          Arena_T arena: the arena the array is allocated from
+ *          int width, int height, int size: as for UArray2_new
+ * Returns: 
+ *          UArray2_T: a row major array with every element 0
+ * Does: 
+ *          Creates an array like UArray2_new, but with the header and the
+ *          elements in one allocation from arena instead of a malloc for
+ *          the header and two for a UArray_T. The array lives until
+ *          Arena_free(arena) or Arena_dispose, which releases everything
+ *          allocated since the last reset in one step; UArray2_free does
+ *          nothing to it. Once Arena_free has put the arena's chunks back
+ *          on CII's free list, the next arrays of the same size are carved
+ *          out of them with no call to malloc. That free list is shared by
+ *          every arena and is not locked, so arenas must only be used from
+ *          one thread
+ */
+UArray2_T UArray2_new_arena(Arena_T arena, int width, int height, int size)
+{
+        assert(arena != NULL);
+        assert(width > 0); 
+        assert(height > 0);
+        assert(size > 0);
+        /* the elements start on a 16 byte boundary past the header */
+        long header = (sizeof(struct UArray2_T) + 15) & ~15L;
+        char *block = Arena_calloc(arena, 1, 
+                                   header + (long)width * height * size,
+                                   __FILE__, __LINE__);
+        UArray2_T uarray2 = (UArray2_T)block;
+        uarray2->height = height;
+        uarray2->width = width;
+        uarray2->size = size;
+        uarray2->uarray = NULL;
+        uarray2->elems = block + header;
+        uarray2->layout = UARRAY2_ROW_MAJOR;
+        uarray2->mapped = 0;
+        uarray2->row_offsets = NULL;
+        uarray2->col_offsets = NULL;
+        return uarray2;
+}
+
+/* int UArray2_layout(UArray2_T uarray2)
+ * Parameters: 
+ *        UArray2_T uarray2: the UArray2_T object being queried
+ * Returns: 
+ *        int: UARRAY2_ROW_MAJOR or UARRAY2_TILED
+ */
+int UArray2_layout(UArray2_T uarray2)
+{
+        assert(uarray2 != NULL);
+        return uarray2->layout;
+}
+
 
 /* int UArray2_height(UArray2_T uarray)
  * Parameters: 
@@ -91,7 +247,7 @@ int UArray2_width(UArray2_T uarray)
 int UArray2_size(UArray2_T uarray2)
 {
         assert(uarray2 != NULL);
-        return UArray_size(uarray2->uarray);
+        return uarray2->size;
 }
 
 /* void UArray2_free(UArray2_T *uarray2)
@@ -100,13 +256,21 @@ int UArray2_size(UArray2_T uarray2)
  * Returns:
  *            Nothing
  * Does:
- *            frees memory
+ *            frees memory, except for an array from UArray2_new_arena,
+ *            whose memory belongs to its arena
  */
 void UArray2_free(UArray2_T *uarray2)
 {
-        assert(uarray2 != NULL);
-        UArray_T *uarray = &((*uarray2)->uarray);
-        UArray_free(uarray);
+        assert(uarray2 != NULL && *uarray2 != NULL);
+        if ((*uarray2)->mapped != 0) {
+                Hugemem_free((*uarray2)->elems, (*uarray2)->mapped);
+        } else if ((*uarray2)->uarray == NULL) {
+                return;
+        } else {
+                UArray_free(&(*uarray2)->uarray);
+        }
+        free((*uarray2)->row_offsets);
+        free((*uarray2)->col_offsets);
         free(*uarray2);
 }
 
@@ -125,10 +289,30 @@ void UArray2_free(UArray2_T *uarray2)
  */
 void *UArray2_at(UArray2_T uarray2, int col, int row)
 {
-        assert(row >= 0 && row <= uarray2->height);
-        assert(col >= 0 && col <= uarray2->width);
-        int i = (UArray2_width(uarray2) * row) + col;
-        return UArray_at(uarray2->uarray, i);
+        assert(uarray2 != NULL);
+        assert(row >= 0 && row < uarray2->height);
+        assert(col >= 0 && col < uarray2->width);
+        return UArray2_at_unchecked(uarray2, col, row);
+}
+
+/* void *UArray2_row(UArray2_T uarray2, int row)
+ * Parameters: 
+ *             UArray2_T uarray2: the UArray2_T object being indexed
+ *             int row: row index, as integer
+ * Returns: 
+ *             void *: pointer to element (0, row); the width elements of
+ *             the row follow it with no gaps, so it can be used as a plain
+ *             C array of the element type
+ * Does: 
+ *             Gives the caller a whole row to loop over directly. The
+ *             array must be in the row major layout
+ */
+void *UArray2_row(UArray2_T uarray2, int row)
+{
+        assert(uarray2 != NULL);
+        assert(uarray2->layout == UARRAY2_ROW_MAJOR);
+        assert(row >= 0 && row < uarray2->height);
+        return uarray2->elems + (size_t)uarray2->width * row * uarray2->size;
 }
 
 /* void UArray2_map_col_major(UArray2_T uarray, 
@@ -160,7 +344,8 @@ void UArray2_map_col_major(UArray2_T uarray, void apply(int i, int j,
         assert(uarray != NULL);
         for (int i = 0; i < uarray->width; i++){
                 for (int j = 0; j < uarray->height; j++){
-                        apply(i, j, uarray, UArray2_at(uarray, i, j), cl);
+                        apply(i, j, uarray, 
+                              UArray2_at_unchecked(uarray, i, j), cl);
                 }
         } 
 }
@@ -195,7 +380,310 @@ void UArray2_map_row_major(UArray2_T uarray, void apply(int i, int j,
         assert(uarray->height != 0 && uarray->width != 0);
         for (int i = 0; i < uarray->height; i++){
                 for (int j = 0; j < uarray->width; j++){
-                        apply(j, i, uarray, UArray2_at(uarray, j, i), cl);
+                        apply(j, i, uarray, 
+                              UArray2_at_unchecked(uarray, j, i), cl);
                 }
         } 
 }
+
+/* void UArray2_map_blocked(UArray2_T uarray2, int block,
+ *                          void apply(int i, int j, UArray2_T a, void *p1,
+ *                                     void *p2), void *cl)
+ * Parameters: 
+ *             UArray2_T uarray2: the UArray2_T object being mapped
+ *             int block: side of the square blocks, or 0 for the default
+ *             int i, int j: column and row passed to apply
+ *             UArray2_T a: uarray2, passed to apply
+ *             void *p1: the element at (i, j)
+ *             void *p2: cl, passed to apply
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Calls apply on every element, a block x block tile at a
+ *             time. The tiles are taken down each column of tiles in turn
+ *             and each tile is walked in column major order, so every
+ *             column is still visited top to bottom and every row left to
+ *             right, but the columns are interleaved. A caller that only
+ *             needs that, rather than one whole column after another,
+ *             reuses each cache line and page block times per tile instead
+ *             of jumping a full row on every step as
+ *             UArray2_map_col_major does
+ */
+void UArray2_map_blocked(UArray2_T uarray2, int block, 
+                         void apply(int i, int j, UArray2_T a, void *p1,
+                                    void *p2), 
+                         void *cl)
+{
+        assert(uarray2 != NULL);
+        assert(block >= 0);
+        if (block == 0) {
+                block = DEFAULT_BLOCK;
+        }
+        int width = uarray2->width;
+        int height = uarray2->height;
+        for (int col0 = 0; col0 < width; col0 += block) {
+                int col1 = width - col0 < block ? width : col0 + block;
+                for (int row0 = 0; row0 < height; row0 += block) {
+                        int row1 = height - row0 < block ? height 
+                                                         : row0 + block;
+                        for (int i = col0; i < col1; i++) {
+                                for (int j = row0; j < row1; j++) {
+                                        apply(i, j, uarray2, 
+                                              UArray2_at_unchecked(uarray2,
+                                                                   i, j),
+                                              cl);
+                                }
+                        }
+                }
+        }
+}
+
+/* void UArray2_map_parallel(UArray2_T uarray2,
+ *                           void apply(int i, int j, UArray2_T a, void *p1,
+ *                                      void *p2), void *cl)
+ * Parameters: 
+ *             UArray2_T uarray2: the UArray2_T object being mapped
+ *             int i, int j: column and row passed to apply
+ *             UArray2_T a: uarray2, passed to apply
+ *             void *p1: the element at (i, j)
+ *             void *p2: cl, passed to apply
+ * Returns: 
+ *             Nothing, once apply has been called on every element
+ * Does: 
+ *             Calls apply on every element, using every thread of the
+ *             workpool. The rows are cut into blocks of whole rows that
+ *             the threads share out, stealing from each other when their
+ *             own run out. Each block is walked in row major order, but
+ *             THE CALLS MAY RUN IN ANY ORDER AND AT THE SAME TIME: apply
+ *             may read anything that no call writes, and write its own
+ *             element or data no other call touches, but must not depend
+ *             on the order, share a cl it writes without locking, or raise
+ *             an exception
+ */
+void UArray2_map_parallel(UArray2_T uarray2, void apply(int i, int j, 
+                                                        UArray2_T a, 
+                                                        void *p1, void *p2),
+                          void *cl)
+{
+        assert(uarray2 != NULL);
+        int nthreads = Workpool_start(0);
+        Map_job job = { uarray2, apply, cl, 
+                        uarray2->height / (nthreads * BLOCKS_PER_THREAD) };
+        if (job.rows == 0) {
+                job.rows = 1;
+        }
+        Workpool_run((uarray2->height + job.rows - 1) / job.rows, 
+                     map_row_block, &job);
+}
+
+/* static void map_row_block(int block, void *cl)
+ * Does: calls the Map_job cl's apply on each element of its block'th
+ *       block of rows, in row major order
+ */
+static void map_row_block(int block, void *cl)
+{
+        Map_job *job = cl;
+        UArray2_T uarray2 = job->uarray2;
+        int first = block * job->rows;
+        int end = (uarray2->height - first < job->rows) ? uarray2->height 
+                                                         : first + job->rows;
+        for (int j = first; j < end; j++) {
+                for (int i = 0; i < uarray2->width; i++) {
+                        job->apply(i, j, uarray2, 
+                                   UArray2_at_unchecked(uarray2, i, j), 
+                                   job->cl);
+                }
+        }
+}
+
+/* void UArray2_map_rows(UArray2_T uarray2,
+ *                       void apply(int row, UArray2_T a, void *elems,
+ *                                  int length, void *cl), void *cl)
+ * Parameters: 
+ *             UArray2_T uarray2: the UArray2_T object being mapped
+ *             int row: row index passed to apply
+ *             UArray2_T a: uarray2, passed to apply
+ *             void *elems: the row, as returned by UArray2_row
+ *             int length: number of elements in the row (the width)
+ *             void *cl: closure passed to apply
+ * Returns: 
+ *             Nothing
+ * Does: 
+ *             Calls apply once per row, top to bottom. Unlike
+ *             UArray2_map_row_major there is no call per element, so the
+ *             loop over a row lives in apply where the compiler can
+ *             unroll and vectorize it. The array must be in the row
+ *             major layout
+ */
+void UArray2_map_rows(UArray2_T uarray2, void apply(int row, UArray2_T a,
+                                                    void *elems, int length,
+                                                    void *cl),
+                      void *cl)
+{
+        assert(uarray2 != NULL);
+        assert(uarray2->layout == UARRAY2_ROW_MAJOR);
+        size_t stride = (size_t)uarray2->width * uarray2->size;
+        for (int row = 0; row < uarray2->height; row++) {
+                apply(row, uarray2, uarray2->elems + stride * row,
+                      uarray2->width, cl);
+        }
+}
+
+/* UArray2_view_T UArray2_view(UArray2_T uarray2, int col, int row,
+ *                             int width, int height)
+ * Parameters:
+ *             UArray2_T uarray2: the array to look into
+ *             int col, int row: the array index of the view's (0, 0)
+ *             int width, int height: size of the view, both above 0
+ * Returns:
+ *             UArray2_view_T: the view, which must lie inside uarray2
+ * Does:
+ *             Makes a window onto part of uarray2 without copying or
+ *             allocating anything; a crop or a sudoku submap is a view
+ *             rather than a new array. A window that does not fit is a
+ *             checked runtime error
+ */
+UArray2_view_T UArray2_view(UArray2_T uarray2, int col, int row, int width,
+                            int height)
+{
+        assert(uarray2 != NULL);
+        assert(width > 0 && height > 0);
+        assert(0 <= col && col <= uarray2->width - width);
+        assert(0 <= row && row <= uarray2->height - height);
+        UArray2_view_T view = { uarray2, col, row, width, height };
+        return view;
+}
+
+/* UArray2_view_T UArray2_view_sub(UArray2_view_T view, int col, int row,
+ *                                 int width, int height)
+ * Parameters:
+ *             UArray2_view_T view: the view to look into
+ *             int col, int row, int width, int height: the window, in the
+ *             view's own indices, as for UArray2_view
+ * Returns:
+ *             UArray2_view_T: a view of the same array, which must lie
+ *             inside view
+ */
+UArray2_view_T UArray2_view_sub(UArray2_view_T view, int col, int row,
+                                int width, int height)
+{
+        assert(width > 0 && height > 0);
+        assert(0 <= col && col <= view.width - width);
+        assert(0 <= row && row <= view.height - height);
+        return UArray2_view(view.array, view.col + col, view.row + row,
+                            width, height);
+}
+
+/* int UArray2_tile_count(UArray2_T uarray2, int tile_width,
+ *                        int tile_height)
+ * Returns: the number of tile_width x tile_height tiles it takes to
+ *          cover uarray2, counting the part tiles on its right and bottom
+ *          edges
+ */
+int UArray2_tile_count(UArray2_T uarray2, int tile_width, int tile_height)
+{
+        assert(uarray2 != NULL);
+        assert(tile_width > 0 && tile_height > 0);
+        return ((uarray2->width + tile_width - 1) / tile_width) *
+               ((uarray2->height + tile_height - 1) / tile_height);
+}
+
+/* UArray2_view_T UArray2_tile(UArray2_T uarray2, int tile_width,
+ *                             int tile_height, int index)
+ * Parameters:
+ *             UArray2_T uarray2: the array being tiled
+ *             int tile_width, int tile_height: size of a whole tile
+ *             int index: which tile, from 0 to UArray2_tile_count - 1,
+ *                        numbered across each row of tiles in turn
+ * Returns:
+ *             UArray2_view_T: a view of the tile, cut short on the right
+ *             and bottom edges of the array
+ * Does:
+ *             Lets a loop or a Workpool_run job go tile by tile with a
+ *             view per tile: the block number of Workpool_run is the
+ *             index, and nothing is allocated per tile
+ */
+UArray2_view_T UArray2_tile(UArray2_T uarray2, int tile_width,
+                            int tile_height, int index)
+{
+        assert(0 <= index && index < UArray2_tile_count(uarray2, tile_width,
+                                                        tile_height));
+        int across = (uarray2->width + tile_width - 1) / tile_width;
+        int col = index % across * tile_width;
+        int row = index / across * tile_height;
+        int width = uarray2->width - col;
+        int height = uarray2->height - row;
+        return UArray2_view(uarray2, col, row,
+                            width < tile_width ? width : tile_width,
+                            height < tile_height ? height : tile_height);
+}
+
+/* void *UArray2_view_at(UArray2_view_T view, int col, int row)
+ * Parameters:
+ *             UArray2_view_T view: the view being indexed
+ *             int col, int row: index in the view
+ * Returns:
+ *             void *: pointer to the array's element under (col, row) of
+ *             the view; an index outside the view is a checked runtime
+ *             error
+ */
+void *UArray2_view_at(UArray2_view_T view, int col, int row)
+{
+        assert(0 <= col && col < view.width);
+        assert(0 <= row && row < view.height);
+        return UArray2_at_unchecked(view.array, view.col + col,
+                                    view.row + row);
+}
+
+/* void UArray2_view_map_row_major(UArray2_view_T view,
+ *          void apply(int i, int j, UArray2_view_T *v, void *p1, void *p2),
+ *          void *cl)
+ * Parameters:
+ *             UArray2_view_T view: the view being mapped
+ *             int i, int j: column and row in the view, passed to apply
+ *             UArray2_view_T *v: the view, passed to apply
+ *             void *p1: the element under (i, j)
+ *             void *p2: cl, passed to apply
+ * Returns:
+ *             Nothing
+ * Does:
+ *             Calls apply on every element of the view, row by row, as
+ *             UArray2_map_row_major does for a whole array
+ */
+void UArray2_view_map_row_major(UArray2_view_T view,
+                                void apply(int i, int j, UArray2_view_T *v,
+                                           void *p1, void *p2),
+                                void *cl)
+{
+        assert(view.array != NULL);
+        for (int j = 0; j < view.height; j++) {
+                for (int i = 0; i < view.width; i++) {
+                        apply(i, j, &view, 
+                              UArray2_at_unchecked(view.array, view.col + i,
+                                                   view.row + j),
+                              cl);
+                }
+        }
+}
+
+/* void UArray2_view_map_col_major(UArray2_view_T view,
+ *          void apply(int i, int j, UArray2_view_T *v, void *p1, void *p2),
+ *          void *cl)
+ * Does: Calls apply on every element of the view, column by column, with
+ *       the same arguments as UArray2_view_map_row_major
+ */
+void UArray2_view_map_col_major(UArray2_view_T view,
+                                void apply(int i, int j, UArray2_view_T *v,
+                                           void *p1, void *p2),
+                                void *cl)
+{
+        assert(view.array != NULL);
+        for (int i = 0; i < view.width; i++) {
+                for (int j = 0; j < view.height; j++) {
+                        apply(i, j, &view, 
+                              UArray2_at_unchecked(view.array, view.col + i,
+                                                   view.row + j),
+                              cl);
+                }
+        }
+}
@@ -5,25 +5,71 @@
  * uarray2.h
  * Interface for uarray2, functions explained in implementation
  */
+#include <stddef.h>
 #include <uarray.h>
+#include <arena.h>
 
 #ifndef UARRAY2_INCLUDED
 #define UARRAY2_INCLUDED
 
+#ifdef ARRAY2_CHECKED
+#include "assert.h"
+#endif
+
+/* storage layouts for UArray2_new_layout. UARRAY2_ROW_MAJOR keeps each
+   row contiguous; UARRAY2_TILED stores 4 x 4 tiles, row major inside each
+   tile and tile by tile, starting on a cache line boundary, so a tile of
+   ints is one cache line and most vertical neighbors share it */
+enum { UARRAY2_ROW_MAJOR = 0, UARRAY2_TILED = 1 };
+/* creation flag, or'd into the layout: the elements are mapped from the
+   kernel page aligned and, for arrays of 2 MB or more, on transparent
+   huge pages (see hugemem.c) */
+#define UARRAY2_HUGE 0x100
+#define UARRAY2_TILE_SHIFT 2
+#define UARRAY2_TILE (1 << UARRAY2_TILE_SHIFT)
+#define UARRAY2_LINE_BYTES 64
+
 #define T UArray2_T
 typedef struct T{
   int height; /* height of 2D UArray */
   int width; /* width of 2D UArray */
   int size; /* size of element */
-  UArray_T uarray; /* 1D UArray */
+  UArray_T uarray; /* 1D UArray, or NULL if the array was made by
+                      UArray2_new_arena and lives in its arena or was
+                      made with UARRAY2_HUGE */
+  char *elems; /* element 0 of uarray; in the row major layout, (0, 0)
+                  then row after row with no gaps */
+  int layout; /* UARRAY2_ROW_MAJOR or UARRAY2_TILED */
+  size_t mapped; /* bytes in elems if it came from Hugemem_alloc (the
+                    UARRAY2_HUGE flag), else 0 */
+  size_t *row_offsets; /* byte offset of (0, row) from elems, tiled
+                          layout only (NULL in the row major layout) */
+  size_t *col_offsets; /* byte offset of (col, 0) from elems, likewise */
 } *T;
 
+/* a window of width x height elements of an array, whose (0, 0) is the
+   array's (col, row). A view is a plain value: making one allocates
+   nothing, it is copied like an int, and it reads and writes the array's
+   own elements (in either layout), so it is only good while the array
+   lives */
+typedef struct UArray2_view_T {
+  T array; /* the array viewed */
+  int col; /* column of the array at the view's column 0 */
+  int row; /* row of the array at the view's row 0 */
+  int width; /* width of the view */
+  int height; /* height of the view */
+} UArray2_view_T;
+
 T UArray2_new(int width, int height, int size);
+T UArray2_new_layout(int width, int height, int size, int layout);
+T UArray2_new_arena(Arena_T arena, int width, int height, int size);
+int UArray2_layout(T uarray2);
 void UArray2_free(T *uarray2);
 int UArray2_height(T uarray);
 int UArray2_width(T uarray);
 int UArray2_size(T uarray2);
 void *UArray2_at(T uarray2, int col, int row);
+void *UArray2_row(T uarray2, int row);
 void UArray2_map_col_major(T uarray, void apply(int i, int j, T a,
                                                              void *p1, 
                                                              void *p2),
@@ -32,6 +78,52 @@ void UArray2_map_row_major(T uarray, void apply(int i, int j, T a,
                                                              void *p1,
                                                              void *p2),
                                   void *cl);
+void UArray2_map_blocked(T uarray2, int block, void apply(int i, int j, T a,
+                                                         void *p1, 
+                                                         void *p2),
+                         void *cl);
+void UArray2_map_rows(T uarray2, void apply(int row, T a, void *elems,
+                                            int length, void *cl),
+                      void *cl);
+void UArray2_map_parallel(T uarray2, void apply(int i, int j, T a, void *p1,
+                                                void *p2),
+                          void *cl);
+UArray2_view_T UArray2_view(T uarray2, int col, int row, int width,
+                            int height);
+UArray2_view_T UArray2_view_sub(UArray2_view_T view, int col, int row,
+                                int width, int height);
+int UArray2_tile_count(T uarray2, int tile_width, int tile_height);
+UArray2_view_T UArray2_tile(T uarray2, int tile_width, int tile_height,
+                            int index);
+void *UArray2_view_at(UArray2_view_T view, int col, int row);
+void UArray2_view_map_row_major(UArray2_view_T view,
+                                void apply(int i, int j, UArray2_view_T *v,
+                                           void *p1, void *p2),
+                                void *cl);
+void UArray2_view_map_col_major(UArray2_view_T view,
+                                void apply(int i, int j, UArray2_view_T *v,
+                                           void *p1, void *p2),
+                                void *cl);
+
+/* Inline UArray2_at for hot loops: one multiply-add, or two table lookups
+   for the tiled layout (fewer instructions than working out the tile,
+   which lets more cache misses be in flight at once), no call and no
+   bounds checks, so an index out of range is undefined. Building with
+   -DARRAY2_CHECKED (make CHECKED=1) puts the checks back */
+static inline void *UArray2_at_unchecked(T uarray2, int col, int row)
+{
+#ifdef ARRAY2_CHECKED
+        assert(uarray2 != NULL);
+        assert(0 <= col && col < uarray2->width);
+        assert(0 <= row && row < uarray2->height);
+#endif
+        if (uarray2->layout == UARRAY2_TILED) {
+                return uarray2->elems + uarray2->row_offsets[row] +
+                       uarray2->col_offsets[col];
+        }
+        return uarray2->elems +
+               ((size_t)uarray2->width * row + col) * uarray2->size;
+}
 
 #undef T
 #endif
@@ -7,348 +7,300 @@
  *       and removes all blackedges from the pbm file and prints the unedged
  *       image to terminal following the format specifications of a plain
  *       pbm file 
+ *
+ * Usage: unblackedges [-e engine] [-t threads] [-o plain|raw] [-s]
+ *                     [file.pbm]
+ *        engine is one of the names in the engines table below, and
+ *        defaults to the first entry. -t sets the thread count of the 
+ *        parallel engine (default one per processor). -o raw prints a raw 
+ *        (P4) pbm, which is about 16x smaller than the default plain output.
+ *        -s streams the image through in two passes instead of loading it,
+ *        for images larger than memory; the input must then be a file (or
+ *        stdin redirected from one), since it is read twice
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
-#include "pnmrdr.h"
 #include <except.h>
 #include "bit2.h"
-#include "seq.h"
+#include "blackedges.h"
+#include "paredges.h"
+#include "streamedges.h"
+#include "pnmread.h"
+#include "pbm.h"
 
-const int BLACK_PIXEL = 1;
-const int WHITE_PIXEL = 0;
+/* A named black edge removal engine that can be picked with -e */
+typedef struct Engine {
+        const char *name;
+        void (*remove)(Bit2_T img_map);
+} Engine;
 
-typedef struct Index {
-        int col;
-        int row;
-} Index;
+void remove_parallel(Bit2_T img_map);
 
-Bit2_T open_file(FILE *fp, Bit2_T img_map, int argc, char *argv[]);
+static const Engine engines[] = {
+        { "scanline", remove_black_edges_scanline },
+        { "bfs",      remove_black_edges },
+        { "parallel", remove_parallel },
+        { "dilate",   remove_black_edges_dilate },
+        { "label",    remove_black_edges_label },
+};
+static const int NUM_ENGINES = sizeof(engines) / sizeof(engines[0]);
+
+/* thread count for the parallel engine, 0 for one per processor */
+static int num_threads = 0;
+
+typedef struct Options {
+        char *filename; /* NULL when reading the pbm from stdin */
+        const Engine *engine;
+        int raw_output; /* 1 to print a raw (P4) pbm instead of plain */
+        int stream; /* 1 to stream the image instead of loading it */
+} Options;
+
+Options parse_arguments(int argc, char *argv[]);
+const Engine *find_engine(const char *name);
+void stream_file(char *filename, int raw);
+Bit2_T open_file(FILE *fp, Bit2_T img_map, char *filename);
 Bit2_T set_bit_array(FILE *fp, Bit2_T img_map);
-void remove_black_edges(Bit2_T img_map);
-void check_border(Bit2_T img_map, Seq_T seq);
-int is_black_edge(Bit2_T img_map, int col, int row);
-Index *new_index(int col, int row);
-void find_edges(Bit2_T img_map,Seq_T seq);
-void find_next_edge(Bit2_T img_map, Seq_T seq, int col, int row);
-void print_as_pbm(Bit2_T img_map);
-void print_bit(int col, int row, Bit2_T img_map, int bit, void *cl);
+Bit2_T read_raster(Pnmread_T rdr, FILE *fp);
+void print_as_pbm(Bit2_T img_map, int raw);
 void error(char* msg, Bit2_T img_map, FILE *fp);
 
 int main(int argc, char *argv[]) 
 {
         FILE *fp = NULL;
         Bit2_T img_map = NULL;
+        Options options = parse_arguments(argc, argv);
+        if (options.stream) {
+                stream_file(options.filename, options.raw_output);
+                return EXIT_SUCCESS;
+        }
 
         /* opens file from stdin or command line argument */
-        img_map = open_file(fp, img_map, argc, argv);
+        img_map = open_file(fp, img_map, options.filename);
         
-        /* Removed blackedges from img_map and store new bitmap as new_map */
-        remove_black_edges(img_map); 
+        /* Removed blackedges from img_map with the selected engine */
+        options.engine->remove(img_map); 
 
-        /* Prints as a plain pbm to terminal */
-        print_as_pbm(img_map);
+        /* Prints as a plain (or with -o raw, a raw) pbm to terminal */
+        print_as_pbm(img_map, options.raw_output);
 
         /* Freeing memory for img_map and maps */
         Bit2_free(&img_map);
         return EXIT_SUCCESS;
 }
 
-/* Bit2_T open_file(FILE *fp, Bit2_T img_map, int argc, char *argv[])
- * Parameters: [FILE *fp] - file pointer that will be initialized
- *             [Bit2_T img_map] - the bitmap to be initialized by the 
- *                               set_bit_array function
- *             [int argc] - integer representing the argument
+/* Options parse_arguments(int argc, char *argv[])
+ * Parameters: [int argc] - integer representing the argument count
  *             [char *argv[]] - passed command line arguments
- *    Returns: Bit2_T, initialized bitmap from passed pbm file 
- *       Does: Initializes the map with the passed pbm from either the command
- *             line or stdin
+ *    Returns: Options, the input file name (NULL for stdin), the engine
+ *             and the output format
+ *       Does: Reads the optional -e engine, -t threads, -o format and -s
+ *             flags and at most one file name, exiting with an error on
+ *             anything else
  */
-Bit2_T open_file(FILE *fp, Bit2_T img_map, int argc, char *argv[]) 
+Options parse_arguments(int argc, char *argv[])
 {
-        if (argc > 2) {
-                error("Error: invalid command line arguments\n", NULL, NULL);
-        } else {
-                if (argc == 2) { /* pbm file passed as command line argument */
-                        fp = fopen(argv[1], "rb");
-                        if (fp == NULL) {
-                                error("Error: unable to open file\n", 
-                                      NULL, NULL);
+        Options options = { NULL, &engines[0], 0, 0 };
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+                        options.engine = find_engine(argv[++i]);
+                } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+                        num_threads = atoi(argv[++i]);
+                        if (num_threads <= 0) {
+                                error("Error: thread count must be positive"
+                                      "\n", NULL, NULL);
                         }
-                        /* Initializes img_map to bitMap inside passed file */
-                        img_map = set_bit_array(fp, img_map);
-                } else { /* pbm file collected from stdin */
-                        fp = stdin;
-                        if (fp == NULL) {
-                                error("Error: unable to open file\n",
+                } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+                        i++;
+                        if (strcmp(argv[i], "raw") == 0) {
+                                options.raw_output = 1;
+                        } else if (strcmp(argv[i], "plain") == 0) {
+                                options.raw_output = 0;
+                        } else {
+                                error("Error: output must be plain or raw\n",
                                       NULL, NULL);
-                        }       
-                        /* Initializes img_map to bitMap inside stdin file */
-                        img_map = set_bit_array(fp, img_map);
+                        }
+                } else if (strcmp(argv[i], "-s") == 0) {
+                        options.stream = 1;
+                } else if (argv[i][0] == '-' || options.filename != NULL) {
+                        error("Error: invalid command line arguments\n", 
+                              NULL, NULL);
+                } else {
+                        options.filename = argv[i];
                 }
         }
-        if (img_map == NULL) { /* Check for error with bitmap creation */
-                error("Error: cannot create bitmap imgMap\n", NULL, fp);
-        }
-        return img_map;
+        return options;
 }
 
-/* Bit2_T set_bit_array(FILE *fp,  Bit2_T img_map)            
- * Parameters: [FILE *fp] - pointer to the file the reader will be initialized
- *                          to
- *             [Bit2_T img_map] - the bitmap that will be initialized with the
- *                               pbm inside the file 
- *    Returns: Bit2_T, the initialized bitmap from the passed file parameter
- *       Does: Initializes the passed img_map with the bit contents of the pbm 
- *             file
+/* const Engine *find_engine(const char *name)
+ * Parameters: [const char *name] - engine name given on the command line
+ *    Returns: pointer to the engines table entry called name
+ *       Does: Looks up an engine by name, exiting with an error if there is
+ *             no such engine
  */
-Bit2_T set_bit_array(FILE *fp,  Bit2_T img_map)
+const Engine *find_engine(const char *name)
 {
-        Pnmrdr_mapdata data;
-        Pnmrdr_T rdr;
-
-        /* Initialize reader */
-        TRY;
-                rdr = Pnmrdr_new(fp);
-        /* Handles error if reader is badformated */
-        EXCEPT(Pnmrdr_Badformat);
-                error("Error: bad format, could not read image\n", img_map, 
-                      fp);
-        /* Handles error if bit count from reader is inconsistent */  
-        EXCEPT(Pnmrdr_Count);
-                error("Error: bad format, could not read bit pixels\n", 
-                      img_map, fp);
-        END_TRY;
-        
-        /* Get pbm width and height */
-        data = Pnmrdr_data(rdr);        
-        if (data.width == 0 || data.height == 0 || data.type != Pnmrdr_bit) {
-                Pnmrdr_free(&rdr);
-                error("Error: image not valid dimensions or type (requires PBM"
-                      "file)\n", img_map, fp);
-        }
-        /* Initialize a new bitMap with the same height and width of the 
-           original passed pbm */
-        img_map = Bit2_new(data.width, data.height);
-        for (int j = 0; j < img_map->height; j++) {
-                for (int i = 0; i < img_map->width; i++) {
-                        Bit2_put(img_map, i, j, Pnmrdr_get(rdr));
+        for (int i = 0; i < NUM_ENGINES; i++) {
+                if (strcmp(engines[i].name, name) == 0) {
+                        return &engines[i];
                 }
         }
-
-        fclose(fp);
-        Pnmrdr_free(&rdr);
-        return img_map;
+        error("Error: unknown engine\n", NULL, NULL);
+        return NULL;
 }
 
-/* void remove_black_edges(Bit2_T img_map)
+/* void remove_parallel(Bit2_T img_map)
  * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file
  *    Returns: Nothing
- *       Does: First indexs border of img_map, then finds additional black
- *             edges branching from the border, finally frees the sequence
- *             of coordinates
+ *       Does: Runs the parallel engine with the thread count from -t
  */
-void remove_black_edges(Bit2_T img_map)
+void remove_parallel(Bit2_T img_map)
 {
-        Seq_T seq = Seq_new(1);
-        /* collects border black edges in seq */
-        check_border(img_map, seq);
-        /* finds branching edges from the border blak edges */
-        find_edges(img_map, seq);
-        Seq_free(&seq);
+        remove_black_edges_parallel(img_map, num_threads);
 }
 
-/* void find_edges(Bit2_T img_map, Seq_T seq)
- * Parameters: [Bit2_T img_map] - the bitmap from the originally passed file 
- *             [Seq_T seq] - the sequence of border blackedge indexs
+/* void stream_file(char *filename, int raw)
+ * Parameters: [char *filename] - pbm file to read, or NULL for stdin
+ *             [int raw] - 1 to print a raw (P4) pbm, 0 for a plain pbm
  *    Returns: Nothing
- *       Does: converts blackedges into white pixels by adding black edge
- *             branchs to the black edge index sequence, then updates the 
- *             lowest black edge index from the sequence to a white pixel 
+ *       Does: Prints the pbm with its black edges removed by the two pass
+ *             streaming engine, exiting with an error if the input is not
+ *             a valid pbm or cannot be read twice
  */
-void find_edges(Bit2_T img_map, Seq_T seq)
+void stream_file(char *filename, int raw)
 {
-        /* iterates until the sequence of coordinates to check and change
-           is empty */
-        while (Seq_length(seq) > 0) {
-                Index *check_index = Seq_remlo(seq);
-                int col = check_index->col;
-                int row = check_index->row;
-                if (Bit2_get(img_map, col, row) == BLACK_PIXEL) {
-                        /* check for branching edges  */
-                        find_next_edge(img_map, seq, col - 1, row);
-                        find_next_edge(img_map, seq, col + 1, row);
-                        find_next_edge(img_map, seq, col, row - 1);
-                        find_next_edge(img_map, seq, col, row + 1);
-                        /* change bit to white pixel */
-                        Bit2_put(img_map, col, row, WHITE_PIXEL);
+        /* volatile so its value survives the longjmp out of the engine */
+        FILE *volatile fp = stdin;
+        if (filename != NULL) {
+                fp = fopen(filename, "rb");
+                if (fp == NULL) {
+                        error("Error: unable to open file\n", NULL, NULL);
                 }
-                /* free index gotten from sequence */
-                free(check_index);
         }
+        TRY;
+                remove_black_edges_stream(fp, stdout, raw);
+        /* Handles error if the input is a pipe rather than a file */
+        EXCEPT(Streamedges_Seek);
+                error("Error: -s needs a file it can read twice\n", NULL, 
+                      fp);
+        /* Handles error if the header or a plain pixel is badly formed */
+        EXCEPT(Pnmread_Badformat);
+                error("Error: bad format, could not read image\n", NULL, fp);
+        /* Handles error if the file ends before its last pixel */
+        EXCEPT(Pnmread_Count);
+                error("Error: bad format, could not read image\n", NULL, fp);
+        END_TRY;
+        fclose(fp);
 }
 
-/* void find_next_edge(Bit2_T img_map, Seq_T seq, int col, int row)
- * Parameters: [Bit2_T img_map] - the map to check for black edges
- *             [Seq_T seq] - sequence for adding black edge indexs
- *             [int col] - col index
- *             [int row] - row index
- *    Returns: Nothing
- *       Does: checks bit at index row and column and if it is a black edge
- *             it adds this bits index to the seq of black edge indexs
- */
-void find_next_edge(Bit2_T img_map, Seq_T seq, int col, int row)
-{
-        if (col > 0 && col < img_map->width - 1 && 
-            row > 0 && row < img_map->height - 1) {
-                /* Not a border pixel */
-                if (is_black_edge(img_map, col, row) == BLACK_PIXEL) {
-                        Seq_addhi(seq, new_index(col, row));
-                }
-        } 
-}
-
-/* void check_border(Bit2_T img_map, Seq_T seq)
- * Parameters: [Bit2_T img_map] - unmodified bitmap gotten from file
- *             [Seq_T seq] - initially empty, in function the indexs of the
- *                           black edges on the border are added to the this
- *                           sequence
- *    Returns: Nothing
- *       Does: collects indexs of blackedges on the border of the bitmap in
- *             seq
+/* Bit2_T open_file(FILE *fp, Bit2_T img_map, char *filename)
+ * Parameters: [FILE *fp] - file pointer that will be initialized
+ *             [Bit2_T img_map] - the bitmap to be initialized by the 
+ *                               set_bit_array function
+ *             [char *filename] - pbm file to read, or NULL for stdin
+ *    Returns: Bit2_T, initialized bitmap from passed pbm file 
+ *       Does: Initializes the map with the passed pbm from either the command
+ *             line or stdin
  */
-void check_border(Bit2_T img_map, Seq_T seq)
+Bit2_T open_file(FILE *fp, Bit2_T img_map, char *filename) 
 {
-        for (int i = 0; i < img_map->width; i++) {
-                /* Search top border */
-                if (Bit2_get(img_map, i, 0) == BLACK_PIXEL) {
-                        Seq_addhi(seq, new_index(i, 0));
-                }
-                /* Search bottom border */
-                if (Bit2_get(img_map, i, img_map->height - 1) == BLACK_PIXEL) {
-                        Seq_addhi(seq, new_index(i, img_map->height - 1));
+        if (filename != NULL) { /* pbm file passed as command line argument */
+                fp = fopen(filename, "rb");
+                if (fp == NULL) {
+                        error("Error: unable to open file\n", NULL, NULL);
                 }
+                /* Initializes img_map to bitMap inside passed file */
+                img_map = set_bit_array(fp, img_map);
+        } else { /* pbm file collected from stdin */
+                fp = stdin;
+                if (fp == NULL) {
+                        error("Error: unable to open file\n", NULL, NULL);
+                }       
+                /* Initializes img_map to bitMap inside stdin file */
+                img_map = set_bit_array(fp, img_map);
         }
-        for (int j = 0; j < img_map->height; j++) {
-                /* Search left border */
-                if (Bit2_get(img_map, 0, j) == BLACK_PIXEL) {
-                        Seq_addhi(seq, new_index(0, j));
-                }
-                /* Search right border */
-                if (Bit2_get(img_map, img_map->width - 1, j) == BLACK_PIXEL) {
-                        Seq_addhi(seq, new_index(img_map->width - 1, j));
-                }      
+        if (img_map == NULL) { /* Check for error with bitmap creation */
+                error("Error: cannot create bitmap imgMap\n", NULL, fp);
         }
+        return img_map;
 }
 
-/* int is_black_edge(Bit2_T img_map, int col, int row)
- * Parameters: [Bit2_T img_map] - bitmap that will have bit checked from at
- *                               index col and row
- *             [int col] - col index for bitmap
- *             [int row] - row index for bitmap
- *    Returns: WHITE_PIXEL if current bit is not black edges
- *             BLACK_PIXEL if current bit is a black edge
- *       Does: Check description inside body of function 
+/* Bit2_T set_bit_array(FILE *fp,  Bit2_T img_map)            
+ * Parameters: [FILE *fp] - pointer to the file the reader will be initialized
+ *                          to
+ *             [Bit2_T img_map] - the bitmap that will be initialized with the
+ *                               pbm inside the file 
+ *    Returns: Bit2_T, the initialized bitmap from the passed file parameter
+ *       Does: Initializes the passed img_map with the bit contents of the pbm 
+ *             file
  */
-int is_black_edge(Bit2_T img_map, int col, int row)
+Bit2_T set_bit_array(FILE *fp,  Bit2_T img_map)
 {
-        /* -------------------------------   Checked
-         * |   Not   |   (2)   |   Not   |       One or more of the four
-         * | Checked | Checked | Checked |       checked pixels needs to be a 
-         * |   bit   |   bit   |   bit   |       black edges for the current
-         * |------------------------------       bit to be considered a 
-         * |   (1)   |Currently|   (3)   |       black edge
-         * | Checked | On this | Checked |      
-         * |   bit   |   bit   |   bit   |   Currently On this Bit
-         * |------------------------------       This bit needs to be a black
-         * |   Not   |   (4)   |   Not   |       pixel for this bit to be
-         * | Checked | Checked | Checked |       considered a black edge
-         * |   bit   |   bit   |   bit   |       and for the conditions of
-         * -------------------------------       checked to be true
-         */
-        if ((Bit2_get(img_map, col - 1, row) == BLACK_PIXEL ||  /* (1) */
-             Bit2_get(img_map, col + 1, row) == BLACK_PIXEL ||  /* (3) */
-             Bit2_get(img_map, col, row - 1) == BLACK_PIXEL ||  /* (2) */
-             Bit2_get(img_map, col, row + 1) == BLACK_PIXEL) && /* (4) */
-             Bit2_get(img_map, col, row)     == BLACK_PIXEL) {
-                return BLACK_PIXEL;
-        }
-        return WHITE_PIXEL;
-}
+        Pnmread_T rdr = NULL;
 
-/* Index *new_index(int col, int row)
- * Parameters: [int col] - value to be initialized to the Index struct data
- *                         member col 
- *             [int row] - value to be initialized to the Index struct data
- *                         member row
- *    Returns: a pointer to an initialized Index object
- *       Does: initializes an index object
- */
-Index *new_index(int col, int row) 
-{
-        Index *set = malloc(sizeof(Index *));
-        if (set == NULL) {
-                fprintf(stderr, "Error: memory allocation failed.\n");
-                exit(EXIT_FAILURE);
+        /* Initialize reader, which reads the header */
+        TRY;
+                rdr = Pnmread_new(fp);
+        /* Handles error if reader is badformated */
+        EXCEPT(Pnmread_Badformat);
+                error("Error: bad format, could not read image\n", NULL, fp);
+        /* Handles error if the file ends inside the header */
+        EXCEPT(Pnmread_Count);
+                error("Error: bad format, could not read image\n", NULL, fp);
+        END_TRY;
+        
+        /* Check pbm width, height and type */
+        if (rdr->width == 0 || rdr->height == 0 || 
+            (rdr->format != 1 && rdr->format != 4)) {
+                Pnmread_free(&rdr);
+                error("Error: image not valid dimensions or type (requires PBM"
+                      "file)\n", NULL, fp);
         }
-        set->col = col;
-        set->row = row;
-        return set;
-}
-
+        /* Reads the raster straight into a new bitMap with the same height
+           and width of the original passed pbm */
+        img_map = read_raster(rdr, fp);
 
+        fclose(fp);
+        Pnmread_free(&rdr);
+        return img_map;
+}
 
-/* void print_as_pbm(Bit2_T img_map)
- * Parameters: [Bit2_T img_map] - the bitmap to be printed
- *    Returns: Nothing
- *       Does: Prints the passed bitmap using row major indexing
+/* Bit2_T read_raster(Pnmread_T rdr, FILE *fp)
+ * Parameters: [Pnmread_T rdr] - reader positioned after a valid pbm header
+ *             [FILE *fp] - the file being read, closed if an error occurs
+ *    Returns: Bit2_T, a new bitmap holding the raster
+ *       Does: Reads the raster, exiting with an error if it is malformed or
+ *             ends early
  */
-void print_as_pbm(Bit2_T img_map)
+Bit2_T read_raster(Pnmread_T rdr, FILE *fp)
 {
-        printf("P1\n# Black Edges Removed\n%d %d\n", 
-               img_map->width, img_map->height);
-        /* Indexs the imgMap using row major indexing */
-        Bit2_map_row_major(img_map, print_bit, NULL);
+        /* volatile so its value survives the longjmp out of Pbm_read */
+        Bit2_T volatile img_map = NULL;
+        TRY;
+                img_map = Pbm_read(rdr);
+        /* Handles error if a plain pixel is not a 0 or 1 */
+        EXCEPT(Pnmread_Badformat);
+                error("Error: bad format, could not read bit pixels\n", 
+                      NULL, fp);
+        /* Handles error if bit count from reader is inconsistent */  
+        EXCEPT(Pnmread_Count);
+                error("Error: bad format, could not read bit pixels\n", 
+                      NULL, fp);
+        END_TRY;
+        return img_map;
 }
 
-/* void print_bit(int col, int row, Bit2_T img_map, int bit, void *cl)
- * Parameters: [int col] - col index for img_map
- *             [int row] - row index for img_map
- *             [Bit2_T img_map] - the bitmap containing the bits to be printed
- *             [int bit] - the bit value to be printed
- *             [void *cl] - currently line length
+/* void print_as_pbm(Bit2_T img_map, int raw)
+ * Parameters: [Bit2_T img_map] - the bitmap to be printed
+ *             [int raw] - 1 to print a raw (P4) pbm, 0 for a plain pbm
  *    Returns: Nothing
- *       Does: Prints the bit at index row and col from the img_map, and adds  
- *             a space or newline character (when line length reached 70
- *             total characters include spaces and the line terminating new
- *             line character
+ *       Does: Prints the passed bitmap to stdout using row major indexing
  */
-void print_bit(int col, int row, Bit2_T img_map, int bit, void *cl)
+void print_as_pbm(Bit2_T img_map, int raw)
 {
-        (void) row;
-        if (cl == NULL) {
-                int *temp = cl;
-                *temp = 0;
-        }
-
-        int *linelen = (int *)cl;
-        /* Print bit at index col and row */
-        printf("%d", bit);
-        (*linelen)++;
-
-        /* Print a new line at the end of row or if 35 bits have been printed
-           in the current line */
-        if ((col + 1) == img_map->width || *linelen == 35) {
-                /* When the end of the line or the length of the line reaches 
-                   69 total characters add a newline to the end of the line 
-                   and reset the line length to zero */
-                *linelen = 0;
-                printf("\n");
-        } else {
-                printf(" ");    
-        }
+        Pbm_write(stdout, img_map, raw, "Black Edges Removed");
 }
 
 /* void error(char *msg, Bit2_T img_map, FILE *fp)
@@ -0,0 +1,253 @@
+/*
+ * Filename: workpool.c
+ * Authors: Robert Lester, Brian Savage
+ * Assignment: HW2
+ * Summary: This is the implementation of the workpool.h interface, a pool
+ *          of worker threads that is started once and then reused by every
+ *          Workpool_run, so a parallel map does not pay for creating
+ *          threads each time.
+ *
+ *          A job is a count of blocks and a function to call on each. The
+ *          blocks are dealt out as one contiguous range per thread (the
+ *          caller of Workpool_run is one of them). A thread takes blocks
+ *          off the front of its own range; when that is empty it steals
+ *          the back half of another thread's range, so a thread whose
+ *          blocks turn out cheap ends up doing some of a slower thread's
+ *          share. Each range has its own mutex, which is only contended
+ *          when a thief and the owner meet, since blocks are coarse.
+ *
+ *          One job runs at a time. A Workpool_run that finds the pool busy,
+ *          including one made from inside a block of the running job, runs
+ *          its blocks serially in the calling thread instead of waiting.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "assert.h"
+#include "workpool.h"
+
+#define MAX_THREADS 1024
+
+/* one thread's share of the current job: blocks next through end - 1 */
+typedef struct Range {
+        pthread_mutex_t lock;
+        int next;
+        int end;
+} Range;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_posted = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+/* held by the thread running a job, for as long as the job runs */
+static pthread_mutex_t busy = PTHREAD_MUTEX_INITIALIZER;
+
+/* the fields below are guarded by pool_lock */
+static int num_threads = 0;      /* workers plus the caller, 0 until started */
+static Range *ranges = NULL;     /* one per thread, the caller's first */
+static unsigned long generation = 0; /* bumped once per job */
+static int running = 0;          /* workers not yet done with the job */
+static void (*job_work)(int block, void *cl) = NULL;
+static void *job_cl = NULL;
+
+static void *worker(void *cl);
+static void do_blocks(int self);
+static int take_block(int self);
+static int steal_block(int self);
+
+/* int Workpool_start(int nthreads)
+ * Parameters:
+ *             int nthreads: number of threads to run jobs on, counting the
+ *             caller of Workpool_run, or 0 for one per online processor;
+ *             at most MAX_THREADS
+ * Returns: 
+ *             int: the number of threads jobs run on, which is the count
+ *             the first call asked for
+ * Does: 
+ *             Starts the worker threads the first time it is called and
+ *             does nothing after that, so a program that wants a set
+ *             count calls it before its first parallel map. The workers
+ *             live until the program exits
+ */
+int Workpool_start(int nthreads)
+{
+        assert(nthreads >= 0);
+        pthread_mutex_lock(&pool_lock);
+        if (num_threads > 0) {
+                pthread_mutex_unlock(&pool_lock);
+                return num_threads;
+        }
+        if (nthreads == 0) {
+                long n = sysconf(_SC_NPROCESSORS_ONLN);
+                nthreads = (n > 0 && n <= MAX_THREADS) ? (int)n : 1;
+        }
+        if (nthreads < 1 || nthreads > MAX_THREADS) {
+                nthreads = MAX_THREADS;
+        }
+        ranges = malloc((size_t)nthreads * sizeof(Range));
+        assert(ranges != NULL);
+        for (int t = 0; t < nthreads; t++) {
+                pthread_mutex_init(&ranges[t].lock, NULL);
+                ranges[t].next = 0;
+                ranges[t].end = 0;
+        }
+        num_threads = nthreads;
+        for (int t = 1; t < nthreads; t++) {
+                pthread_t thread;
+                if (pthread_create(&thread, NULL, worker, 
+                                   (void *)(intptr_t)t) != 0) {
+                        fprintf(stderr, "Error: could not start a thread\n");
+                        exit(EXIT_FAILURE);
+                }
+                pthread_detach(thread);
+        }
+        pthread_mutex_unlock(&pool_lock);
+        return nthreads;
+}
+
+/* void Workpool_run(int nblocks, void work(int block, void *cl), void *cl)
+ * Parameters:
+ *             int nblocks: number of blocks in the job
+ *             void work(int block, void *cl): called once for each block
+ *             from 0 through nblocks - 1
+ *             void *cl: closure passed to work
+ * Returns: 
+ *             Nothing, once work has returned for every block
+ * Does: 
+ *             Runs work on every block across the pool, starting it with
+ *             the default thread count if it is not running yet. Blocks
+ *             run in no set order and at the same time as each other, so
+ *             work must not depend on the order and must only write what
+ *             no other block reads or writes. work must not raise a Hanson
+ *             exception, since the handler stack is not thread safe
+ */
+void Workpool_run(int nblocks, void work(int block, void *cl), void *cl)
+{
+        assert(nblocks >= 0 && work != NULL);
+        int nthreads = Workpool_start(0);
+        if (nthreads == 1 || nblocks <= 1 || 
+            pthread_mutex_trylock(&busy) != 0) {
+                for (int block = 0; block < nblocks; block++) {
+                        work(block, cl);
+                }
+                return;
+        }
+
+        pthread_mutex_lock(&pool_lock);
+        for (int t = 0; t < nthreads; t++) {
+                pthread_mutex_lock(&ranges[t].lock);
+                ranges[t].next = (int)((long long)nblocks * t / nthreads);
+                ranges[t].end = (int)((long long)nblocks * (t + 1) / 
+                                      nthreads);
+                pthread_mutex_unlock(&ranges[t].lock);
+        }
+        job_work = work;
+        job_cl = cl;
+        running = nthreads - 1;
+        generation++;
+        pthread_cond_broadcast(&job_posted);
+        pthread_mutex_unlock(&pool_lock);
+
+        do_blocks(0);
+
+        pthread_mutex_lock(&pool_lock);
+        while (running > 0) {
+                pthread_cond_wait(&job_done, &pool_lock);
+        }
+        pthread_mutex_unlock(&pool_lock);
+        pthread_mutex_unlock(&busy);
+}
+
+/* static void *worker(void *cl)
+ * Does: the loop of worker thread number cl: waits for each new job, works
+ *       through blocks until none are left anywhere, and reports that it
+ *       is done
+ */
+static void *worker(void *cl)
+{
+        int self = (int)(intptr_t)cl;
+        unsigned long seen = 0;
+        for (;;) {
+                pthread_mutex_lock(&pool_lock);
+                while (generation == seen) {
+                        pthread_cond_wait(&job_posted, &pool_lock);
+                }
+                seen = generation;
+                pthread_mutex_unlock(&pool_lock);
+
+                do_blocks(self);
+
+                pthread_mutex_lock(&pool_lock);
+                if (--running == 0) {
+                        pthread_cond_signal(&job_done);
+                }
+                pthread_mutex_unlock(&pool_lock);
+        }
+        return NULL;
+}
+
+/* static void do_blocks(int self)
+ * Does: runs blocks from thread self's own range, then stolen ones, until
+ *       every range is empty
+ */
+static void do_blocks(int self)
+{
+        for (;;) {
+                int block = take_block(self);
+                if (block < 0) {
+                        block = steal_block(self);
+                }
+                if (block < 0) {
+                        return;
+                }
+                job_work(block, job_cl);
+        }
+}
+
+/* static int take_block(int self)
+ * Returns: the first block of thread self's range, removing it, or -1 if
+ *          the range is empty
+ */
+static int take_block(int self)
+{
+        Range *range = &ranges[self];
+        pthread_mutex_lock(&range->lock);
+        int block = (range->next < range->end) ? range->next++ : -1;
+        pthread_mutex_unlock(&range->lock);
+        return block;
+}
+
+/* static int steal_block(int self)
+ * Returns: a block stolen from the first other thread, in order after
+ *          self, whose range is not empty, or -1 if every range is empty.
+ *          The back half of that range is moved to self's range and its
+ *          first block is returned
+ */
+static int steal_block(int self)
+{
+        for (int k = 1; k < num_threads; k++) {
+                Range *victim = &ranges[(self + k) % num_threads];
+                pthread_mutex_lock(&victim->lock);
+                int left = victim->end - victim->next;
+                if (left <= 0) {
+                        pthread_mutex_unlock(&victim->lock);
+                        continue;
+                }
+                int end = victim->end;
+                victim->end -= (left + 1) / 2;
+                int first = victim->end;
+                pthread_mutex_unlock(&victim->lock);
+
+                Range *range = &ranges[self];
+                pthread_mutex_lock(&range->lock);
+                range->next = first + 1;
+                range->end = end;
+                pthread_mutex_unlock(&range->lock);
+                return first;
+        }
+        return -1;
+}
@@ -0,0 +1,16 @@
+/* workpool.h
+ * Brian Savage and Robert Lester
+ * bsavag01         rleste01
+ * HW 2 - iii
+ * Interface for workpool, the persistent thread pool behind the parallel
+ * UArray2 and Bit2 maps, functions explained in implementation
+ */
+
+#ifndef WORKPOOL_INCLUDED
+#define WORKPOOL_INCLUDED
+
+extern int Workpool_start(int nthreads);
+extern void Workpool_run(int nblocks, void work(int block, void *cl),
+                         void *cl);
+
+#endif